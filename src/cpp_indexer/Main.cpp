@@ -7,6 +7,12 @@ bool FILE_BASED = false;
 bool DETECT_LANG = true;
 /** Use lemmatization or stemming */
 bool USE_LEMMA = true;
+/** Number of worker threads (0 = number of hardware threads) */
+int THREADS = 0;
+/** Memory budget of a block of the file based index build in MB */
+int MEMORY_BUDGET = 256;
+/** Bits of the quantized impacts of the in-memory index (8 or 16, 0 = scoring by the float postings) */
+int IMPACT_BITS = 0;
 
 /**
  * Parse arguments
@@ -16,12 +22,15 @@ bool USE_LEMMA = true;
 void parse_args(int argc, char **argv) {
     for (int i = 1; i < argc; i++) {
         if (std::string(argv[i]) == "--help") {
-            std::cout << "Usage: ./cpp_indexer [--file-based] [--no-lang-detect] [--lemma | --stem]" << std::endl;
+            std::cout << "Usage: ./cpp_indexer [--file-based] [--no-lang-detect] [--lemma | --stem] [--threads N] [--memory-budget MB] [--impact-bits 8|16]" << std::endl;
             std::cout << "Options:" << std::endl;
             std::cout << "\t--file-based\t\tUse file based index" << std::endl;
             std::cout << "\t--no-lang-detect\tDo not detect language" << std::endl;
             std::cout << "\t--lemma\t\t\t\tUse lemmatization" << std::endl;
             std::cout << "\t--stem\t\t\t\tUse stemming" << std::endl;
+            std::cout << "\t--threads N\t\t\tNumber of worker threads (default: number of hardware threads)" << std::endl;
+            std::cout << "\t--memory-budget MB\tMemory budget of the file based index build (default: 256)" << std::endl;
+            std::cout << "\t--impact-bits N\t\tScore by impacts quantized to 8 or 16 bits (default: float scores)" << std::endl;
             exit(EXIT_SUCCESS);
         }
 
@@ -33,6 +42,14 @@ void parse_args(int argc, char **argv) {
             USE_LEMMA = true;
         if (std::string(argv[i]) == "--stem")
             USE_LEMMA = false;
+        if (std::string(argv[i]) == "--threads" && i + 1 < argc)
+            THREADS = std::max(0, std::atoi(argv[++i]));
+        if (std::string(argv[i]) == "--memory-budget" && i + 1 < argc)
+            MEMORY_BUDGET = std::max(1, std::atoi(argv[++i]));
+        if (std::string(argv[i]) == "--impact-bits" && i + 1 < argc) {
+            int bits = std::atoi(argv[++i]);
+            IMPACT_BITS = bits <= 0 ? 0 : (bits <= 8 ? 8 : 16);
+        }
     }
 }
 
@@ -55,7 +72,7 @@ void mkdirs() {
  * @return Exit code
  */
 int main(int argc, char **argv) {
-    /* Parse arguments, set FILE_BASED and DETECT_LANG */
+    /* Parse arguments, set FILE_BASED, DETECT_LANG, USE_LEMMA, THREADS, MEMORY_BUDGET and IMPACT_BITS */
     parse_args(argc, argv);
 
     /* Create directories if they do not exist */
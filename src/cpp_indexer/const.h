@@ -1,13 +1,42 @@
 #pragma once
 
+#include <string>
+#include <thread>
+#include <algorithm>
+
 /** File based index */
 extern bool FILE_BASED;
 /** Language detection is REALLY sloooow */
 extern bool DETECT_LANG;
 /** Use lemmatization or stemming */
 extern bool USE_LEMMA;
+/** Number of worker threads (0 = number of hardware threads) */
+extern int THREADS;
+/** Memory budget of a block of the file based index build in MB */
+extern int MEMORY_BUDGET;
+/** Bits of the quantized impacts of the in-memory index (8 or 16, 0 = scoring by the float postings) */
+extern int IMPACT_BITS;
 
 /** Path to the index */
 const std::string INDEX_PATH = "../index/";
+/** Extension of the (binary) index files */
+const std::string INDEX_EXTENSION = ".idx";
 /** Path to the file based index */
 const std::string FILE_BASED_INDEX_PATH = "../index_file_based/";
+/** Extension of the directory a file based index is rebuilt in (its files replace the index once it is built) */
+const std::string STAGING_EXTENSION = ".staging";
+/** Name of the lemma (and stem) cache file, saved next to the indices */
+const std::string LEMMA_CACHE_FILE = "lemma_cache.bin";
+/** Default Unix domain socket of the query server */
+const std::string SERVER_SOCKET_PATH = "../cpp_indexer.sock";
+
+/**
+ * Get the number of worker threads to use
+ * @param tasks Number of tasks (there is no point in more threads than tasks)
+ * @return Number of threads (at least 1)
+ */
+inline unsigned int get_threads_count(size_t tasks) {
+    unsigned int threads = THREADS > 0 ? static_cast<unsigned int>(THREADS) : std::thread::hardware_concurrency();
+    threads = std::min<size_t>(std::max(threads, 1u), std::max<size_t>(tasks, 1));
+    return threads;
+}
@@ -0,0 +1,121 @@
+#include "BinaryIO.h"
+
+#include <fstream>
+#include <sstream>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+void BinaryWriter::write_string(const std::string &str) {
+    this->write(static_cast<uint32_t>(str.size()));
+    this->buffer.append(str);
+}
+
+void BinaryWriter::write_strings(const std::vector<std::string> &strings) {
+    this->write(static_cast<uint32_t>(strings.size()));
+    for (const auto &str : strings)
+        this->write_string(str);
+}
+
+const std::string &BinaryWriter::data() const {
+    return this->buffer;
+}
+
+size_t BinaryWriter::size() const {
+    return this->buffer.size();
+}
+
+uint64_t BinaryWriter::checksum(const char *data, size_t size) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= static_cast<unsigned char>(data[i]);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+BinaryReader::BinaryReader(const char *data, size_t size) : data(data), size(size), pos(0) {
+    /* Nothing to do here :) */
+}
+
+void BinaryReader::require(size_t bytes) const {
+    if (bytes > this->size - this->pos)
+        throw std::runtime_error("[ERROR]: Unexpected end of binary data!");
+}
+
+std::string BinaryReader::read_string() {
+    auto length = this->read<uint32_t>();
+    const char *start = this->skip(length);
+    return {start, length};
+}
+
+std::vector<std::string> BinaryReader::read_strings() {
+    auto count = this->read<uint32_t>();
+    std::vector<std::string> strings;
+    strings.reserve(count);
+    for (uint32_t i = 0; i < count; i++)
+        strings.emplace_back(this->read_string());
+    return strings;
+}
+
+const char *BinaryReader::skip(size_t bytes) {
+    this->require(bytes);
+    const char *start = this->data + this->pos;
+    this->pos += bytes;
+    return start;
+}
+
+size_t BinaryReader::remaining() const {
+    return this->size - this->pos;
+}
+
+MappedFile::MappedFile(const std::string &path) {
+#ifndef _WIN32
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return;
+    struct stat info{};
+    if (fstat(fd, &info) == 0 && info.st_size > 0) {
+        void *ptr = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_SHARED, fd, 0);
+        if (ptr != MAP_FAILED) {
+            this->data_ptr = static_cast<const char *>(ptr);
+            this->data_size = static_cast<size_t>(info.st_size);
+            this->mapped = true;
+        }
+    }
+    close(fd);
+    if (this->mapped)
+        return;
+#endif
+    /* No mmap - just read the whole file */
+    std::ifstream input(path, std::ios::binary);
+    if (!input)
+        return;
+    std::stringstream buffer;
+    buffer << input.rdbuf();
+    this->fallback = buffer.str();
+    this->data_ptr = this->fallback.data();
+    this->data_size = this->fallback.size();
+}
+
+MappedFile::~MappedFile() {
+#ifndef _WIN32
+    if (this->mapped)
+        munmap(const_cast<char *>(this->data_ptr), this->data_size);
+#endif
+}
+
+bool MappedFile::is_open() const {
+    return this->data_ptr != nullptr;
+}
+
+const char *MappedFile::data() const {
+    return this->data_ptr;
+}
+
+size_t MappedFile::size() const {
+    return this->data_size;
+}
@@ -0,0 +1,191 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include <type_traits>
+
+/**
+ * Append-only writer of binary data (native byte order)
+ * Used for the binary index format instead of JSON
+ */
+class BinaryWriter {
+private:
+    /** Written bytes */
+    std::string buffer;
+
+public:
+    /**
+     * Write a trivially copyable value
+     * @param value Value to write
+     */
+    template<typename T>
+    void write(const T &value) {
+        static_assert(std::is_trivially_copyable_v<T>, "Only trivially copyable types can be written");
+        this->buffer.append(reinterpret_cast<const char *>(&value), sizeof(T));
+    }
+    /**
+     * Write a contiguous array of trivially copyable values (without the size)
+     * @param values Pointer to the first value
+     * @param count Number of values
+     */
+    template<typename T>
+    void write_array(const T *values, size_t count) {
+        static_assert(std::is_trivially_copyable_v<T>, "Only trivially copyable types can be written");
+        if (count)
+            this->buffer.append(reinterpret_cast<const char *>(values), sizeof(T) * count);
+    }
+    /**
+     * Write a string (uint32 length followed by the bytes)
+     * @param str String to write
+     */
+    void write_string(const std::string &str);
+    /**
+     * Write a vector of strings (uint32 count followed by the strings)
+     * @param strings Strings to write
+     */
+    void write_strings(const std::vector<std::string> &strings);
+
+    /**
+     * Get the written bytes
+     * @return Written bytes
+     */
+    [[nodiscard]] const std::string &data() const;
+    /**
+     * Get the number of written bytes
+     * @return Number of written bytes
+     */
+    [[nodiscard]] size_t size() const;
+
+    /**
+     * FNV-1a 64-bit checksum of the given data
+     * @param data Data
+     * @param size Size of the data
+     * @return Checksum
+     */
+    static uint64_t checksum(const char *data, size_t size);
+};
+
+/**
+ * Bounds checked reader of binary data written by BinaryWriter
+ * Throws std::runtime_error when the data is truncated
+ */
+class BinaryReader {
+private:
+    /** Data to read from */
+    const char *data;
+    /** Size of the data */
+    size_t size;
+    /** Current position */
+    size_t pos;
+
+    /**
+     * Make sure there are at least the given number of bytes left
+     * @param bytes Number of bytes
+     */
+    void require(size_t bytes) const;
+
+public:
+    /**
+     * Constructor for the BinaryReader class
+     * @param data Data to read from
+     * @param size Size of the data
+     */
+    BinaryReader(const char *data, size_t size);
+
+    /**
+     * Read a trivially copyable value
+     * @return Read value
+     */
+    template<typename T>
+    T read() {
+        static_assert(std::is_trivially_copyable_v<T>, "Only trivially copyable types can be read");
+        this->require(sizeof(T));
+        T value;
+        std::memcpy(&value, this->data + this->pos, sizeof(T));
+        this->pos += sizeof(T);
+        return value;
+    }
+    /**
+     * Read a contiguous array of trivially copyable values
+     * @param values Pointer to the first value to read into
+     * @param count Number of values
+     */
+    template<typename T>
+    void read_array(T *values, size_t count) {
+        static_assert(std::is_trivially_copyable_v<T>, "Only trivially copyable types can be read");
+        this->require(sizeof(T) * count);
+        if (count)
+            std::memcpy(values, this->data + this->pos, sizeof(T) * count);
+        this->pos += sizeof(T) * count;
+    }
+    /**
+     * Read a string written by BinaryWriter::write_string
+     * @return Read string
+     */
+    std::string read_string();
+    /**
+     * Read a vector of strings written by BinaryWriter::write_strings
+     * @return Read strings
+     */
+    std::vector<std::string> read_strings();
+    /**
+     * Get a pointer to the current position and skip the given number of bytes
+     * @param bytes Number of bytes
+     * @return Pointer to the skipped bytes
+     */
+    const char *skip(size_t bytes);
+
+    /**
+     * Number of bytes left
+     * @return Number of bytes left
+     */
+    [[nodiscard]] size_t remaining() const;
+};
+
+/**
+ * Read-only memory mapped file (falls back to reading the whole file where mmap is not available)
+ */
+class MappedFile {
+private:
+    /** Mapped data */
+    const char *data_ptr = nullptr;
+    /** Size of the mapped data */
+    size_t data_size = 0;
+    /** Fallback buffer (Windows) */
+    std::string fallback;
+    /** Whether the data is memory mapped */
+    bool mapped = false;
+
+public:
+    /**
+     * Map the given file
+     * @param path Path to the file
+     */
+    explicit MappedFile(const std::string &path);
+    /**
+     * Unmap the file
+     */
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    /**
+     * Whether the file was opened successfully
+     * @return True if open
+     */
+    [[nodiscard]] bool is_open() const;
+    /**
+     * Get the mapped data
+     * @return Pointer to the data
+     */
+    [[nodiscard]] const char *data() const;
+    /**
+     * Get the size of the mapped data
+     * @return Size in bytes
+     */
+    [[nodiscard]] size_t size() const;
+};
@@ -1,6 +1,6 @@
 #include "DataLoader.h"
 
-int DataLoader::id_counter = 0;
+std::atomic<int> DataLoader::id_counter = 0;
 
 json DataLoader::load_json(const std::string &path) {
     std::ifstream input(path);
@@ -9,12 +9,12 @@ json DataLoader::load_json(const std::string &path) {
     return data;
 }
 
-Document DataLoader::load_json_document(const std::string &path) {
+Document DataLoader::parse_json_document(const std::string &path, int id) {
     std::ifstream input(path);
     json data;
     input >> data;
     return {
-            DataLoader::id_counter++,
+            id,
             data["title"][0],
             data["toc"].get<std::vector<std::string>>(),
             data["h1"].get<std::vector<std::string>>(),
@@ -24,6 +24,10 @@ Document DataLoader::load_json_document(const std::string &path) {
     };
 }
 
+Document DataLoader::load_json_document(const std::string &path) {
+    return parse_json_document(path, DataLoader::id_counter++);
+}
+
 std::vector<json> DataLoader::load_jsons_from_dir(const std::string &path) {
     std::vector<json> jsons;
     for (const auto &entry : std::filesystem::directory_iterator(path))
@@ -32,22 +36,135 @@ std::vector<json> DataLoader::load_jsons_from_dir(const std::string &path) {
     return jsons;
 }
 
-std::vector<Document> DataLoader::load_json_documents_from_dir(const std::string &path) {
-    std::vector<Document> documents;
+std::vector<std::string> DataLoader::list_json_files(const std::string &path) {
+    std::vector<std::string> paths;
     for (const auto &entry : std::filesystem::directory_iterator(path))
         if (entry.path().extension() == ".json")
-            documents.push_back(load_json_document(entry.path().string()));
+            paths.emplace_back(entry.path().string());
+    /* Directory order depends on the file system */
+    std::sort(paths.begin(), paths.end());
+    return paths;
+}
+
+std::vector<Document> DataLoader::load_json_documents(const std::vector<std::string> &paths, size_t begin, size_t end, int first_id) {
+    std::vector<Document> documents(end - begin);
+    std::atomic<size_t> next(begin);
+    std::exception_ptr error = nullptr;
+    std::mutex error_mutex;
+
+    auto worker = [&]() {
+        for (auto i = next++; i < end; i = next++) {
+            try {
+                documents[i - begin] = parse_json_document(paths[i], first_id + static_cast<int>(i - begin));
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(error_mutex);
+                if (!error)
+                    error = std::current_exception();
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    auto threads_count = get_threads_count(end - begin);
+    for (size_t i = 1; i < threads_count; i++)
+        threads.emplace_back(worker);
+    worker();
+    for (auto &thread : threads)
+        thread.join();
+
+    /* Same behaviour as the serial loader - the first invalid file fails the whole load */
+    if (error)
+        std::rethrow_exception(error);
     return documents;
 }
 
+std::vector<Document> DataLoader::load_json_documents_from_dir(const std::string &path) {
+    auto paths = list_json_files(path);
+    int first_id = DataLoader::id_counter.fetch_add(static_cast<int>(paths.size()));
+    return load_json_documents(paths, 0, paths.size(), first_id);
+}
+
+void DataLoader::stream_json_documents_from_dir(const std::string &path, const std::function<void(std::vector<Document> &)> &callback, size_t batch_size) {
+    auto paths = list_json_files(path);
+    int first_id = DataLoader::id_counter.fetch_add(static_cast<int>(paths.size()));
+    batch_size = std::max<size_t>(batch_size, 1);
+
+    auto load_batch = [&paths, first_id, batch_size](size_t begin) {
+        auto end = std::min(paths.size(), begin + batch_size);
+        return load_json_documents(paths, begin, end, first_id + static_cast<int>(begin));
+    };
+
+    /* Only the current and the next batch are in memory at once */
+    std::future<std::vector<Document>> next_batch;
+    if (!paths.empty())
+        next_batch = std::async(std::launch::async, load_batch, 0);
+    for (size_t begin = 0; begin < paths.size(); begin += batch_size) {
+        auto batch = next_batch.get();
+        if (begin + batch_size < paths.size())
+            next_batch = std::async(std::launch::async, load_batch, begin + batch_size);
+        callback(batch);
+    }
+}
+
 void DataLoader::save_index_to_file(Indexer &indexer, const string &index_path) {
-    std::ofstream output(index_path);
-    json data = indexer.to_json();
-    output << data.dump(1);
+    BinaryWriter writer;
+    indexer.to_binary(writer);
+
+    binary_index_header header{};
+    std::memcpy(header.magic, BINARY_INDEX_MAGIC, sizeof(header.magic));
+    header.version = BINARY_INDEX_VERSION;
+    header.payload_size = writer.size();
+    header.checksum = BinaryWriter::checksum(writer.data().data(), writer.size());
+
+    std::ofstream output(index_path, std::ios::binary);
+    output.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    output.write(writer.data().data(), static_cast<std::streamsize>(writer.size()));
     output.close();
 }
 
-void DataLoader::load_index_from_file(Indexer &indexer, const string &index_path) {
+bool DataLoader::load_index_from_file(Indexer &indexer, const string &index_path) {
+    MappedFile file(index_path);
+    if (!file.is_open()) {
+        std::cerr << "[ERROR]: Failed to open index file " << index_path << "!" << std::endl;
+        return false;
+    }
+
+    /* Anything without the magic bytes is an index saved before the binary format */
+    if (file.size() < sizeof(binary_index_header) || std::memcmp(file.data(), BINARY_INDEX_MAGIC, sizeof(BINARY_INDEX_MAGIC)) != 0) {
+        try {
+            load_index_from_json(indexer, index_path);
+        } catch (const json::exception &e) {
+            std::cerr << "[ERROR]: Index file " << index_path << " is corrupted! " << e.what() << std::endl;
+            indexer = Indexer();
+            return false;
+        }
+        return true;
+    }
+
+    binary_index_header header{};
+    std::memcpy(&header, file.data(), sizeof(header));
+    const char *payload = file.data() + sizeof(header);
+    if (header.version != BINARY_INDEX_VERSION) {
+        std::cerr << "[ERROR]: Unsupported index version " << header.version << " in " << index_path << "!" << std::endl;
+        return false;
+    }
+    if (header.payload_size != file.size() - sizeof(header) || header.checksum != BinaryWriter::checksum(payload, header.payload_size)) {
+        std::cerr << "[ERROR]: Index file " << index_path << " is corrupted!" << std::endl;
+        return false;
+    }
+
+    try {
+        BinaryReader reader(payload, header.payload_size);
+        indexer.from_binary(reader);
+    } catch (const std::runtime_error &e) {
+        std::cerr << e.what() << std::endl;
+        indexer = Indexer();
+        return false;
+    }
+    return true;
+}
+
+void DataLoader::load_index_from_json(Indexer &indexer, const string &index_path) {
     std::ifstream input(index_path);
     json data;
     input >> data;
@@ -4,19 +4,72 @@
 #include <fstream>
 #include <filesystem>
 #include <utility>
+#include <functional>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <future>
+#include <exception>
 #include "nlohmann/json.hpp"
 #include "Document.h"
 #include "Indexer.h"
+#include "BinaryIO.h"
 
 using json = nlohmann::json;
 
+/**
+ * Header of the binary index file
+ */
+struct binary_index_header {
+    /** Magic bytes ("ZIDX") */
+    char magic[4];
+    /** Version of the format */
+    uint32_t version;
+    /** Size of the payload following the header */
+    uint64_t payload_size;
+    /** FNV-1a checksum of the payload */
+    uint64_t checksum;
+};
+
 /**
  * Class for loading data from JSON files
  */
 class DataLoader {
+private:
+    /**
+     * Load the index from the given path (legacy JSON format)
+     * @param indexer Indexer object
+     * @param index_path Index path
+     */
+    static void load_index_from_json(Indexer &indexer, const std::string &index_path);
+    /**
+     * Parse JSON document from the given path
+     * @param path Filepath to the JSON file
+     * @param id ID of the document
+     * @return Document object
+     */
+    static Document parse_json_document(const std::string &path, int id);
+    /**
+     * Parse the given range of JSON documents in parallel (files are taken from a shared queue, so big files do not stall the rest)
+     * @param paths Filepaths to the JSON files
+     * @param begin First file of the range
+     * @param end End of the range
+     * @param first_id ID of the first document, the rest follow in the order of the files
+     * @return Vector of Document objects in the order of the files
+     */
+    static std::vector<Document> load_json_documents(const std::vector<std::string> &paths, size_t begin, size_t end, int first_id);
+
 public:
-    /** ID counter for documents */
-    static int id_counter;
+    /** Magic bytes of the binary index */
+    static constexpr char BINARY_INDEX_MAGIC[4] = {'Z', 'I', 'D', 'X'};
+    /** Version of the binary index format */
+    static constexpr uint32_t BINARY_INDEX_VERSION = 3;
+
+    /** Default number of documents in a batch of the streaming loader */
+    static constexpr size_t STREAM_BATCH_SIZE = 256;
+
+    /** ID counter for documents (documents can be loaded outside of the GUI thread) */
+    static std::atomic<int> id_counter;
 
     /**
      * Load JSON from the given path
@@ -37,22 +90,39 @@ public:
      */
     static std::vector<json> load_jsons_from_dir(const std::string &path);
     /**
-     * Load JSON documents from the given directory
+     * Get JSON files in the given directory sorted by path
+     * @param path Directory path with JSON files
+     * @return Sorted filepaths
+     */
+    static std::vector<std::string> list_json_files(const std::string &path);
+    /**
+     * Load JSON documents from the given directory (parsed in parallel)
+     * IDs are assigned in the order of the sorted paths, so they do not depend on the file system or the number of threads
      * @param path Directory path with JSON files
      * @return Vector of Document objects
      */
     static std::vector<Document> load_json_documents_from_dir(const std::string &path);
+    /**
+     * Load JSON documents from the given directory in batches
+     * The next batch is parsed while the callback processes the current one, IDs are the same as with load_json_documents_from_dir
+     * @param path Directory path with JSON files
+     * @param callback Function called with every batch of documents (the batch can be moved from)
+     * @param batch_size Number of documents in a batch
+     */
+    static void stream_json_documents_from_dir(const std::string &path, const std::function<void(std::vector<Document> &)> &callback, size_t batch_size = STREAM_BATCH_SIZE);
 
     /**
-     * Save the index to the given path
+     * Save the index to the given path (binary format)
      * @param indexer Indexer object
      * @param index_path Index path
      */
     static void save_index_to_file(Indexer &indexer, const std::string &index_path);
     /**
      * Load the index from the given path
+     * Binary indices are memory mapped and verified, anything else is loaded as the legacy JSON index
      * @param indexer Indexer object
      * @param index_path Index path
+     * @return True if the index was loaded successfully
      */
-    static void load_index_from_file(Indexer &indexer, const std::string &index_path);
+    static bool load_index_from_file(Indexer &indexer, const std::string &index_path);
 };
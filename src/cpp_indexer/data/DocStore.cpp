@@ -0,0 +1,144 @@
+#include "DocStore.h"
+
+#include <iostream>
+#include <algorithm>
+
+/** Size of the file header (magic, version, number of entries) */
+static constexpr size_t HEADER_SIZE = sizeof(DocStore::MAGIC) + sizeof(uint32_t) + sizeof(uint64_t);
+
+DocStore::DocStore(const std::string &dictionary_path, const std::string &store_path) : dictionary(dictionary_path), count(0), entries(nullptr), store(store_path, std::ios::binary), mutex() {
+    if (!this->dictionary.is_open() || this->dictionary.size() < HEADER_SIZE)
+        return;
+
+    try {
+        BinaryReader reader(this->dictionary.data(), this->dictionary.size());
+        const char *magic = reader.skip(sizeof(MAGIC));
+        if (std::memcmp(magic, MAGIC, sizeof(MAGIC)) != 0 || reader.read<uint32_t>() != VERSION) {
+            std::cerr << "[ERROR]: Invalid document store " << dictionary_path << "!" << std::endl;
+            return;
+        }
+        auto entries_count = reader.read<uint64_t>();
+        if (entries_count > reader.remaining() / sizeof(doc_entry))
+            throw std::runtime_error("[ERROR]: Corrupted document store " + dictionary_path + "!");
+        this->entries = reader.skip(entries_count * sizeof(doc_entry));
+        this->count = entries_count;
+    } catch (const std::runtime_error &e) {
+        std::cerr << e.what() << std::endl;
+        this->count = 0;
+    }
+}
+
+doc_entry DocStore::entry(size_t i) const {
+    doc_entry result{};
+    std::memcpy(&result, this->entries + i * sizeof(doc_entry), sizeof(doc_entry));
+    return result;
+}
+
+bool DocStore::find(int doc_id, doc_entry &result) const {
+    size_t low = 0;
+    size_t high = this->count;
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        auto candidate = this->entry(mid);
+        if (candidate.id < doc_id) {
+            low = mid + 1;
+        } else if (candidate.id > doc_id) {
+            high = mid;
+        } else {
+            result = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+std::string DocStore::read(uint64_t offset, size_t size) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    std::string buffer(size, '\0');
+    this->store.clear();
+    this->store.seekg(static_cast<std::streamoff>(offset));
+    this->store.read(buffer.data(), static_cast<std::streamsize>(size));
+    if (static_cast<size_t>(this->store.gcount()) != size)
+        throw std::runtime_error("[ERROR]: Unexpected end of the document store!");
+    return buffer;
+}
+
+bool DocStore::get_doc(int doc_id, Document &doc) {
+    doc_entry element{};
+    if (!this->find(doc_id, element))
+        return false;
+    try {
+        auto buffer = this->read(element.offset, element.doc_size);
+        BinaryReader reader(buffer.data(), buffer.size());
+        doc.from_binary(reader);
+    } catch (const std::runtime_error &e) {
+        std::cerr << e.what() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool DocStore::get_tokenized_doc(int doc_id, TokenizedDocument &doc) {
+    doc_entry element{};
+    if (!this->find(doc_id, element))
+        return false;
+    try {
+        auto buffer = this->read(element.offset + element.doc_size, element.tokenized_size);
+        BinaryReader reader(buffer.data(), buffer.size());
+        doc.from_binary(reader);
+    } catch (const std::runtime_error &e) {
+        std::cerr << e.what() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+std::vector<int> DocStore::get_doc_ids() const {
+    std::vector<int> doc_ids;
+    doc_ids.reserve(this->count);
+    for (size_t i = 0; i < this->count; i++)
+        doc_ids.emplace_back(this->entry(i).id);
+    return doc_ids;
+}
+
+size_t DocStore::size() const {
+    return this->count;
+}
+
+void DocStore::save(const std::string &dictionary_path, const std::string &store_path, const std::unordered_map<int, Document> &doc_cache, const std::vector<TokenizedDocument> &tokenized_docs) {
+    /* Tokenized documents by ID, only documents with both records are stored */
+    std::unordered_map<int, const TokenizedDocument *> tokenized_by_id;
+    for (const auto &doc : tokenized_docs)
+        tokenized_by_id[doc.id] = &doc;
+    std::vector<int> doc_ids;
+    for (const auto &[doc_id, _] : doc_cache)
+        if (tokenized_by_id.find(doc_id) != tokenized_by_id.end())
+            doc_ids.emplace_back(doc_id);
+    std::sort(doc_ids.begin(), doc_ids.end());
+
+    std::ofstream output(store_path, std::ios::binary);
+    std::vector<doc_entry> doc_entries;
+    doc_entries.reserve(doc_ids.size());
+    uint64_t offset = 0;
+    for (const auto &doc_id : doc_ids) {
+        BinaryWriter record;
+        doc_cache.at(doc_id).to_binary(record);
+        auto doc_size = static_cast<uint32_t>(record.size());
+        tokenized_by_id[doc_id]->to_binary(record);
+        auto tokenized_size = static_cast<uint32_t>(record.size() - doc_size);
+        output.write(record.data().data(), static_cast<std::streamsize>(record.size()));
+
+        doc_entries.push_back({doc_id, doc_size, offset, tokenized_size, 0});
+        offset += record.size();
+    }
+    output.close();
+
+    BinaryWriter writer;
+    writer.write_array(MAGIC, sizeof(MAGIC));
+    writer.write(VERSION);
+    writer.write(static_cast<uint64_t>(doc_entries.size()));
+    writer.write_array(doc_entries.data(), doc_entries.size());
+    std::ofstream dictionary_output(dictionary_path, std::ios::binary);
+    dictionary_output.write(writer.data().data(), static_cast<std::streamsize>(writer.size()));
+    dictionary_output.close();
+}
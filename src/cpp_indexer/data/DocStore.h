@@ -0,0 +1,112 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <mutex>
+#include <unordered_map>
+#include <cstdint>
+#include "BinaryIO.h"
+#include "Document.h"
+
+/**
+ * Entry of the document store dictionary
+ */
+struct doc_entry {
+    /** Document ID */
+    int32_t id;
+    /** Size of the document record in bytes */
+    uint32_t doc_size;
+    /** Offset of the document record in the store (tokenized document record follows right after) */
+    uint64_t offset;
+    /** Size of the tokenized document record in bytes */
+    uint32_t tokenized_size;
+    /** Padding */
+    uint32_t reserved;
+};
+
+/**
+ * Document store of the file based index
+ * Dictionary of document IDs and offsets is memory mapped, documents are read from the store one by one
+ */
+class DocStore {
+private:
+    /** Mapped dictionary file */
+    MappedFile dictionary;
+    /** Number of documents */
+    size_t count;
+    /** Start of the entries */
+    const char *entries;
+    /** Store with the document records */
+    std::ifstream store;
+    /** Lock for reading the store */
+    std::mutex mutex;
+
+    /**
+     * Get the entry at the given position
+     * @param i Position
+     * @return Entry
+     */
+    [[nodiscard]] doc_entry entry(size_t i) const;
+    /**
+     * Find the entry of the given document (binary search, entries are sorted by ID)
+     * @param doc_id Document ID
+     * @param result Found entry
+     * @return True if found
+     */
+    bool find(int doc_id, doc_entry &result) const;
+    /**
+     * Read bytes from the store
+     * @param offset Offset in the store
+     * @param size Number of bytes
+     * @return Read bytes
+     */
+    std::string read(uint64_t offset, size_t size);
+
+public:
+    /** Magic bytes of the dictionary file */
+    static constexpr char MAGIC[4] = {'Z', 'D', 'O', 'C'};
+    /** Version of the store format */
+    static constexpr uint32_t VERSION = 1;
+
+    /**
+     * Open the document store (missing files give an empty store)
+     * @param dictionary_path Path to the dictionary file
+     * @param store_path Path to the store file
+     */
+    DocStore(const std::string &dictionary_path, const std::string &store_path);
+
+    /**
+     * Read the document with the given ID
+     * @param doc_id Document ID
+     * @param doc Read document
+     * @return True if the document exists
+     */
+    bool get_doc(int doc_id, Document &doc);
+    /**
+     * Read the tokenized document with the given ID
+     * @param doc_id Document ID
+     * @param doc Read tokenized document
+     * @return True if the document exists
+     */
+    bool get_tokenized_doc(int doc_id, TokenizedDocument &doc);
+    /**
+     * Get IDs of all the documents in ascending order
+     * @return Document IDs
+     */
+    [[nodiscard]] std::vector<int> get_doc_ids() const;
+    /**
+     * Get the number of documents
+     * @return Number of documents
+     */
+    [[nodiscard]] size_t size() const;
+
+    /**
+     * Save the document store
+     * @param dictionary_path Path to the dictionary file
+     * @param store_path Path to the store file
+     * @param doc_cache Documents
+     * @param tokenized_docs Tokenized documents (same IDs as the documents)
+     */
+    static void save(const std::string &dictionary_path, const std::string &store_path, const std::unordered_map<int, Document> &doc_cache, const std::vector<TokenizedDocument> &tokenized_docs);
+};
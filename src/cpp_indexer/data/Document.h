@@ -3,6 +3,7 @@
 #include <vector>
 #include <string>
 #include "nlohmann/json.hpp"
+#include "BinaryIO.h"
 
 using json = nlohmann::json;
 
@@ -91,6 +92,34 @@ public:
         content = data["content"];
         lang = data["lang"];
     }
+    /**
+     * Write the document to the binary index
+     * @param writer Binary writer
+     */
+    void to_binary(BinaryWriter &writer) const {
+        writer.write(id);
+        writer.write_string(title);
+        writer.write_strings(toc);
+        writer.write_strings(h1);
+        writer.write_strings(h2);
+        writer.write_strings(h3);
+        writer.write_string(content);
+        writer.write_string(lang);
+    }
+    /**
+     * Read the document from the binary index
+     * @param reader Binary reader
+     */
+    void from_binary(BinaryReader &reader) {
+        id = reader.read<int>();
+        title = reader.read_string();
+        toc = reader.read_strings();
+        h1 = reader.read_strings();
+        h2 = reader.read_strings();
+        h3 = reader.read_strings();
+        content = reader.read_string();
+        lang = reader.read_string();
+    }
 };
 
 /**
@@ -192,4 +221,32 @@ public:
         content = data["content"];
         lang = data["lang"];
     }
+    /**
+     * Write the document to the binary index
+     * @param writer Binary writer
+     */
+    void to_binary(BinaryWriter &writer) const {
+        writer.write(id);
+        writer.write_strings(title);
+        writer.write_strings(toc);
+        writer.write_strings(h1);
+        writer.write_strings(h2);
+        writer.write_strings(h3);
+        writer.write_strings(content);
+        writer.write_string(lang);
+    }
+    /**
+     * Read the document from the binary index
+     * @param reader Binary reader
+     */
+    void from_binary(BinaryReader &reader) {
+        id = reader.read<int>();
+        title = reader.read_strings();
+        toc = reader.read_strings();
+        h1 = reader.read_strings();
+        h2 = reader.read_strings();
+        h3 = reader.read_strings();
+        content = reader.read_strings();
+        lang = reader.read_string();
+    }
 };
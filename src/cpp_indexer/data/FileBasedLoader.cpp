@@ -55,6 +55,21 @@ std::vector<TokenizedDocument> FileBasedLoader::load_tokenized_docs(const std::s
     return docs;
 }
 
+void FileBasedLoader::for_each_tokenized_doc(const std::string &index_path_dir, const std::function<void(const TokenizedDocument &)> &callback) {
+    std::ifstream input(index_path_dir + "tokenized_docs.json");
+    /* Every document is handed over as soon as it is parsed and then thrown away */
+    json::parser_callback_t on_event = [&callback](int depth, json::parse_event_t event, json &parsed) {
+        if (depth != 1 || event != json::parse_event_t::object_end)
+            return true;
+        TokenizedDocument doc = TokenizedDocument();
+        doc.from_json(parsed);
+        callback(doc);
+        return false;
+    };
+    std::ignore = json::parse(input, on_event);
+    input.close();
+}
+
 void FileBasedLoader::save_positions_map(const std::map<std::string, std::map<int, std::vector<int>>> &positions_map, const std::string &index_path_dir) {
     json j;
     for (const auto &item : positions_map) {
@@ -89,74 +104,164 @@ std::map<std::string, std::map<int, std::vector<int>>> FileBasedLoader::load_pos
     return positions_map;
 }
 
-void FileBasedLoader::save_tf_idf(const std::map<int, std::map<std::string, float>> &tf_idf_docs, std::map<std::string, float> &idf, const std::string &index_path_dir, bool title) {
-    json j;
-    /* save in format word -> (doc_id -> (tf-idf), idf) */
-    for (const auto &[doc_id, doc_tf_idf]: tf_idf_docs) {
-        for (const auto &[word, value]: doc_tf_idf) {
-            j[word]["doc_tf_idf"].push_back({doc_id, value});
-            j[word]["idf"] = idf[word];
-        }
-    }
-    std::ofstream output;
-    if (title)
-        output.open(index_path_dir + "title_tf_idf.json");
-    else
-        output.open(index_path_dir + "tf_idf.json");
-    output << j.dump(1);
+void FileBasedLoader::save_norms(const std::vector<int> &doc_ids, const std::vector<float> &norms, const std::string &index_path_dir, bool title) {
+    BinaryWriter writer;
+    writer.write(static_cast<uint64_t>(doc_ids.size()));
+    writer.write_array(doc_ids.data(), doc_ids.size());
+    writer.write_array(norms.data(), norms.size());
+    std::ofstream output(index_path_dir + (title ? "title_" : "") + "norms.bin", std::ios::binary);
+    output.write(writer.data().data(), static_cast<std::streamsize>(writer.size()));
     output.close();
 }
 
-std::map<std::string, map_element> FileBasedLoader::load_tf_idf(const std::string &index_path_dir, bool title) {
-    std::ifstream input;
-    if (title)
-        input.open(index_path_dir + "title_tf_idf.json");
-    else
-        input.open(index_path_dir + "tf_idf.json");
-    json j;
-    input >> j;
-    input.close();
-    std::map<std::string, map_element> map_ele;
-    for (const auto &item : j.items()) {
-        map_element element;
-        element.idf = item.value()["idf"];
-        for (const auto &pair : item.value()["doc_tf_idf"])
-            element.doc_tf_idf.emplace_back(pair[0], pair[1]);
-        map_ele[item.key()] = element;
+std::map<int, float> FileBasedLoader::load_norms(const std::string &index_path_dir, bool title) {
+    std::map<int, float> norms;
+    MappedFile file(index_path_dir + (title ? "title_" : "") + "norms.bin");
+    if (!file.is_open() || file.size() == 0)
+        return norms;
+    try {
+        BinaryReader reader(file.data(), file.size());
+        auto count = reader.read<uint64_t>();
+        if (count > reader.remaining() / (sizeof(int) + sizeof(float)))
+            throw std::runtime_error("[ERROR]: Corrupted norms file!");
+        std::vector<int> doc_ids(count);
+        std::vector<float> values(count);
+        reader.read_array(doc_ids.data(), count);
+        reader.read_array(values.data(), count);
+        for (size_t i = 0; i < count; i++)
+            norms.emplace_hint(norms.end(), doc_ids[i], values[i]);
+    } catch (const std::runtime_error &e) {
+        std::cerr << e.what() << std::endl;
+        norms.clear();
     }
-    return map_ele;
+    return norms;
 }
 
-void FileBasedLoader::save_tf_idf_norms(const std::map<int, std::map<std::string, float>> &tf_idf_docs, const std::string &index_path_dir, bool title) {
-    json j;
-    for (const auto &[doc_id, doc_tf_idf] : tf_idf_docs) {
-        float norm = 0;
-        for (const auto &[word, value] : doc_tf_idf)
-            norm += value * value;
-        j[std::to_string(doc_id)] = std::sqrt(norm);
+void FileBasedLoader::save_positions_index(const std::map<std::string, std::map<int, std::vector<int>>> &positions_map, const std::string &index_path_dir) {
+    std::vector<std::string> words;
+    std::vector<term_entry> entries;
+    words.reserve(positions_map.size());
+    entries.reserve(positions_map.size());
+    std::ofstream postings(index_path_dir + "positions.postings", std::ios::binary);
+    uint64_t offset = 0;
+    for (const auto &[word, doc_positions] : positions_map) {
+        /* Same compact layout as the in-memory positional index */
+        PositionList list;
+        for (const auto &[doc_id, positions] : doc_positions)
+            list.set(doc_id, positions);
+        BinaryWriter block;
+        list.to_binary(block);
+        postings.write(block.data().data(), static_cast<std::streamsize>(block.size()));
+
+        words.emplace_back(word);
+        entries.push_back({0, 0, 0, 0, offset, block.size()});
+        offset += block.size();
     }
-    std::ofstream output;
-    if (title)
-        output.open(index_path_dir + "title_norms.json");
-    else
-        output.open(index_path_dir + "norms.json");
-    output << j.dump(1);
+    postings.close();
+    TermDictionary::save(index_path_dir + "positions.dict", words, entries);
+}
+
+std::string FileBasedLoader::create_staging_dir(const std::string &index_path_dir) {
+    /* Leftovers of an interrupted build are thrown away */
+    auto staging_dir = index_path_dir + "staging/";
+    std::filesystem::remove_all(staging_dir);
+    std::filesystem::create_directories(staging_dir);
+    return staging_dir;
+}
+
+void FileBasedLoader::install_index(const std::string &staging_dir, const std::string &index_path_dir) {
+    /* Half moved index is never taken as up to date */
+    remove_manifest(index_path_dir);
+    std::filesystem::create_directories(index_path_dir);
+    std::vector<std::filesystem::path> files;
+    for (const auto &entry : std::filesystem::directory_iterator(staging_dir))
+        if (entry.is_regular_file() && entry.path().filename() != "manifest.json")
+            files.emplace_back(entry.path());
+
+    /* rename() replaces the directory entry only, the old files live on until their last reader closes them */
+    for (const auto &file : files)
+        std::filesystem::rename(file, index_path_dir + file.filename().string());
+    if (std::filesystem::exists(staging_dir + "manifest.json"))
+        std::filesystem::rename(staging_dir + "manifest.json", index_path_dir + "manifest.json");
+    std::filesystem::remove_all(staging_dir);
+}
+
+uint64_t FileBasedLoader::content_hash(const std::string &index_path_dir) {
+    /* Files are hashed separately, missing file counts as an empty one */
+    std::vector<uint64_t> hashes;
+    for (const auto &name : {"doc_cache.json", "tokenized_docs.json", "positions_map.json"}) {
+        MappedFile file(index_path_dir + name);
+        hashes.emplace_back(file.is_open() ? BinaryWriter::checksum(file.data(), file.size()) : 0);
+    }
+    return BinaryWriter::checksum(reinterpret_cast<const char *>(hashes.data()), hashes.size() * sizeof(uint64_t));
+}
+
+void FileBasedLoader::save_manifest(const std::string &index_path_dir) {
+    DocStore docs(index_path_dir + "docs.dict", index_path_dir + "docs.store");
+    json manifest = {
+        {"version", MANIFEST_VERSION},
+        {"doc_count", docs.size()},
+        {"content_hash", content_hash(index_path_dir)},
+        {"lemma", USE_LEMMA},
+        {"detect_lang", DETECT_LANG}
+    };
+    std::ofstream output(index_path_dir + "manifest.json");
+    output << manifest.dump(4);
     output.close();
 }
 
-std::map<int, float> FileBasedLoader::load_tf_idf_norms(const std::string &index_path_dir, bool title) {
-    std::ifstream input;
-    if (title)
-        input.open(index_path_dir + "title_norms.json");
-    else
-        input.open(index_path_dir + "norms.json");
-    json j;
-    input >> j;
+bool FileBasedLoader::load_manifest(const std::string &index_path_dir, index_manifest &manifest) {
+    std::ifstream input(index_path_dir + "manifest.json");
+    if (!input.is_open())
+        return false;
+    auto data = json::parse(input, nullptr, false);
     input.close();
-    std::map<int, float> norms;
-    for (const auto &item : j.items())
-        norms[std::stoi(item.key())] = item.value();
-    return norms;
+    if (data.is_discarded() || !data.is_object())
+        return false;
+    try {
+        manifest.version = data.at("version").get<uint32_t>();
+        manifest.doc_count = data.at("doc_count").get<size_t>();
+        manifest.content_hash = data.at("content_hash").get<uint64_t>();
+        manifest.lemma = data.at("lemma").get<bool>();
+        manifest.detect_lang = data.at("detect_lang").get<bool>();
+    } catch (const json::exception &e) {
+        return false;
+    }
+    return true;
+}
+
+void FileBasedLoader::remove_manifest(const std::string &index_path_dir) {
+    std::filesystem::remove(index_path_dir + "manifest.json");
 }
 
+bool FileBasedLoader::is_up_to_date(const std::string &index_path_dir) {
+    index_manifest manifest;
+    if (!load_manifest(index_path_dir, manifest)) {
+        std::cout << "Index " << index_path_dir << " has no manifest" << std::endl;
+        return false;
+    }
+    if (manifest.version != MANIFEST_VERSION) {
+        std::cout << "Index " << index_path_dir << " was built by another version" << std::endl;
+        return false;
+    }
+    /* Languages detected once stay in the documents, so only the missing detection is a reason to rebuild */
+    if (DETECT_LANG && !manifest.detect_lang) {
+        std::cout << "Index " << index_path_dir << " was built without language detection" << std::endl;
+        return false;
+    }
+    /* Documents are not preprocessed again by the rebuild, so it would not help */
+    if (manifest.lemma != USE_LEMMA)
+        std::cerr << "[ERROR]: Index " << index_path_dir << " was built with " << (manifest.lemma ? "lemmatization" : "stemming") << ", but the queries use " << (USE_LEMMA ? "lemmatization" : "stemming") << "!" << std::endl;
 
+    for (const auto &name : INDEX_FILES) {
+        if (!std::filesystem::exists(index_path_dir + name)) {
+            std::cout << "Index " << index_path_dir << " is missing " << name << std::endl;
+            return false;
+        }
+    }
+    if (DocStore(index_path_dir + "docs.dict", index_path_dir + "docs.store").size() != manifest.doc_count || content_hash(index_path_dir) != manifest.content_hash) {
+        std::cout << "Index " << index_path_dir << " is stale" << std::endl;
+        return false;
+    }
+    return true;
+}
@@ -1,14 +1,38 @@
 #pragma once
 
+#include <array>
 #include <fstream>
+#include <filesystem>
+#include <functional>
 #include <nlohmann/json.hpp>
 #include "Document.h"
 #include "TF_IDF.h"
+#include "PositionList.h"
+#include "BinaryIO.h"
+#include "TermDictionary.h"
+#include "DocStore.h"
+#include "Const.h"
 
 using json = nlohmann::json;
 
 struct map_element;
 
+/**
+ * Manifest of the file based index (the index is not rebuilt while the manifest matches the index directory)
+ */
+struct index_manifest {
+    /** Version of the file based index format */
+    uint32_t version = 0;
+    /** Number of the indexed documents */
+    size_t doc_count = 0;
+    /** Checksum of the documents, tokenized documents and positions the index was built from */
+    uint64_t content_hash = 0;
+    /** Whether the documents were lemmatized (or stemmed) */
+    bool lemma = true;
+    /** Whether the languages of the documents were detected */
+    bool detect_lang = false;
+};
+
 /**
  * Class for loading and saving the file based index files
  */
@@ -20,13 +44,75 @@ public:
 
     static void save_tokenized_docs(const std::vector<TokenizedDocument> &docs, const std::string &index_path_dir);
     static std::vector<TokenizedDocument> load_tokenized_docs(const std::string &index_path_dir);
+    /**
+     * Call the callback for every tokenized document, the documents are parsed one at a time (the file is never held whole)
+     * @param index_path_dir Path to the directory with the index
+     * @param callback Callback
+     */
+    static void for_each_tokenized_doc(const std::string &index_path_dir, const std::function<void(const TokenizedDocument &)> &callback);
 
     static void save_positions_map(const std::map<std::string, std::map<int, std::vector<int>>> &positions_map, const std::string &index_path_dir);
     static std::map<std::string, std::map<int, std::vector<int>>> load_positions_map(const std::string &index_path_dir);
 
-    static void save_tf_idf(const std::map<int, std::map<std::string, float>> &tf_idf_docs, std::map<std::string, float> &idf, const std::string &index_path_dir, bool title = false);
-    static std::map<std::string, map_element> load_tf_idf(const std::string &index_path_dir, bool title = false);
+    /**
+     * Save the document norms
+     * @param doc_ids Document IDs (sorted)
+     * @param norms Norms of the documents (same order as the IDs)
+     * @param index_path_dir Path to the directory with the index
+     * @param title Whether the norms are for titles
+     */
+    static void save_norms(const std::vector<int> &doc_ids, const std::vector<float> &norms, const std::string &index_path_dir, bool title = false);
+    static std::map<int, float> load_norms(const std::string &index_path_dir, bool title = false);
+
+    static void save_positions_index(const std::map<std::string, std::map<int, std::vector<int>>> &positions_map, const std::string &index_path_dir);
+
+    /** Version of the file based index format (bump whenever the built files change) */
+    static constexpr uint32_t MANIFEST_VERSION = 1;
+    /** Files built from the documents (replaced as a whole by a rebuild) */
+    static constexpr std::array<const char *, 10> INDEX_FILES = {"tf_idf.dict", "tf_idf.postings", "title_tf_idf.dict", "title_tf_idf.postings", "norms.bin", "title_norms.bin", "positions.dict", "positions.postings", "docs.dict", "docs.store"};
+
+    /**
+     * Get the directory a rebuild of the index writes its files to (a fresh empty directory is created)
+     * @param index_path_dir Path to the directory with the index
+     * @return Path to the staging directory
+     */
+    static std::string create_staging_dir(const std::string &index_path_dir);
+    /**
+     * Move all the files from the staging directory into the index directory (the staging directory is removed)
+     * Every file is renamed over the old one, so readers that have the old files open or mapped keep reading them,
+     * the manifest is moved last
+     * @param staging_dir Path to the staging directory
+     * @param index_path_dir Path to the directory with the index
+     */
+    static void install_index(const std::string &staging_dir, const std::string &index_path_dir);
 
-    static void save_tf_idf_norms(const std::map<int, std::map<std::string, float>> &tf_idf_docs, const std::string &index_path_dir, bool title = false);
-    static std::map<int, float> load_tf_idf_norms(const std::string &index_path_dir, bool title = false);
+    /**
+     * Checksum of the files the index is built from (documents, tokenized documents and positions)
+     * @param index_path_dir Path to the directory with the index
+     * @return Checksum
+     */
+    static uint64_t content_hash(const std::string &index_path_dir);
+    /**
+     * Save the manifest of the freshly built index
+     * @param index_path_dir Path to the directory with the index
+     */
+    static void save_manifest(const std::string &index_path_dir);
+    /**
+     * Load the manifest of the index
+     * @param index_path_dir Path to the directory with the index
+     * @param manifest Loaded manifest
+     * @return False if there is no valid manifest
+     */
+    static bool load_manifest(const std::string &index_path_dir, index_manifest &manifest);
+    /**
+     * Remove the manifest (the index is being rebuilt, an interrupted build is never taken as up to date)
+     * @param index_path_dir Path to the directory with the index
+     */
+    static void remove_manifest(const std::string &index_path_dir);
+    /**
+     * Check whether the index was built from the current files with the current parameters
+     * @param index_path_dir Path to the directory with the index
+     * @return True if the index does not have to be rebuilt
+     */
+    static bool is_up_to_date(const std::string &index_path_dir);
 };
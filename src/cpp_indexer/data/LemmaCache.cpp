@@ -0,0 +1,93 @@
+#include "LemmaCache.h"
+
+#include <functional>
+
+LemmaCache::LemmaCache(size_t capacity) : shards(), hits(0), misses(0) {
+    for (size_t i = 0; i < SHARDS; i++)
+        this->shards.emplace_back(std::make_unique<cache_shard>(capacity / SHARDS));
+}
+
+LemmaCache::cache_shard &LemmaCache::get_shard(const std::string &word) const {
+    return *this->shards[std::hash<std::string>{}(word) % SHARDS];
+}
+
+size_t LemmaCache::entry_size(const std::string &word, const std::string &lemma) {
+    return 2 * word.size() + lemma.size() + 128;
+}
+
+bool LemmaCache::get(const std::string &word, std::string &lemma) {
+    auto &shard = this->get_shard(word);
+    std::shared_ptr<const std::string> cached;
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        cached = shard.cache.get(word);
+    }
+    if (!cached) {
+        this->misses.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    this->hits.fetch_add(1, std::memory_order_relaxed);
+    lemma = *cached;
+    return true;
+}
+
+void LemmaCache::put(const std::string &word, const std::string &lemma) {
+    auto value = std::make_shared<const std::string>(lemma);
+    auto &shard = this->get_shard(word);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    shard.cache.put(word, std::move(value), entry_size(word, lemma));
+}
+
+void LemmaCache::clear() {
+    for (auto &shard : this->shards) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        shard->cache.clear();
+    }
+    this->hits = 0;
+    this->misses = 0;
+}
+
+uint64_t LemmaCache::get_hits() const {
+    return this->hits.load(std::memory_order_relaxed);
+}
+
+uint64_t LemmaCache::get_misses() const {
+    return this->misses.load(std::memory_order_relaxed);
+}
+
+double LemmaCache::get_hit_rate() const {
+    auto lookups = this->get_hits() + this->get_misses();
+    return lookups ? static_cast<double>(this->get_hits()) / static_cast<double>(lookups) : 0;
+}
+
+size_t LemmaCache::size() const {
+    size_t count = 0;
+    for (const auto &shard : this->shards) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        count += shard->cache.count();
+    }
+    return count;
+}
+
+void LemmaCache::to_binary(BinaryWriter &writer) const {
+    std::vector<std::string> words;
+    std::vector<std::string> lemmas;
+    for (const auto &shard : this->shards) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        shard->cache.for_each([&words, &lemmas](const std::string &word, const std::string &lemma) {
+            words.emplace_back(word);
+            lemmas.emplace_back(lemma);
+        });
+    }
+    writer.write_strings(words);
+    writer.write_strings(lemmas);
+}
+
+void LemmaCache::from_binary(BinaryReader &reader) {
+    auto words = reader.read_strings();
+    auto lemmas = reader.read_strings();
+    if (words.size() != lemmas.size())
+        throw std::runtime_error("[ERROR]: Corrupted lemma cache!");
+    for (size_t i = 0; i < words.size(); i++)
+        this->put(words[i], lemmas[i]);
+}
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <memory>
+#include <atomic>
+#include <cstdint>
+#include "BinaryIO.h"
+#include "LruCache.h"
+
+/**
+ * Cache of surface form -> lemma (or stem)
+ * Split into shards with their own locks, so the preprocessing threads rarely wait for each other,
+ * every shard is a bounded LRU cache
+ */
+class LemmaCache {
+private:
+    /**
+     * Shard of the cache
+     */
+    struct cache_shard {
+        /** Lock of the shard */
+        std::mutex mutex;
+        /** Cached lemmas */
+        LruCache<std::string> cache;
+
+        /**
+         * Constructor for the cache_shard struct
+         * @param capacity Maximum size of the shard in bytes
+         */
+        explicit cache_shard(size_t capacity) : mutex(), cache(capacity) {
+            /* Nothing to do here :) */
+        }
+    };
+
+    /** Shards of the cache */
+    std::vector<std::unique_ptr<cache_shard>> shards;
+    /** Number of lookups that found the word */
+    std::atomic<uint64_t> hits;
+    /** Number of lookups that did not find the word */
+    std::atomic<uint64_t> misses;
+
+    /**
+     * Get the shard of the given word
+     * @param word Word
+     * @return Shard
+     */
+    cache_shard &get_shard(const std::string &word) const;
+    /**
+     * Approximate size of a cached entry in bytes (key is stored twice, plus the list and hash nodes)
+     * @param word Word
+     * @param lemma Lemma
+     * @return Size in bytes
+     */
+    static size_t entry_size(const std::string &word, const std::string &lemma);
+
+public:
+    /** Number of shards */
+    static constexpr size_t SHARDS = 16;
+    /** Default size of the whole cache in bytes */
+    static constexpr size_t CACHE_SIZE = 32 * 1024 * 1024;
+
+    /**
+     * Constructor for the LemmaCache class
+     * @param capacity Maximum size of the whole cache in bytes
+     */
+    explicit LemmaCache(size_t capacity = CACHE_SIZE);
+
+    /**
+     * Get the cached lemma of the given word
+     * @param word Word
+     * @param lemma Cached lemma
+     * @return True if the word was cached
+     */
+    bool get(const std::string &word, std::string &lemma);
+    /**
+     * Cache the lemma of the given word
+     * @param word Word
+     * @param lemma Lemma
+     */
+    void put(const std::string &word, const std::string &lemma);
+    /**
+     * Remove everything from the cache and reset the counters
+     */
+    void clear();
+
+    /**
+     * Get the number of lookups that found the word
+     * @return Number of hits
+     */
+    [[nodiscard]] uint64_t get_hits() const;
+    /**
+     * Get the number of lookups that did not find the word
+     * @return Number of misses
+     */
+    [[nodiscard]] uint64_t get_misses() const;
+    /**
+     * Get the ratio of hits to all lookups
+     * @return Hit rate (0 if there were no lookups)
+     */
+    [[nodiscard]] double get_hit_rate() const;
+    /**
+     * Get the number of cached words
+     * @return Number of cached words
+     */
+    [[nodiscard]] size_t size() const;
+
+    /**
+     * Cache to the binary format (entries from the least to the most recently used)
+     * @param writer Binary writer
+     */
+    void to_binary(BinaryWriter &writer) const;
+    /**
+     * Load cache from the binary format (entries are added to the current ones)
+     * @param reader Binary reader
+     */
+    void from_binary(BinaryReader &reader);
+};
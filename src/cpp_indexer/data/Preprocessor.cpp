@@ -36,14 +36,45 @@ std::map<std::string, std::string> czech_special_characters = {
 std::string czech_special_characters_lookup = "ÁČĎÉĚÍŇÓŘŠŤÚŮÝŽáčďéěíňóřšťúůýž";
 std::string special_characters = "-_\"\'@#&$~•";
 
-/** Regular expression for wildcard words */
-std::regex wildcard_word_regex = std::regex(R"(\w+\*|\*\w+|\w+\*\w+)");
-/** Regular expression for URL */
-std::regex url_regex = std::regex(R"((https?|ftp):\/\/[^\s/$.?#].[^\s]*)");
-/** Regular expression for date */
-std::regex date_regex = std::regex(R"(\d{1,2}\.\s?\d{1,2}\.\s?(\d{4})?)");
-/** Regular expression for time */
-std::regex time_regex = std::regex(R"(\d{1,2}:\d{1,2})");
+/**
+ * Character classes of the "C" locale (the text is treated as bytes, UTF-8 characters are never letters, digits or punctuation)
+ */
+static inline bool is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\v' || c == '\f' || c == '\r';
+}
+static inline bool is_digit(char c) {
+    return c >= '0' && c <= '9';
+}
+static inline bool is_alpha(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+}
+static inline bool is_word(char c) {
+    return is_digit(c) || is_alpha(c) || c == '_';
+}
+static inline bool is_punct(char c) {
+    return (c >= '!' && c <= '/') || (c >= ':' && c <= '@') || (c >= '[' && c <= '`') || (c >= '{' && c <= '~');
+}
+
+/**
+ * Skip one or two digits
+ * @param token Token
+ * @param pos Position in the token (moved after the digits)
+ * @return True if there were one or two digits
+ */
+static inline bool skip_one_or_two_digits(std::string_view token, size_t &pos) {
+    size_t start = pos;
+    while (pos < token.size() && pos - start < 2 && is_digit(token[pos]))
+        pos++;
+    return pos > start;
+}
+
+/** Magic bytes of the cache file */
+static constexpr char CACHE_MAGIC[4] = {'Z', 'L', 'E', 'M'};
+/** Version of the cache file format */
+static constexpr uint32_t CACHE_VERSION = 1;
+
+LemmaCache Preprocessor::stem_cache = LemmaCache();
+LemmaCache Preprocessor::lemma_cache = LemmaCache();
 
 Preprocessor::Preprocessor() {
     /* Prepare instances of stemmer and lemmatizer */
@@ -132,84 +163,115 @@ std::string &Preprocessor::remove_special_characters(std::string &text) {
     return text;
 }
 
-std::pair<std::vector<std::string>, std::map<std::string, std::vector<int>>> Preprocessor::tokenize(const std::string &text) {
-    std::vector<std::string> tokens;
-    std::map<std::string, std::vector<int>> token_positions;
-    std::istringstream iss(text);
-    std::string token;
+bool Preprocessor::is_wildcard_word(std::string_view token) {
+    /* One star and word characters around it (at least one) */
+    if (token.size() < 2 || std::count(token.begin(), token.end(), '*') != 1)
+        return false;
+    return std::all_of(token.begin(), token.end(), [](char c) { return c == '*' || is_word(c); });
+}
 
-    while (iss >> token) {
-        /* Skip special tokens and save them right away */
-        if (std::regex_match(token, wildcard_word_regex) || std::regex_match(token, url_regex) ||
-            std::regex_match(token, date_regex) || std::regex_match(token, time_regex)) {
-            tokens.push_back(token);
-            token_positions[token].push_back(static_cast<int>(tokens.size() - 1));
-            continue;
-        }
+bool Preprocessor::is_url(std::string_view token) {
+    size_t scheme;
+    if (token.substr(0, 7) == "http://")
+        scheme = 7;
+    else if (token.substr(0, 8) == "https://")
+        scheme = 8;
+    else if (token.substr(0, 6) == "ftp://")
+        scheme = 6;
+    else
+        return false;
+    /* At least two more characters, the first of them can not start a path, query or fragment */
+    return token.size() >= scheme + 2 && std::string_view("/$.?#").find(token[scheme]) == std::string_view::npos;
+}
 
-        /* Remove punctuation, brackets ... */
-        token.erase(std::remove_if(token.begin(), token.end(), [](unsigned char x) { return std::ispunct(x); }), token.end());
+bool Preprocessor::is_date(std::string_view token) {
+    size_t pos = 0;
+    if (!skip_one_or_two_digits(token, pos) || pos >= token.size() || token[pos++] != '.')
+        return false;
+    if (!skip_one_or_two_digits(token, pos) || pos >= token.size() || token[pos++] != '.')
+        return false;
+    /* Optional four digit year */
+    auto year = token.substr(pos);
+    return year.empty() || (year.size() == 4 && std::all_of(year.begin(), year.end(), is_digit));
+}
 
-        if (token.empty())
-            continue;
+bool Preprocessor::is_time(std::string_view token) {
+    size_t pos = 0;
+    if (!skip_one_or_two_digits(token, pos) || pos >= token.size() || token[pos++] != ':')
+        return false;
+    return skip_one_or_two_digits(token, pos) && pos == token.size();
+}
 
-        /* If token contains std::isspace, split it into more tokens */
-        if (std::any_of(token.begin(), token.end(), [](char c) { return std::isspace(c); })) {
-            while (std::regex_search(token, std::regex(R"(\s+)")))
-                token = std::regex_replace(token, std::regex(R"(\s+)"), "<temp>");
+std::pair<std::vector<std::string>, std::map<std::string, std::vector<int>>> Preprocessor::tokenize(std::string_view text) {
+    std::vector<std::string> tokens;
+    std::map<std::string, std::vector<int>> token_positions;
+    /* Token without punctuation, reused for all the tokens */
+    std::string cleaned;
 
-            while (std::regex_search(token, std::regex(R"(<temp>)")))
-                token = std::regex_replace(token, std::regex(R"(<temp>)"), " ");
+    auto emit = [&tokens, &token_positions](std::string_view token) {
+        tokens.emplace_back(token);
+        token_positions[tokens.back()].push_back(static_cast<int>(tokens.size() - 1));
+    };
 
-            std::istringstream iss2(token);
-            std::string new_token;
-            while (iss2 >> new_token) {
-                tokens.push_back(new_token);
-                token_positions[new_token].push_back(static_cast<int>(tokens.size() - 1));
-            }
+    size_t pos = 0;
+    while (pos < text.size()) {
+        /* Tokens are separated by whitespace */
+        while (pos < text.size() && is_space(text[pos]))
+            pos++;
+        size_t start = pos;
+        while (pos < text.size() && !is_space(text[pos]))
+            pos++;
+        if (start == pos)
+            break;
+        auto token = text.substr(start, pos - start);
 
+        /* Keep special tokens as they are */
+        if (is_wildcard_word(token) || is_url(token) || is_date(token) || is_time(token)) {
+            emit(token);
             continue;
         }
 
-        /* If token is a combination of letters and numbers, split them into more tokens e.g.: 1a2b -> 1 a 2 b */
-        if (std::any_of(token.begin(), token.end(), [](char c) { return std::isdigit(c); }) &&
-            std::any_of(token.begin(), token.end(), [](char c) { return std::isalpha(c); })) {
-
-            std::string new_token;
-            for (const auto & c : token) {
-                if (std::isdigit(c) && !new_token.empty() && std::isalpha(new_token.back()))
-                    new_token += " ";
-                else if (std::isalpha(c) && !new_token.empty() && std::isdigit(new_token.back()))
-                    new_token += " ";
-                new_token += c;
-            }
+        /* Remove punctuation, brackets ... */
+        cleaned.clear();
+        bool has_digit = false;
+        bool has_alpha = false;
+        for (const auto &c : token) {
+            if (is_punct(c))
+                continue;
+            cleaned += c;
+            has_digit |= is_digit(c);
+            has_alpha |= is_alpha(c);
+        }
 
-            std::istringstream iss(new_token);
-            std::string new_subtoken;
-            while (iss >> new_subtoken) {
-                tokens.push_back(new_subtoken);
-                token_positions[new_subtoken].push_back(static_cast<int>(tokens.size() - 1));
-            }
+        if (cleaned.empty())
+            continue;
 
+        /* If token is a combination of letters and numbers, split them into more tokens e.g.: 1a2b -> 1 a 2 b */
+        if (has_digit && has_alpha) {
+            size_t part_start = 0;
+            for (size_t i = 1; i < cleaned.size(); i++)
+                if ((is_digit(cleaned[i]) && is_alpha(cleaned[i - 1])) || (is_alpha(cleaned[i]) && is_digit(cleaned[i - 1]))) {
+                    emit(std::string_view(cleaned).substr(part_start, i - part_start));
+                    part_start = i;
+                }
+            emit(std::string_view(cleaned).substr(part_start));
             continue;
         }
 
-        tokens.push_back(token);
-        token_positions[token].push_back(static_cast<int>(tokens.size() - 1));
+        emit(cleaned);
     }
 
-//    for (auto & token : tokens) {
-//        /* if token containts white space print it */
-//        if (std::regex_match(token, std::regex(R"(\s+)")))
-//            std::cout << "Token: " << token << std::endl;
-//    }
-
     return {tokens, token_positions};
 }
 
 std::string Preprocessor::stem(const std::string& word) {
+    std::string stemmed_word;
+    if (stem_cache.get(word, stemmed_word))
+        return stemmed_word;
     const sb_symbol *stemmed = sb_stemmer_stem(this->stemmer, reinterpret_cast<const sb_symbol *>(word.c_str()), static_cast<int>(word.size()));
-    return (reinterpret_cast<const char *>(stemmed));
+    stemmed_word = reinterpret_cast<const char *>(stemmed);
+    stem_cache.put(word, stemmed_word);
+    return stemmed_word;
 }
 
 std::vector<std::string> Preprocessor::stem(const std::vector<std::string>& words) {
@@ -222,9 +284,13 @@ std::vector<std::string> Preprocessor::stem(const std::vector<std::string>& word
 }
 
 std::string Preprocessor::lemmatize(const std::string& word) {
+    std::string lemma_str;
+    if (lemma_cache.get(word, lemma_str))
+        return lemma_str;
     char *lemmatized = this->lemmatizer->Lemmatize(word.c_str(), nullptr);
-    std::string lemma_str = std::string(lemmatized);
+    lemma_str = std::string(lemmatized);
     free(lemmatized);
+    lemma_cache.put(word, lemma_str);
     return lemma_str;
 }
 
@@ -285,6 +351,63 @@ std::pair<std::vector<std::string>, std::map<std::string, std::vector<int>>> Pre
     return preprocess_text(combined, content);
 }
 
+LemmaCache &Preprocessor::get_cache() {
+    return USE_LEMMA ? lemma_cache : stem_cache;
+}
+
+bool Preprocessor::save_cache(const std::string &path) {
+    BinaryWriter payload;
+    stem_cache.to_binary(payload);
+    lemma_cache.to_binary(payload);
+
+    BinaryWriter writer;
+    writer.write_array(CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    writer.write(CACHE_VERSION);
+    writer.write(static_cast<uint64_t>(payload.size()));
+    writer.write(BinaryWriter::checksum(payload.data().data(), payload.size()));
+    writer.write_array(payload.data().data(), payload.size());
+
+    std::ofstream output(path, std::ios::binary);
+    if (!output) {
+        std::cerr << "[ERROR]: Failed to save lemma cache to " << path << "!" << std::endl;
+        return false;
+    }
+    output.write(writer.data().data(), static_cast<std::streamsize>(writer.size()));
+    return true;
+}
+
+bool Preprocessor::load_cache(const std::string &path) {
+    if (!std::filesystem::exists(path))
+        return false;
+    MappedFile file(path);
+    if (!file.is_open())
+        return false;
+
+    try {
+        BinaryReader reader(file.data(), file.size());
+        const char *magic = reader.skip(sizeof(CACHE_MAGIC));
+        if (std::memcmp(magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0 || reader.read<uint32_t>() != CACHE_VERSION) {
+            std::cerr << "[ERROR]: Invalid lemma cache " << path << "!" << std::endl;
+            return false;
+        }
+        auto payload_size = reader.read<uint64_t>();
+        auto checksum = reader.read<uint64_t>();
+        if (payload_size != reader.remaining())
+            throw std::runtime_error("[ERROR]: Corrupted lemma cache " + path + "!");
+        const char *payload = reader.skip(payload_size);
+        if (BinaryWriter::checksum(payload, payload_size) != checksum)
+            throw std::runtime_error("[ERROR]: Corrupted lemma cache " + path + "!");
+
+        BinaryReader payload_reader(payload, payload_size);
+        stem_cache.from_binary(payload_reader);
+        lemma_cache.from_binary(payload_reader);
+    } catch (const std::runtime_error &e) {
+        std::cerr << e.what() << std::endl;
+        return false;
+    }
+    return true;
+}
+
 int Preprocessor::bool_op_precedence(const string &op) {
     if (op == operators_map[Operator::NOT])
         return 3;
@@ -1,7 +1,12 @@
 #pragma once
 
 #include <string>
-#include <regex>
+#include <string_view>
+#include <filesystem>
+#include <sstream>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
 #include <vector>
 #include <utility>
 #include <numeric>
@@ -10,6 +15,7 @@
 #include <tuple>
 
 #include "Const.h"
+#include "LemmaCache.h"
 #include "libstemmer.h"
 #include "RdrLemmatizer.h"
 #include "sl_lemmatizer.h"
@@ -49,6 +55,10 @@ private:
     const std::string stopwords_file = "../src/czech.stop";
     /** Stopwords */
     std::set<std::string> stopwords;
+    /** Cache of stems (shared by all the preprocessors) */
+    static LemmaCache stem_cache;
+    /** Cache of lemmas (shared by all the preprocessors) */
+    static LemmaCache lemma_cache;
 
     /**
      * Prepare the stemmer for the given language
@@ -68,6 +78,31 @@ private:
      */
     bool load_stopwords();
 
+    /**
+     * Check whether the token is a wildcard word (word*, *word or wo*rd)
+     * @param token Token
+     * @return True if the token is a wildcard word
+     */
+    static bool is_wildcard_word(std::string_view token);
+    /**
+     * Check whether the token is a URL (http, https or ftp)
+     * @param token Token
+     * @return True if the token is a URL
+     */
+    static bool is_url(std::string_view token);
+    /**
+     * Check whether the token is a date (d.m. or d.m.yyyy, one or two digit day and month)
+     * @param token Token
+     * @return True if the token is a date
+     */
+    static bool is_date(std::string_view token);
+    /**
+     * Check whether the token is a time (h:m, one or two digits each)
+     * @param token Token
+     * @return True if the token is a time
+     */
+    static bool is_time(std::string_view token);
+
     /**
      * Get the precedence of the given boolean operator
      * @param op Boolean operator
@@ -105,12 +140,14 @@ public:
     std::string &remove_special_characters(std::string &text);
     /**
      * Tokenize the given text and return the tokens with their positions
+     * Single pass over the text, special tokens (wildcard words, URLs, dates, times) are kept whole,
+     * punctuation is removed from the rest and letters are split from digits (e.g.: 1a2b -> 1 a 2 b)
      * @param text Input text
      * @return Tokens
      */
-    std::pair<std::vector<std::string>, std::map<std::string, std::vector<int>>> tokenize(const std::string &text);
+    std::pair<std::vector<std::string>, std::map<std::string, std::vector<int>>> tokenize(std::string_view text);
     /**
-     * Stem the given word
+     * Stem the given word (cached)
      * @param word Input word
      * @return Stemmed word
      */
@@ -122,7 +159,7 @@ public:
      */
     std::vector<std::string> stem(const std::vector<std::string> &words);
     /**
-     * Lemmatize the given word
+     * Lemmatize the given word (cached)
      * @param word Input word
      * @return Lemmatized word
      */
@@ -160,6 +197,24 @@ public:
      */
     std::pair<std::vector<std::string>, std::map<std::string, std::vector<int>>> preprocess_text(const std::vector<std::string> &text, bool content=false);
 
+    /**
+     * Get the cache of the current mode (stems or lemmas)
+     * @return Cache
+     */
+    static LemmaCache &get_cache();
+    /**
+     * Save the stem and lemma caches to the given file
+     * @param path Filepath to the cache file
+     * @return True if the caches were saved
+     */
+    static bool save_cache(const std::string &path);
+    /**
+     * Load the stem and lemma caches from the given file (missing file is not an error)
+     * @param path Filepath to the cache file
+     * @return True if the caches were loaded
+     */
+    static bool load_cache(const std::string &path);
+
     /**
      * Parse the given boolean query into postfix notation
      * @param query Boolean query
@@ -0,0 +1,87 @@
+#include "TermDictionary.h"
+
+#include <fstream>
+#include <iostream>
+
+/** Size of the file header (magic, version, number of entries) */
+static constexpr size_t HEADER_SIZE = sizeof(TermDictionary::MAGIC) + sizeof(uint32_t) + sizeof(uint64_t);
+
+TermDictionary::TermDictionary(const std::string &path) : file(path), count(0), entries(nullptr), words(nullptr), words_size(0) {
+    if (!this->file.is_open() || this->file.size() < HEADER_SIZE)
+        return;
+
+    try {
+        BinaryReader reader(this->file.data(), this->file.size());
+        const char *magic = reader.skip(sizeof(MAGIC));
+        if (std::memcmp(magic, MAGIC, sizeof(MAGIC)) != 0 || reader.read<uint32_t>() != VERSION) {
+            std::cerr << "[ERROR]: Invalid term dictionary " << path << "!" << std::endl;
+            return;
+        }
+        auto entries_count = reader.read<uint64_t>();
+        if (entries_count > reader.remaining() / sizeof(term_entry))
+            throw std::runtime_error("[ERROR]: Corrupted term dictionary " + path + "!");
+        this->entries = reader.skip(entries_count * sizeof(term_entry));
+        this->words_size = reader.remaining();
+        this->words = reader.skip(this->words_size);
+        this->count = entries_count;
+    } catch (const std::runtime_error &e) {
+        std::cerr << e.what() << std::endl;
+        this->count = 0;
+    }
+}
+
+term_entry TermDictionary::entry(size_t i) const {
+    term_entry result{};
+    std::memcpy(&result, this->entries + i * sizeof(term_entry), sizeof(term_entry));
+    return result;
+}
+
+std::string_view TermDictionary::word(const term_entry &element) const {
+    if (static_cast<size_t>(element.word_offset) + element.word_length > this->words_size)
+        return {};
+    return {this->words + element.word_offset, element.word_length};
+}
+
+bool TermDictionary::find(const std::string &word, term_entry &result) const {
+    size_t low = 0;
+    size_t high = this->count;
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        auto candidate = this->entry(mid);
+        auto candidate_word = this->word(candidate);
+        if (candidate_word < word) {
+            low = mid + 1;
+        } else if (candidate_word > word) {
+            high = mid;
+        } else {
+            result = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+size_t TermDictionary::size() const {
+    return this->count;
+}
+
+void TermDictionary::save(const std::string &path, const std::vector<std::string> &words, std::vector<term_entry> &entries) {
+    BinaryWriter writer;
+    writer.write_array(MAGIC, sizeof(MAGIC));
+    writer.write(VERSION);
+    writer.write(static_cast<uint64_t>(entries.size()));
+
+    uint32_t word_offset = 0;
+    for (size_t i = 0; i < entries.size(); i++) {
+        entries[i].word_offset = word_offset;
+        entries[i].word_length = static_cast<uint32_t>(words[i].size());
+        word_offset += entries[i].word_length;
+    }
+    writer.write_array(entries.data(), entries.size());
+    for (const auto &word : words)
+        writer.write_array(word.data(), word.size());
+
+    std::ofstream output(path, std::ios::binary);
+    output.write(writer.data().data(), static_cast<std::streamsize>(writer.size()));
+    output.close();
+}
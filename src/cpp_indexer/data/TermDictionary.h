@@ -0,0 +1,90 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include "BinaryIO.h"
+
+/**
+ * Entry of the on-disk term dictionary
+ * Entries have a fixed size, so the dictionary can be binary searched right in the mapped file
+ */
+struct term_entry {
+    /** Offset of the word in the block of words */
+    uint32_t word_offset;
+    /** Length of the word */
+    uint32_t word_length;
+    /** IDF of the word */
+    float idf;
+    /** Upper bound of TF-IDF / document norm (MaxScore) */
+    float max_score;
+    /** Offset of the word's data in the data file */
+    uint64_t offset;
+    /** Size of the word's data in bytes */
+    uint64_t size;
+};
+
+/**
+ * Sorted term dictionary of the file based index (memory mapped)
+ * File layout: magic, version, number of entries, entries sorted by word, block of words
+ */
+class TermDictionary {
+private:
+    /** Mapped dictionary file */
+    MappedFile file;
+    /** Number of entries */
+    size_t count;
+    /** Start of the entries */
+    const char *entries;
+    /** Start of the block of words */
+    const char *words;
+    /** Size of the block of words */
+    size_t words_size;
+
+    /**
+     * Get the entry at the given position
+     * @param i Position
+     * @return Entry
+     */
+    [[nodiscard]] term_entry entry(size_t i) const;
+    /**
+     * Get the word of the given entry
+     * @param element Entry
+     * @return Word
+     */
+    [[nodiscard]] std::string_view word(const term_entry &element) const;
+
+public:
+    /** Magic bytes of the dictionary file */
+    static constexpr char MAGIC[4] = {'Z', 'D', 'I', 'C'};
+    /** Version of the dictionary format */
+    static constexpr uint32_t VERSION = 3;
+
+    /**
+     * Open the dictionary (missing or invalid file gives an empty dictionary)
+     * @param path Path to the dictionary file
+     */
+    explicit TermDictionary(const std::string &path);
+
+    /**
+     * Find the word in the dictionary (binary search)
+     * @param word Word
+     * @param result Found entry
+     * @return True if the word was found
+     */
+    bool find(const std::string &word, term_entry &result) const;
+    /**
+     * Get the number of words in the dictionary
+     * @return Number of words
+     */
+    [[nodiscard]] size_t size() const;
+
+    /**
+     * Save the dictionary
+     * @param path Path to the dictionary file
+     * @param words Words sorted in ascending order
+     * @param entries Entries of the words (word offsets and lengths are filled in here)
+     */
+    static void save(const std::string &path, const std::vector<std::string> &words, std::vector<term_entry> &entries);
+};
@@ -0,0 +1,81 @@
+#include "Vocabulary.h"
+
+Vocabulary::Vocabulary() : words(), ids() {
+    /* Nothing to do here :) */
+}
+
+Vocabulary::Vocabulary(const Vocabulary &other) : words(other.words), ids() {
+    this->ids.reserve(this->words.size());
+    for (uint32_t i = 0; i < this->words.size(); i++)
+        this->ids.emplace(this->words[i], i);
+}
+
+Vocabulary &Vocabulary::operator=(const Vocabulary &other) {
+    if (this == &other)
+        return *this;
+    this->words = other.words;
+    this->ids.clear();
+    this->ids.reserve(this->words.size());
+    for (uint32_t i = 0; i < this->words.size(); i++)
+        this->ids.emplace(this->words[i], i);
+    return *this;
+}
+
+uint32_t Vocabulary::add(std::string_view word) {
+    auto it = this->ids.find(word);
+    if (it != this->ids.end())
+        return it->second;
+
+    auto term = static_cast<uint32_t>(this->words.size());
+    this->words.emplace_back(word);
+    this->ids.emplace(this->words.back(), term);
+    return term;
+}
+
+std::vector<uint32_t> Vocabulary::add(const std::vector<std::string> &words_) {
+    std::vector<uint32_t> terms;
+    terms.reserve(words_.size());
+    for (const auto &word : words_)
+        terms.emplace_back(this->add(word));
+    return terms;
+}
+
+uint32_t Vocabulary::find(std::string_view word) const {
+    auto it = this->ids.find(word);
+    return it == this->ids.end() ? NO_TERM : it->second;
+}
+
+const std::string &Vocabulary::get_word(uint32_t term) const {
+    return this->words[term];
+}
+
+std::vector<std::string> Vocabulary::get_words(const std::vector<uint32_t> &terms) const {
+    std::vector<std::string> result;
+    result.reserve(terms.size());
+    for (const auto &term : terms)
+        result.emplace_back(this->words[term]);
+    return result;
+}
+
+size_t Vocabulary::size() const {
+    return this->words.size();
+}
+
+term_document Vocabulary::encode(const TokenizedDocument &doc) {
+    term_document result;
+    result.id = doc.id;
+    result.title = this->add(doc.title);
+    result.toc = this->add(doc.toc);
+    result.h1 = this->add(doc.h1);
+    result.h2 = this->add(doc.h2);
+    result.h3 = this->add(doc.h3);
+    result.content = this->add(doc.content);
+    result.lang = doc.lang;
+    return result;
+}
+
+TokenizedDocument Vocabulary::decode(const term_document &doc) const {
+    TokenizedDocument result(doc.id, this->get_words(doc.title), this->get_words(doc.toc), this->get_words(doc.h1), this->get_words(doc.h2), this->get_words(doc.h3), this->get_words(doc.content));
+    result.lang = doc.lang;
+    return result;
+}
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <cstdint>
+#include "Document.h"
+
+/**
+ * Tokenized document with the words replaced by term IDs
+ */
+struct term_document {
+    /** ID */
+    int id = -1;
+    /** Title */
+    std::vector<uint32_t> title{};
+    /** Table of contents */
+    std::vector<uint32_t> toc{};
+    /** Header 1 */
+    std::vector<uint32_t> h1{};
+    /** Header 2 */
+    std::vector<uint32_t> h2{};
+    /** Header 3 */
+    std::vector<uint32_t> h3{};
+    /** Content */
+    std::vector<uint32_t> content{};
+    /** Language of the document */
+    std::string lang{};
+
+    /**
+     * Get the terms of the indexed field
+     * @param title_b Whether to get the title terms (content, table of contents and headers otherwise)
+     * @return Terms
+     */
+    [[nodiscard]] std::vector<uint32_t> get_terms(bool title_b = false) const {
+        if (title_b)
+            return title;
+        std::vector<uint32_t> terms;
+        terms.reserve(content.size() + toc.size() + h1.size() + h2.size() + h3.size());
+        terms.insert(terms.end(), content.begin(), content.end());
+        terms.insert(terms.end(), toc.begin(), toc.end());
+        terms.insert(terms.end(), h1.begin(), h1.end());
+        terms.insert(terms.end(), h2.begin(), h2.end());
+        terms.insert(terms.end(), h3.begin(), h3.end());
+        return terms;
+    }
+    /**
+     * Get the terms of the indexed field into the given buffer (the buffer is reused between documents)
+     * @param title_b Whether to get the title terms (content, table of contents and headers otherwise)
+     * @param terms Terms (overwritten)
+     */
+    void get_terms(bool title_b, std::vector<uint32_t> &terms) const {
+        terms.clear();
+        if (title_b) {
+            terms.insert(terms.end(), title.begin(), title.end());
+            return;
+        }
+        terms.insert(terms.end(), content.begin(), content.end());
+        terms.insert(terms.end(), toc.begin(), toc.end());
+        terms.insert(terms.end(), h1.begin(), h1.end());
+        terms.insert(terms.end(), h2.begin(), h2.end());
+        terms.insert(terms.end(), h3.begin(), h3.end());
+    }
+};
+
+/**
+ * Dictionary of word <-> dense term ID
+ * Every distinct word is stored only once, the indices work with the IDs, so they can be plain vectors
+ * and comparing or hashing a word happens only when it enters the dictionary
+ */
+class Vocabulary {
+private:
+    /** Words by term ID (deque never moves the stored strings, so the lookup table can point to them) */
+    std::deque<std::string> words;
+    /** Word -> term ID */
+    std::unordered_map<std::string_view, uint32_t> ids;
+
+public:
+    /** Term ID of the words that are not in the dictionary */
+    static constexpr uint32_t NO_TERM = UINT32_MAX;
+
+    /**
+     * Constructor for the Vocabulary class
+     */
+    Vocabulary();
+    /**
+     * Copy constructor (the lookup table has to point to the words of the copy)
+     * @param other Other vocabulary
+     */
+    Vocabulary(const Vocabulary &other);
+    /**
+     * Copy assignment (the lookup table has to point to the words of the copy)
+     * @param other Other vocabulary
+     * @return This vocabulary
+     */
+    Vocabulary &operator=(const Vocabulary &other);
+    Vocabulary(Vocabulary &&other) noexcept = default;
+    Vocabulary &operator=(Vocabulary &&other) noexcept = default;
+
+    /**
+     * Get the term ID of the given word, the word is added if it is not in the dictionary yet
+     * @param word Word
+     * @return Term ID
+     */
+    uint32_t add(std::string_view word);
+    /**
+     * Get the term IDs of the given words, new words are added
+     * @param words_ Words
+     * @return Term IDs
+     */
+    std::vector<uint32_t> add(const std::vector<std::string> &words_);
+    /**
+     * Get the term ID of the given word
+     * @param word Word
+     * @return Term ID or NO_TERM if the word is not in the dictionary
+     */
+    [[nodiscard]] uint32_t find(std::string_view word) const;
+    /**
+     * Get the word with the given term ID
+     * @param term Term ID (has to be in the dictionary)
+     * @return Word
+     */
+    [[nodiscard]] const std::string &get_word(uint32_t term) const;
+    /**
+     * Get the words with the given term IDs
+     * @param terms Term IDs (have to be in the dictionary)
+     * @return Words
+     */
+    [[nodiscard]] std::vector<std::string> get_words(const std::vector<uint32_t> &terms) const;
+    /**
+     * Get the number of words in the dictionary
+     * @return Number of words
+     */
+    [[nodiscard]] size_t size() const;
+
+    /**
+     * Replace the words of the tokenized document by term IDs, new words are added
+     * @param doc Tokenized document
+     * @return Document with term IDs
+     */
+    term_document encode(const TokenizedDocument &doc);
+    /**
+     * Replace the term IDs of the document by the words
+     * @param doc Document with term IDs
+     * @return Tokenized document
+     */
+    [[nodiscard]] TokenizedDocument decode(const term_document &doc) const;
+};
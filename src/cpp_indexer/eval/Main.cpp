@@ -8,8 +8,51 @@ bool FILE_BASED = false;
 bool DETECT_LANG = false;
 /** Use lemmatization or stemming */
 bool USE_LEMMA = true;
+/** Number of worker threads (0 = number of hardware threads) */
+int THREADS = 0;
+/** Memory budget of a block of the file based index build in MB */
+int MEMORY_BUDGET = 256;
+/** Bits of the quantized impacts of the in-memory index (8 or 16, 0 = scoring by the float postings) */
+int IMPACT_BITS = 0;
+
+/**
+ * Parse arguments
+ * @param argc Argument count
+ * @param argv Argument values
+ */
+void parse_args(int argc, char **argv) {
+    for (int i = 1; i < argc; i++) {
+        if (std::string(argv[i]) == "--help") {
+            std::cout << "Usage: ./cpp_indexer_eval [--lemma | --stem] [--threads N] [--impact-bits 8|16]" << std::endl;
+            std::cout << "Options:" << std::endl;
+            std::cout << "\t--lemma\t\t\t\tUse lemmatization" << std::endl;
+            std::cout << "\t--stem\t\t\t\tUse stemming" << std::endl;
+            std::cout << "\t--threads N\t\t\tNumber of worker threads (default: number of hardware threads)" << std::endl;
+            std::cout << "\t--impact-bits N\t\tScore by impacts quantized to 8 or 16 bits (default: float scores)" << std::endl;
+            exit(EXIT_SUCCESS);
+        }
+
+        if (std::string(argv[i]) == "--lemma")
+            USE_LEMMA = true;
+        if (std::string(argv[i]) == "--stem")
+            USE_LEMMA = false;
+        if (std::string(argv[i]) == "--threads" && i + 1 < argc)
+            THREADS = std::max(0, std::atoi(argv[++i]));
+        if (std::string(argv[i]) == "--impact-bits" && i + 1 < argc) {
+            int bits = std::atoi(argv[++i]);
+            IMPACT_BITS = bits <= 0 ? 0 : (bits <= 8 ? 8 : 16);
+        }
+    }
+}
+
+/**
+ * Main function
+ * @return Exit code
+ */
+int main(int argc, char **argv) {
+    /* Parse arguments, set USE_LEMMA, THREADS and IMPACT_BITS (float and quantized runs are compared by trec_eval) */
+    parse_args(argc, argv);
 
-int main() {
     std::cout << "Loading documents..." << std::endl;
     auto start = std::chrono::high_resolution_clock::now();
     std::vector<Document> docs = DataUtils::load_documents();
@@ -27,9 +70,9 @@ int main() {
 
     auto indexer = Indexer(docs, tokenized_docs, positions_map);
 //    auto indexer = Indexer();
-//    IndexHandler::load_index(indexer, "../src/cpp_indexer/eval/data/index.json");
+//    IndexHandler::load_index(indexer, "../src/cpp_indexer/eval/data/index.idx");
 
-//    IndexHandler::save_index(indexer, "../src/cpp_indexer/eval/data/index.json");
+//    IndexHandler::save_index(indexer, "../src/cpp_indexer/eval/data/index.idx");
 
     std::cout << "Testing queries..." << std::endl;
     start = std::chrono::high_resolution_clock::now();
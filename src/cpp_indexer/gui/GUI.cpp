@@ -80,25 +80,34 @@ void GUI::init() {
     for (auto &col : style.Colors)
         col = ImVec4(col.x - 0.04f, col.z + 0.05f, col.y - 0.08f, col.w);
 
-    /* Initialize the index */
+    /* Initialize the indices in the background, each one shows up as soon as it is loaded */
+    this->index_thread = std::thread(&GUI::index_worker, this);
     if (FILE_BASED) {
         if (!std::filesystem::exists(FILE_BASED_INDEX_PATH))
             std::filesystem::create_directory(FILE_BASED_INDEX_PATH);
         for (const auto &entry : std::filesystem::directory_iterator(FILE_BASED_INDEX_PATH)) {
-            indices.emplace_back(entry.path().filename().replace_extension().string());
-            Indexer indexer = Indexer(entry.path().string() + "/");
-            indexers.emplace_back(indexer);
+            if (!entry.is_directory())
+                continue;
+            /* Rebuild that was interrupted by closing the GUI, the old index is still whole */
+            if (entry.path().extension() == STAGING_EXTENSION) {
+                std::filesystem::remove_all(entry.path());
+                continue;
+            }
+            this->queue_index_job({IndexOperation::OPEN, entry.path().filename().replace_extension().string(), entry.path().string() + "/"});
         }
     } else {
         if (!std::filesystem::exists(INDEX_PATH))
             std::filesystem::create_directory(INDEX_PATH);
         for (const auto &entry : std::filesystem::directory_iterator(INDEX_PATH)) {
-            indices.emplace_back(entry.path().filename().replace_extension().string());
-            Indexer indexer = Indexer();
-            IndexHandler::load_index(indexer, entry.path().string());
-            indexers.emplace_back(indexer);
+            auto extension = entry.path().extension().string();
+            if (extension != INDEX_EXTENSION && extension != ".json")
+                continue;
+            this->queue_index_job({IndexOperation::OPEN, entry.path().filename().replace_extension().string(), entry.path().string()});
         }
     }
+
+    /* Start the search thread */
+    this->search_thread = std::thread(&GUI::search_worker, this);
 }
 
 void GUI::render() {
@@ -113,6 +122,9 @@ void GUI::render() {
     /* Render here */
     glClear(GL_COLOR_BUFFER_BIT);
 
+    /* Indices finished since the last frame */
+    this->install_finished_indexers();
+
     /* Set the font */
     ImGui::PushFont(this->font);
 
@@ -168,6 +180,7 @@ void GUI::render() {
                 ImGui::SetWindowSize(ImVec2((float) window_width / 3, (float) window_height));
                 ImGui::SetWindowFontScale(font_scale);
 
+                this->render_index_progress();
                 if (indices.empty())
                     ImGui::Text("Neexistují žádné indexy!");
                 else if (ImGui::BeginCombo("Index", indices[current_index].c_str())) {
@@ -179,10 +192,6 @@ void GUI::render() {
                             ImGui::SetItemDefaultFocus();
                     }
                     ImGui::EndCombo();
-                    if (indexers[current_index].get_max_doc_id())
-                        DataLoader::id_counter = indexers[current_index].get_max_doc_id() + 1;
-                    else
-                        DataLoader::id_counter = 0;
                 }
 
                 const char *model_names[] = {"Vektorový", "Booleovský"};
@@ -233,61 +242,8 @@ void GUI::render() {
                 if (ImGui::InputTextWithHint("##Dotaz", "Zadejte svůj dotaz...", &query, ImGuiInputTextFlags_EnterReturnsTrue))
                     find = true;
                 ImGui::SameLine();
-                if (ImGui::Button("Hledej") || find) {
-                    if (detect_language)
-                        query_lang = PyHandler::detect_lang_text(query);
-
-                    auto index = indexers[current_index];
-                    FieldType field = FieldType::ALL;
-                    if (current_field == 1)
-                        field = FieldType::TITLE;
-                    else if (current_field == 2)
-                        field = FieldType::CONTENT;
-
-                    result_snippets.clear();
-                    highlight_indices.clear();
-
-                    bool do_search = true;
-                    if (query.empty()) {
-                        std::cout << "Empty query!" << std::endl << std::endl;
-                        search_results.clear();
-                        do_search = false;
-                    }
-
-                    if (do_search && current_model == 0) { /* Vector model */
-                        std::vector<Document> result;
-                        std::vector<float> scores;
-                        std::map<std::string, std::map<int, std::vector<int>>> positions;
-                        if (proximity_search)
-                            std::tie(result, scores, positions) = IndexHandler::search(index, query, k_best, field, proximity);
-                        else if (phrase_search)
-                            std::tie(result, scores, positions) = IndexHandler::search(index, query, k_best, field, 1);
-                        else
-                            std::tie(result, scores, positions) = IndexHandler::search(index, query, k_best, field);
-                        this->search_results = result;
-                        for (const auto &doc : search_results) {
-                            std::string snippet;
-                            std::vector<int> highlight_index;
-                            if (proximity_search)
-                                std::tie(snippet, highlight_index) = IndexHandler::create_snippet(index, doc.id, positions, snippet_window_size, proximity);
-                            else if (phrase_search)
-                                std::tie(snippet, highlight_index) = IndexHandler::create_snippet(index, doc.id, positions, snippet_window_size, 1);
-                            else
-                                std::tie(snippet, highlight_index) = IndexHandler::create_snippet(index, doc.id, positions, snippet_window_size);
-                            result_snippets.emplace_back(snippet);
-                            highlight_indices.emplace_back(highlight_index);
-                        }
-                    } else if (do_search && current_model == 1) { /* Boolean model */
-                        auto [result, positions] = IndexHandler::search(index, query, field);
-                        this->search_results = result;
-                        for (const auto &doc : search_results) {
-                            auto [snippet, highlight_index] = IndexHandler::create_snippet(index, doc.id, positions, snippet_window_size);
-                            result_snippets.emplace_back(snippet);
-                            highlight_indices.emplace_back(highlight_index);
-                        }
-                    }
-                    this->total_results = this->search_results.size();
-                }
+                if ((ImGui::Button("Hledej") || find) && !indices.empty())
+                    this->start_search();
 
                 static std::unordered_set<std::string> autocomplete_entries;
                 if (!indices.empty())
@@ -319,9 +275,13 @@ void GUI::render() {
                     ImGui::EndChild();
                 }
 
+                /* Results are delivered by the search thread, the frame only shows what is there so far */
+                std::lock_guard<std::mutex> results_lock(this->search_mutex);
                 if (detect_language)
                     ImGui::Text("Detekovaný jazyk: %s", query_lang.c_str());
 
+                if (searching)
+                    ImGui::Text("Hledám...");
                 ImGui::Text("Celkem výsledků: %d", total_results);
                 ImGui::SetNextItemOpen(true, ImGuiCond_Once);
                 if (ImGui::TreeNode("Výsledky")) {
@@ -331,6 +291,12 @@ void GUI::render() {
                         if (ImGui::TreeNode(("Dokument " + std::to_string(doc.id)).c_str())) {
                             ImGui::Text("Nadpis: %s", doc.title.c_str());
                             ImGui::Text("Jazyk: %s", doc.lang.c_str());
+                            if (i >= result_snippets.size()) { /* Snippet is not created yet */
+                                ImGui::Text("Úryvek: ...");
+                                ImGui::Separator();
+                                ImGui::TreePop();
+                                continue;
+                            }
                             auto snippet = result_snippets[i];
                             auto highlight_index = highlight_indices[i];
 
@@ -392,10 +358,6 @@ void GUI::render() {
                             ImGui::SetItemDefaultFocus();
                     }
                     ImGui::EndCombo();
-                    if (indexers[current_index].get_max_doc_id())
-                        DataLoader::id_counter = indexers[current_index].get_max_doc_id() + 1;
-                    else
-                        DataLoader::id_counter = 0;
                 }
                 ImGui::PushStyleColor(ImGuiCol_Button, (ImVec4)ImColor::HSV(0.0f, 0.6f, 0.6f));
                 ImGui::PushStyleColor(ImGuiCol_ButtonHovered, (ImVec4)ImColor::HSV(0.0f, 0.7f, 0.7f));
@@ -404,7 +366,12 @@ void GUI::render() {
                     if (FILE_BASED)
                         std::filesystem::remove_all(FILE_BASED_INDEX_PATH + indices[current_index]);
                     else
-                        std::filesystem::remove(INDEX_PATH + indices[current_index] + ".json");
+                        std::filesystem::remove(INDEX_PATH + indices[current_index] + INDEX_EXTENSION);
+                    {
+                        /* Waiting jobs of the deleted index would bring it back */
+                        std::lock_guard<std::mutex> lock(this->index_mutex);
+                        std::erase_if(this->index_jobs, [&](const index_job &job) { return job.name == indices[current_index]; });
+                    }
                     indices.erase(indices.begin() + current_index);
                     indexers.erase(indexers.begin() + current_index);
                     current_index = 0;
@@ -423,28 +390,12 @@ void GUI::render() {
                         indexers.emplace_back(indexer);
                     }
                     current_index = indices.size() - 1;
-                    if (indexers[current_index].get_max_doc_id())
-                        DataLoader::id_counter = indexers[current_index].get_max_doc_id() + 1;
-                    else
-                        DataLoader::id_counter = 0;
                 }
 
                 ImGui::InputTextWithHint("Data", "Zadejte cestu k datům...", data_path, IM_ARRAYSIZE(data_path));
-                if (ImGui::Button("Načíst data")) {
-                    auto docs = IndexHandler::load_documents(data_path);
-                    auto [tokenized_docs, positions] = IndexHandler::preprocess_documents(docs);
-                    if (FILE_BASED) {
-                        FileBasedLoader::save_doc_cache(docs, FILE_BASED_INDEX_PATH + indices[current_index] + "/");
-                        FileBasedLoader::save_tokenized_docs(tokenized_docs, FILE_BASED_INDEX_PATH + indices[current_index] + "/");
-                        FileBasedLoader::save_positions_map(positions, FILE_BASED_INDEX_PATH + indices[current_index] + "/");
-                        auto indexer = Indexer(FILE_BASED_INDEX_PATH + indices[current_index] + "/");
-                        indexers[current_index] = indexer;
-                    } else {
-                        auto indexer = Indexer(docs, tokenized_docs, positions);
-                        indexers[current_index] = indexer;
-                        IndexHandler::save_index(indexer, "../index/" + indices[current_index] + ".json");
-                    }
-                }
+                if (ImGui::Button("Načíst data") && !indices.empty())
+                    this->queue_index_job({IndexOperation::BUILD, indices[current_index], get_index_path(indices[current_index]), data_path, {}, {}, "", indexers[current_index]});
+                this->render_index_progress();
 
                 ImGui::InputInt("ID", &current_doc_id);
                 if (ImGui::Button("Načíst dokument")) {
@@ -467,11 +418,8 @@ void GUI::render() {
                 }
 
                 ImGui::InputTextWithHint("URL", "Zadejte url z witcher.fandom.com/cs", url, IM_ARRAYSIZE(url));
-                if (ImGui::Button("Stáhnout dokument z URL")) {
-                    IndexHandler::add_doc_url(indexers[current_index], url);
-                    if (!FILE_BASED)
-                        IndexHandler::save_index(indexers[current_index], "../index/" + indices[current_index] + ".json");
-                }
+                if (ImGui::Button("Stáhnout dokument z URL") && !indices.empty())
+                    this->queue_edit(IndexOperation::DOWNLOAD, {}, {}, url);
 
                 ImGui::End();
 
@@ -491,7 +439,7 @@ void GUI::render() {
                 ImGui::InputTextMultiline("H3", &current_doc_h3, ImVec2(0, font_size * 4));
                 ImGui::InputTextMultiline("Obsah", &current_doc_content);
 
-                if (ImGui::Button("Vytvořit")) {
+                if (ImGui::Button("Vytvořit") && !indices.empty()) {
                     std::vector<std::string> toc;
                     std::istringstream toc_stream(current_doc_toc);
                     std::string toc_line;
@@ -516,18 +464,12 @@ void GUI::render() {
                     while (std::getline(h3_stream, h3_line))
                         h3.emplace_back(h3_line);
 
-                    int id = indexers[current_index].get_collection_size();
-
-                    Document doc = {id, current_doc_title, toc, h1, h2, h3, current_doc_content};
-                    std::vector<int> id_vec = {doc.id};
-                    std::vector<Document> doc_vec = {doc};
-
-                    IndexHandler::add_docs(indexers[current_index], doc_vec);
-                    if (!FILE_BASED)
-                        IndexHandler::save_index(indexers[current_index], "../index/" + indices[current_index] + ".json");
+                    /* ID is handed out by the index thread */
+                    Document doc = {0, current_doc_title, toc, h1, h2, h3, current_doc_content};
+                    this->queue_edit(IndexOperation::ADD, {doc}, {});
                 }
                 ImGui::SameLine();
-                if (ImGui::Button("Aktualizovat")) {
+                if (ImGui::Button("Aktualizovat") && !indices.empty()) {
                     std::vector<std::string> toc;
                     std::istringstream toc_stream(current_doc_toc);
                     std::string toc_line;
@@ -553,23 +495,14 @@ void GUI::render() {
                         h3.emplace_back(h3_line);
 
                     Document doc = {current_doc_id, current_doc_title, toc, h1, h2, h3, current_doc_content};
-                    std::vector<int> id_vec = {doc.id};
-                    std::vector<Document> doc_vec = {doc};
-
-                    IndexHandler::update_docs(indexers[current_index], id_vec, doc_vec);
-                    if (!FILE_BASED)
-                        IndexHandler::save_index(indexers[current_index], "../index/" + indices[current_index] + ".json");
+                    this->queue_edit(IndexOperation::UPDATE, {doc}, {doc.id});
                 }
                 ImGui::SameLine();
                 ImGui::PushStyleColor(ImGuiCol_Button, (ImVec4)ImColor::HSV(0.0f, 0.6f, 0.6f));
                 ImGui::PushStyleColor(ImGuiCol_ButtonHovered, (ImVec4)ImColor::HSV(0.0f, 0.7f, 0.7f));
                 ImGui::PushStyleColor(ImGuiCol_ButtonActive, (ImVec4)ImColor::HSV(0.0f, 0.8f, 0.8f));
-                if (ImGui::Button("Smazat")) {
-                    std::vector<int> id_vec = {current_doc_id};
-                    IndexHandler::remove_docs(indexers[current_index], id_vec);
-                    if (!FILE_BASED)
-                        IndexHandler::save_index(indexers[current_index], "../index/" + indices[current_index] + ".json");
-                }
+                if (ImGui::Button("Smazat") && !indices.empty())
+                    this->queue_edit(IndexOperation::REMOVE, {}, {current_doc_id});
                 ImGui::PopStyleColor(3);
 
                 ImGui::End();
@@ -695,7 +628,315 @@ void GUI::render() {
     glfwSwapInterval(1); /* Enable vsync */
 }
 
+void GUI::start_search() {
+    search_job job;
+    job.indexer = indexers[current_index];
+    job.query = query;
+    job.field = FieldType::ALL;
+    if (current_field == 1)
+        job.field = FieldType::TITLE;
+    else if (current_field == 2)
+        job.field = FieldType::CONTENT;
+    job.model = current_model;
+    job.k = k_best;
+    job.detect_language = detect_language;
+    if (current_model == 0 && proximity_search) /* Vector model */
+        job.proximity = proximity;
+    else if (current_model == 0 && phrase_search) { /* Phrase search - the whole query in order, following words at distance 1 */
+        job.proximity = 1;
+        job.phrase = true;
+    }
+
+    std::lock_guard<std::mutex> lock(this->search_mutex);
+    /* Search that is being evaluated notices the new generation and stops */
+    job.generation = ++this->search_generation;
+    this->search_results.clear();
+    this->result_snippets.clear();
+    this->highlight_indices.clear();
+    this->total_results = 0;
+
+    if (query.empty()) {
+        std::cout << "Empty query!" << std::endl << std::endl;
+        this->pending_search.reset();
+        this->searching = false;
+        return;
+    }
+
+    this->pending_search = std::move(job);
+    this->searching = true;
+    this->search_cv.notify_one();
+}
+
+void GUI::search_worker() {
+    while (true) {
+        search_job job;
+        {
+            std::unique_lock<std::mutex> lock(this->search_mutex);
+            this->search_cv.wait(lock, [this] { return this->pending_search.has_value() || this->stop_search; });
+            if (this->stop_search)
+                return;
+            job = std::move(*this->pending_search);
+            this->pending_search.reset();
+        }
+        this->evaluate_search(job);
+    }
+}
+
+void GUI::evaluate_search(search_job &job) {
+    auto superseded = [this, &job] { return this->search_generation != job.generation; };
+
+    if (job.detect_language) {
+        auto lang = PyHandler::detect_lang_text(job.query);
+        std::lock_guard<std::mutex> lock(this->search_mutex);
+        if (superseded())
+            return;
+        this->query_lang = lang;
+    }
+
+    std::vector<Document> result;
+    std::map<std::string, std::map<int, std::vector<int>>> positions;
+    if (job.model == 0) { /* Vector model */
+        std::vector<float> scores;
+        std::tie(result, scores, positions) = IndexHandler::search(job.indexer, job.query, job.k, job.field, job.proximity, true, job.phrase);
+    } else { /* Boolean model */
+        std::tie(result, positions) = IndexHandler::search(job.indexer, job.query, job.field);
+    }
+
+    /* Ranked documents are shown right away, snippets follow as they are created */
+    {
+        std::lock_guard<std::mutex> lock(this->search_mutex);
+        if (superseded())
+            return;
+        this->search_results = result;
+        this->total_results = this->search_results.size();
+    }
+
+    for (const auto &doc : result) {
+        if (superseded())
+            return;
+        auto [snippet, highlight_index] = IndexHandler::create_snippet(job.indexer, doc.id, positions, snippet_window_size, job.proximity);
+        std::lock_guard<std::mutex> lock(this->search_mutex);
+        if (superseded())
+            return;
+        this->result_snippets.emplace_back(snippet);
+        this->highlight_indices.emplace_back(highlight_index);
+    }
+
+    std::lock_guard<std::mutex> lock(this->search_mutex);
+    if (!superseded())
+        this->searching = false;
+}
+
+void GUI::queue_index_job(const index_job &job) {
+    {
+        std::lock_guard<std::mutex> lock(this->index_mutex);
+        this->index_jobs.push_back(job);
+    }
+    this->index_cv.notify_one();
+}
+
+void GUI::queue_edit(IndexOperation operation, const std::vector<Document> &docs, const std::vector<int> &doc_ids, const std::string &url) {
+    auto name = indices[current_index];
+    this->queue_index_job({operation, name, get_index_path(name), "", docs, doc_ids, url, indexers[current_index]});
+}
+
+std::string GUI::get_index_path(const std::string &name) {
+    if (FILE_BASED)
+        return FILE_BASED_INDEX_PATH + name + "/";
+    return INDEX_PATH + name + INDEX_EXTENSION;
+}
+
+void GUI::index_worker() {
+    /* Progress of the jobs is reported by this thread only */
+    IndexHandler::report_progress(&this->index_job_progress);
+    while (true) {
+        index_job job;
+        {
+            std::unique_lock<std::mutex> lock(this->index_mutex);
+            /* Next job starts once the render loop installed the previous one, so it works on the installed index */
+            this->index_cv.wait(lock, [this] { return (!this->index_jobs.empty() && this->finished_indexers.empty()) || this->stop_indexing; });
+            if (this->stop_indexing)
+                return;
+            job = std::move(this->index_jobs.front());
+            this->index_jobs.pop_front();
+            this->current_index_job = job.name;
+        }
+
+        /* IDs of the new documents follow the index of the job, only this thread hands them out */
+        if (job.operation != IndexOperation::OPEN) {
+            int max_id = job.indexer.get_max_doc_id();
+            DataLoader::id_counter = max_id ? max_id + 1 : 0;
+        }
+
+        Indexer indexer = Indexer();
+        bool success = false;
+        try {
+            success = evaluate_index_job(job, indexer);
+        } catch (const std::exception &e) {
+            std::cerr << "[ERROR]: Failed to index " << job.name << ": " << e.what() << std::endl;
+        }
+        IndexHandler::start_phase(IndexPhase::IDLE);
+
+        std::lock_guard<std::mutex> lock(this->index_mutex);
+        if (success)
+            this->finished_indexers.emplace_back(std::move(job), std::move(indexer));
+        this->current_index_job.clear();
+    }
+}
+
+std::string GUI::get_staging_path(const index_job &job) {
+    return std::filesystem::path(job.index_path).parent_path().string() + STAGING_EXTENSION + "/";
+}
+
+bool GUI::evaluate_index_job(const index_job &job, Indexer &indexer) {
+    /* Edits go to the shown index (the copy shares its head), searches see the new snapshot once it is published */
+    if (job.operation != IndexOperation::OPEN && job.operation != IndexOperation::BUILD) {
+        indexer = job.indexer;
+        auto docs = job.docs;
+        auto doc_ids = job.doc_ids;
+        if (job.operation == IndexOperation::ADD) {
+            for (auto &doc : docs)
+                doc.id = DataLoader::id_counter++;
+            IndexHandler::add_docs(indexer, docs);
+        } else if (job.operation == IndexOperation::UPDATE) {
+            IndexHandler::update_docs(indexer, doc_ids, docs);
+        } else if (job.operation == IndexOperation::REMOVE) {
+            IndexHandler::remove_docs(indexer, doc_ids);
+        } else {
+            IndexHandler::add_doc_url(indexer, job.url);
+        }
+        if (!FILE_BASED)
+            IndexHandler::save_index(indexer, job.index_path);
+        return true;
+    }
+
+    /* Open the saved index */
+    if (job.operation == IndexOperation::OPEN) {
+        if (FILE_BASED) {
+            IndexHandler::load_lemma_cache(job.index_path);
+            indexer = Indexer(job.index_path);
+            return true;
+        }
+        if (!IndexHandler::load_index(indexer, job.index_path))
+            return false;
+        /* Migrate the old JSON indices to the binary format */
+        if (std::filesystem::path(job.index_path).extension() == ".json") {
+            IndexHandler::save_index(indexer, INDEX_PATH + job.name + INDEX_EXTENSION);
+            std::filesystem::remove(job.index_path);
+        }
+        return true;
+    }
+
+    /* Build the index from the documents (replaces the index with the same name) */
+    auto [docs, tokenized_docs, positions] = IndexHandler::load_and_preprocess_documents(job.data_path);
+    if (FILE_BASED) {
+        /* Old index is still searched and edited meanwhile, the new one is built aside */
+        auto staging_path = get_staging_path(job);
+        std::filesystem::remove_all(staging_path);
+        std::filesystem::create_directories(staging_path);
+        IndexHandler::start_phase(IndexPhase::SAVE);
+        FileBasedLoader::save_doc_cache(docs, staging_path);
+        FileBasedLoader::save_tokenized_docs(tokenized_docs, staging_path);
+        FileBasedLoader::save_positions_map(positions, staging_path);
+        IndexHandler::save_lemma_cache(staging_path);
+        indexer = Indexer(staging_path);
+    } else {
+        indexer = Indexer(docs, tokenized_docs, positions);
+        IndexHandler::save_index(indexer, job.index_path);
+    }
+    return true;
+}
+
+void GUI::install_finished_indexers() {
+    std::vector<std::pair<index_job, Indexer>> finished;
+    {
+        std::lock_guard<std::mutex> lock(this->index_mutex);
+        finished.swap(this->finished_indexers);
+    }
+
+    for (auto &[job, indexer] : finished) {
+        /* Old index is replaced only now, its readers keep the old files until they are done */
+        if (FILE_BASED && job.operation == IndexOperation::BUILD) {
+            try {
+                FileBasedLoader::install_index(get_staging_path(job), job.index_path);
+            } catch (const std::filesystem::filesystem_error &e) {
+                std::cerr << "[ERROR]: Failed to replace the index " << job.name << ": " << e.what() << std::endl;
+                continue;
+            }
+            indexer.move_to(job.index_path);
+        }
+        auto it = std::find(indices.begin(), indices.end(), job.name);
+        if (it != indices.end()) {
+            indexers[it - indices.begin()] = std::move(indexer);
+            continue;
+        }
+        if (job.operation != IndexOperation::OPEN && job.operation != IndexOperation::BUILD)
+            continue;
+        indices.emplace_back(job.name);
+        indexers.emplace_back(std::move(indexer));
+    }
+    if (finished.empty())
+        return;
+
+    /* Waiting jobs work on the installed indices, not on the ones they were queued with */
+    {
+        std::lock_guard<std::mutex> lock(this->index_mutex);
+        for (auto &pending : this->index_jobs) {
+            auto it = std::find(indices.begin(), indices.end(), pending.name);
+            if (pending.operation != IndexOperation::OPEN && it != indices.end())
+                pending.indexer = indexers[it - indices.begin()];
+        }
+    }
+    this->index_cv.notify_one();
+}
+
+void GUI::render_index_progress() {
+    std::string name;
+    size_t waiting;
+    {
+        std::lock_guard<std::mutex> lock(this->index_mutex);
+        name = this->current_index_job;
+        waiting = this->index_jobs.size();
+    }
+    if (name.empty() && !waiting)
+        return;
+
+    if (!name.empty()) {
+        const char *phase_names[] = {"Příprava", "Načítání", "Předzpracování", "Detekce jazyka", "TF-IDF", "Ukládání"};
+        auto phase = this->index_job_progress.phase.load();
+        size_t done = this->index_job_progress.done;
+        size_t total = this->index_job_progress.total;
+        ImGui::Text("Indexuji %s: %s", name.c_str(), phase_names[static_cast<int>(phase)]);
+        /* Phases without known number of steps have no progress bar */
+        if (total > 0) {
+            auto overlay = std::to_string(std::min(done, total)) + " / " + std::to_string(total);
+            ImGui::ProgressBar(std::min(1.0f, (float) done / (float) total), ImVec2(-1.0f, 0.0f), overlay.c_str());
+        }
+    }
+    if (waiting)
+        ImGui::Text("Indexů ve frontě: %d", (int) waiting);
+}
+
 void GUI::cleanup() {
+    /* Stop the index thread (index that is being built is finished first) */
+    {
+        std::lock_guard<std::mutex> lock(this->index_mutex);
+        this->stop_indexing = true;
+    }
+    this->index_cv.notify_one();
+    if (this->index_thread.joinable())
+        this->index_thread.join();
+
+    /* Stop the search thread (search that is being evaluated is finished first) */
+    {
+        std::lock_guard<std::mutex> lock(this->search_mutex);
+        this->stop_search = true;
+        ++this->search_generation;
+    }
+    this->search_cv.notify_one();
+    if (this->search_thread.joinable())
+        this->search_thread.join();
+
     /* Cleanup */
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplGlfw_Shutdown();
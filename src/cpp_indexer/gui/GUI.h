@@ -5,6 +5,12 @@
 #include <iostream>
 #include <vector>
 #include <filesystem>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <optional>
+#include <deque>
 #include "imgui.h"
 #include "imgui_impl_glfw.h"
 #include "imgui_impl_opengl3.h"
@@ -13,6 +19,64 @@
 #include "IndexHandler.h"
 #include "Const.h"
 
+/**
+ * Search requested by the render loop and evaluated by the search thread
+ */
+struct search_job {
+    /** Generation of the search (the search is abandoned once a newer one is requested) */
+    unsigned int generation = 0;
+    /** Index to search in (copy shares the published snapshot, writers do not disturb it) */
+    Indexer indexer;
+    /** Query */
+    std::string query;
+    /** Field to search in */
+    FieldType field = FieldType::ALL;
+    /** Model (0 = vector, 1 = boolean) */
+    int model = 0;
+    /** K best results */
+    int k = 3;
+    /** Proximity (0 = no proximity search) */
+    int proximity = 0;
+    /** Phrase search flag */
+    bool phrase = false;
+    /** Detect language (query) */
+    bool detect_language = false;
+};
+
+/**
+ * Operation of an index job
+ */
+enum class IndexOperation {
+    OPEN,
+    BUILD,
+    ADD,
+    UPDATE,
+    REMOVE,
+    DOWNLOAD
+};
+
+/**
+ * Index load, build or edit requested by the GUI and evaluated by the index thread
+ */
+struct index_job {
+    /** Operation */
+    IndexOperation operation = IndexOperation::OPEN;
+    /** Name of the index */
+    std::string name;
+    /** Path of the saved index (file, or directory of the file based index) */
+    std::string index_path;
+    /** Directory with the documents to index (BUILD) */
+    std::string data_path{};
+    /** Documents to add or update (ADD, UPDATE - added documents get their IDs from the index thread) */
+    std::vector<Document> docs{};
+    /** IDs of the documents to update or remove (UPDATE, REMOVE) */
+    std::vector<int> doc_ids{};
+    /** URL to download the document from (DOWNLOAD) */
+    std::string url{};
+    /** Index the job works on (copy shares the head with the shown index, unused by OPEN) */
+    Indexer indexer{};
+};
+
 class GUI {
 private:
     /** Window to render to */
@@ -59,6 +123,67 @@ private:
      */
     static void glfw_error_callback(int error, const char *description);
 
+    /**
+     * Queue a search of the current query (supersedes the search that is being evaluated)
+     */
+    void start_search();
+    /**
+     * Search thread loop - evaluate the newest queued search until the GUI is closed
+     */
+    void search_worker();
+    /**
+     * Evaluate the search and deliver the results one by one, stops as soon as the search is superseded
+     * @param job Search
+     */
+    void evaluate_search(search_job &job);
+
+    /**
+     * Queue loading, building or editing of an index
+     * @param job Index job
+     */
+    void queue_index_job(const index_job &job);
+    /**
+     * Queue an edit of the current index
+     * @param operation Operation (ADD, UPDATE, REMOVE or DOWNLOAD)
+     * @param docs Documents to add or update
+     * @param doc_ids IDs of the documents to update or remove
+     * @param url URL to download the document from
+     */
+    void queue_edit(IndexOperation operation, const std::vector<Document> &docs, const std::vector<int> &doc_ids, const std::string &url = "");
+    /**
+     * Get the path of the saved index
+     * @param name Name of the index
+     * @return Path to the index file (or the directory of the file based index)
+     */
+    static std::string get_index_path(const std::string &name);
+    /**
+     * Index thread loop - evaluate the queued index jobs one by one until the GUI is closed
+     */
+    void index_worker();
+    /**
+     * Get the directory the file based index of the job is rebuilt in (next to the index directory)
+     * @param job Index job
+     * @return Path to the staging directory
+     */
+    static std::string get_staging_path(const index_job &job);
+    /**
+     * Load, build or edit the index of the job (rebuilt file based index is left in its staging directory)
+     * @param job Index job
+     * @param indexer Indexer to build or load into
+     * @return True if successful
+     */
+    static bool evaluate_index_job(const index_job &job, Indexer &indexer);
+    /**
+     * Show the indices finished by the index thread (every index is searchable as soon as its own job finishes)
+     * Rebuilt file based indices are moved from their staging directories over the old ones first, edits of
+     * indices that were deleted meanwhile are dropped
+     */
+    void install_finished_indexers();
+    /**
+     * Render the progress of the index jobs
+     */
+    void render_index_progress();
+
     /** Current chosen index */
     int current_index = 0;
     /** Index names */
@@ -101,6 +226,38 @@ private:
     /** Indexers */
     std::vector<Indexer> indexers = {};
 
+    /** Search thread (queries and snippets are evaluated outside of the render loop) */
+    std::thread search_thread;
+    /** Lock for the queued search and the results */
+    std::mutex search_mutex;
+    /** Wakes up the search thread */
+    std::condition_variable search_cv;
+    /** Search waiting for the search thread (only the newest one is kept) */
+    std::optional<search_job> pending_search;
+    /** Generation of the newest search */
+    std::atomic<unsigned int> search_generation = 0;
+    /** Whether the search thread should stop */
+    bool stop_search = false;
+    /** Whether the newest search is still being evaluated */
+    bool searching = false;
+
+    /** Index thread (indices are built and loaded outside of the render loop, one at a time) */
+    std::thread index_thread;
+    /** Lock for the index jobs and the finished indices */
+    std::mutex index_mutex;
+    /** Wakes up the index thread */
+    std::condition_variable index_cv;
+    /** Index jobs waiting for the index thread */
+    std::deque<index_job> index_jobs;
+    /** Name of the index that is being built or loaded (empty if none) */
+    std::string current_index_job;
+    /** Progress of the index that is being built or loaded (only the index thread reports to it) */
+    index_progress index_job_progress;
+    /** Indices finished by the index thread with their jobs, waiting for the render loop */
+    std::vector<std::pair<index_job, Indexer>> finished_indexers;
+    /** Whether the index thread should stop */
+    bool stop_indexing = false;
+
     /** Number of results */
     int total_results = 0;
     /** Search results */
@@ -0,0 +1,211 @@
+#include "BlockIndexBuilder.h"
+
+#include <queue>
+#include <numeric>
+#include <filesystem>
+
+void block_reader::next() {
+    if (!this->file.read(reinterpret_cast<char *>(&this->term), sizeof(this->term)) || !this->file.read(reinterpret_cast<char *>(&this->count), sizeof(this->count))) {
+        this->term = Vocabulary::NO_TERM;
+        this->count = 0;
+    }
+}
+
+void block_reader::read_postings(std::vector<block_posting> &postings) {
+    auto start = postings.size();
+    postings.resize(start + this->count);
+    if (!this->file.read(reinterpret_cast<char *>(postings.data() + start), static_cast<std::streamsize>(sizeof(block_posting) * this->count)))
+        throw std::runtime_error("[ERROR]: Corrupted index block!");
+    this->next();
+}
+
+BlockIndexBuilder::BlockIndexBuilder(const std::string &index_path_dir, bool title) : index_path_dir(index_path_dir), title(title), budget(static_cast<size_t>(std::max(MEMORY_BUDGET, 1)) * 1024 * 1024), vocabulary(), block(), block_terms(), blocks(), content_df(), doc_ids(), terms(), counts() {
+    /* Nothing to do here :) */
+}
+
+std::string BlockIndexBuilder::next_block_path() {
+    return this->index_path_dir + (this->title ? "title_" : "") + "block_" + std::to_string(this->blocks_count++) + ".tmp";
+}
+
+void BlockIndexBuilder::write_record(std::ofstream &output, uint32_t term, const std::vector<block_posting> &postings) {
+    BinaryWriter writer;
+    writer.write(term);
+    writer.write(static_cast<uint32_t>(postings.size()));
+    writer.write_array(postings.data(), postings.size());
+    output.write(writer.data().data(), static_cast<std::streamsize>(writer.size()));
+}
+
+void BlockIndexBuilder::add(const TokenizedDocument &doc) {
+    /* Whole document is encoded, so the term IDs (and the order the norms are summed in) match the in memory index */
+    auto encoded = this->vocabulary.encode(doc);
+    this->doc_ids.emplace_back(encoded.id);
+    if (this->block.size() < this->vocabulary.size())
+        this->block.resize(this->vocabulary.size());
+
+    if (this->title) {
+        this->content_df.resize(this->vocabulary.size(), 0);
+        encoded.get_terms(false, this->terms);
+        TF_IDF::count_terms(this->terms, this->counts);
+        for (const auto &[term, _] : this->counts)
+            this->content_df[term]++;
+    }
+
+    encoded.get_terms(this->title, this->terms);
+    TF_IDF::count_terms(this->terms, this->counts);
+    for (const auto &[term, count] : this->counts) {
+        auto &postings = this->block[term];
+        if (postings.empty()) {
+            this->block_terms.emplace_back(term);
+            this->block_size += sizeof(std::vector<block_posting>);
+        }
+        postings.push_back({encoded.id, count});
+        this->block_size += sizeof(block_posting);
+    }
+
+    if (this->block_size >= this->budget)
+        this->flush();
+}
+
+void BlockIndexBuilder::flush() {
+    if (this->block_terms.empty())
+        return;
+
+    /* Records sorted by term ID, so the blocks can be merged in a single pass */
+    std::sort(this->block_terms.begin(), this->block_terms.end());
+    auto path = this->next_block_path();
+    std::ofstream output(path, std::ios::binary);
+    for (const auto &term : this->block_terms) {
+        auto &postings = this->block[term];
+        write_record(output, term, postings);
+        /* Memory of the postings is given back, not only cleared */
+        std::vector<block_posting>().swap(postings);
+    }
+    output.close();
+    if (!output)
+        throw std::runtime_error("[ERROR]: Failed to write index block " + path + "!");
+
+    this->blocks.emplace_back(path);
+    this->block_terms.clear();
+    this->block_size = 0;
+}
+
+void BlockIndexBuilder::merge(const std::vector<std::string> &paths, const std::function<void(uint32_t, std::vector<block_posting> &)> &callback) {
+    /* K-way merge, only the postings of one term are in memory at a time */
+    std::vector<block_reader> readers(paths.size());
+    std::priority_queue<std::pair<uint32_t, size_t>, std::vector<std::pair<uint32_t, size_t>>, std::greater<>> heap;
+    for (size_t i = 0; i < readers.size(); i++) {
+        readers[i].file.open(paths[i], std::ios::binary);
+        readers[i].next();
+        if (readers[i].term != Vocabulary::NO_TERM)
+            heap.emplace(readers[i].term, i);
+    }
+
+    std::vector<block_posting> postings;
+    while (!heap.empty()) {
+        auto term = heap.top().first;
+        postings.clear();
+        while (!heap.empty() && heap.top().first == term) {
+            auto i = heap.top().second;
+            heap.pop();
+            readers[i].read_postings(postings);
+            if (readers[i].term != Vocabulary::NO_TERM)
+                heap.emplace(readers[i].term, i);
+        }
+        /* Blocks keep the documents in the order they were added */
+        std::sort(postings.begin(), postings.end(), [](const block_posting &a, const block_posting &b) { return a.doc_id < b.doc_id; });
+        callback(term, postings);
+    }
+
+    for (size_t i = 0; i < readers.size(); i++) {
+        readers[i].file.close();
+        std::filesystem::remove(paths[i]);
+    }
+}
+
+void BlockIndexBuilder::finish() {
+    this->flush();
+    std::string prefix = this->title ? "title_" : "";
+
+    /* Too many blocks to open at once are merged into bigger blocks first */
+    while (this->blocks.size() > MERGE_WAYS) {
+        std::vector<std::string> merged;
+        for (size_t i = 0; i < this->blocks.size(); i += MERGE_WAYS) {
+            std::vector<std::string> group(this->blocks.begin() + i, this->blocks.begin() + std::min(i + MERGE_WAYS, this->blocks.size()));
+            auto path = this->next_block_path();
+            std::ofstream output(path, std::ios::binary);
+            merge(group, [&output](uint32_t term, std::vector<block_posting> &postings) { write_record(output, term, postings); });
+            output.close();
+            if (!output)
+                throw std::runtime_error("[ERROR]: Failed to write index block " + path + "!");
+            merged.emplace_back(path);
+        }
+        this->blocks = std::move(merged);
+    }
+
+    /* Document IDs are given out one after another, so they are close to each other and index a plain vector */
+    std::sort(this->doc_ids.begin(), this->doc_ids.end());
+    int first_id = this->doc_ids.empty() ? 0 : this->doc_ids.front();
+    std::vector<float> doc_norms(this->doc_ids.empty() ? 0 : this->doc_ids.back() - first_id + 1, 0);
+
+    std::vector<uint32_t> merged_terms;
+    std::vector<term_entry> entries;
+    std::ofstream postings_file(this->index_path_dir + prefix + "tf_idf.postings", std::ios::binary);
+    uint64_t offset = 0;
+    merge(this->blocks, [&](uint32_t term, std::vector<block_posting> &postings) {
+        /* Terms are merged in ascending order, so the norms are summed in the same order as in the in memory index */
+        auto df = this->title ? this->content_df[term] : postings.size();
+        float idf = df > 0 ? std::log10(static_cast<float>(this->doc_ids.size()) / static_cast<float>(df)) : 0;
+        PostingList list;
+        for (const auto &posting : postings) {
+            list.push_back(posting.doc_id, posting.tf);
+            float value = TF_IDF::tf_weight(posting.tf) * idf;
+            doc_norms[posting.doc_id - first_id] += value * value;
+        }
+
+        BinaryWriter writer;
+        list.to_binary(writer);
+        postings_file.write(writer.data().data(), static_cast<std::streamsize>(writer.size()));
+        merged_terms.emplace_back(term);
+        entries.push_back({0, 0, idf, 0, offset, writer.size()});
+        offset += writer.size();
+    });
+    postings_file.close();
+    this->blocks.clear();
+    for (auto &norm : doc_norms)
+        norm = std::sqrt(norm);
+
+    /* Upper bounds for MaxScore need the final norms, the merged postings are read back */
+    if (!entries.empty()) {
+        MappedFile file(this->index_path_dir + prefix + "tf_idf.postings");
+        for (auto &entry : entries) {
+            BinaryReader reader(file.data() + entry.offset, entry.size);
+            PostingList list;
+            list.from_binary(reader);
+            list.for_each([&](int doc_id, uint32_t tf) {
+                auto norm = doc_norms[doc_id - first_id];
+                if (norm > 0)
+                    entry.max_score = std::max(entry.max_score, TF_IDF::tf_weight(tf) * entry.idf / norm);
+            });
+        }
+    }
+
+    /* Dictionary is sorted by the words */
+    std::vector<size_t> order(entries.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [this, &merged_terms](size_t a, size_t b) { return this->vocabulary.get_word(merged_terms[a]) < this->vocabulary.get_word(merged_terms[b]); });
+    std::vector<std::string> words;
+    std::vector<term_entry> sorted_entries;
+    words.reserve(order.size());
+    sorted_entries.reserve(order.size());
+    for (const auto &i : order) {
+        words.emplace_back(this->vocabulary.get_word(merged_terms[i]));
+        sorted_entries.emplace_back(entries[i]);
+    }
+    TermDictionary::save(this->index_path_dir + prefix + "tf_idf.dict", words, sorted_entries);
+
+    std::vector<float> norms;
+    norms.reserve(this->doc_ids.size());
+    for (const auto &doc_id : this->doc_ids)
+        norms.emplace_back(doc_norms[doc_id - first_id]);
+    FileBasedLoader::save_norms(this->doc_ids, norms, this->index_path_dir, this->title);
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <functional>
+#include <cstdint>
+#include "TF_IDF.h"
+#include "Vocabulary.h"
+#include "TermDictionary.h"
+#include "Const.h"
+
+/**
+ * Posting of a partial block (document ID and term count)
+ */
+struct block_posting {
+    /** Document ID */
+    int doc_id;
+    /** Term count */
+    uint32_t tf;
+};
+
+/**
+ * Reader of a partial block flushed to the disk
+ * Block file layout: records sorted by term ID, every record is term ID, number of postings and the postings
+ */
+struct block_reader {
+    /** Block file */
+    std::ifstream file{};
+    /** Term ID of the current record (Vocabulary::NO_TERM once the block is read) */
+    uint32_t term = Vocabulary::NO_TERM;
+    /** Number of postings of the current record */
+    uint32_t count = 0;
+
+    /**
+     * Read the header of the next record
+     */
+    void next();
+    /**
+     * Append the postings of the current record and move to the next one
+     * @param postings Postings
+     */
+    void read_postings(std::vector<block_posting> &postings);
+};
+
+/**
+ * Builder of the file based TF-IDF index with bounded memory (single pass, in memory inversion)
+ * Documents are inverted into a block in memory, the block is flushed to the disk sorted by term ID whenever it
+ * reaches MEMORY_BUDGET and the blocks are merged into the posting file and the term dictionary at the end
+ */
+class BlockIndexBuilder {
+private:
+    /** Path to the directory the blocks and the built files are written to */
+    std::string index_path_dir;
+    /** Whether the index is built for titles */
+    bool title;
+    /** Memory budget of a block in bytes */
+    size_t budget;
+    /** Terms of all the documents (same IDs as the in memory index gives out) */
+    Vocabulary vocabulary;
+    /** Postings of the current block indexed by term ID */
+    std::vector<std::vector<block_posting>> block;
+    /** Terms that have postings in the current block */
+    std::vector<uint32_t> block_terms;
+    /** Approximate size of the current block in bytes */
+    size_t block_size = 0;
+    /** Paths of the blocks waiting for the merge */
+    std::vector<std::string> blocks;
+    /** Number of the written blocks (names of the blocks) */
+    size_t blocks_count = 0;
+    /** DF of the content terms (titles are weighted by the IDF of the content) */
+    std::vector<uint32_t> content_df;
+    /** IDs of the added documents */
+    std::vector<int> doc_ids;
+    /** Buffers reused between the documents */
+    std::vector<uint32_t> terms;
+    std::vector<std::pair<uint32_t, uint32_t>> counts;
+
+    /**
+     * Get the path of a new block
+     * @return Path
+     */
+    std::string next_block_path();
+    /**
+     * Write a record of a block
+     * @param output Block file
+     * @param term Term ID
+     * @param postings Postings of the term
+     */
+    static void write_record(std::ofstream &output, uint32_t term, const std::vector<block_posting> &postings);
+    /**
+     * Write the current block to the disk and clear it
+     */
+    void flush();
+    /**
+     * Merge the given blocks, the postings of every term are handed over in ascending term order (the blocks are removed)
+     * @param paths Paths of the blocks
+     * @param callback Callback taking the term ID and its postings sorted by document ID
+     */
+    static void merge(const std::vector<std::string> &paths, const std::function<void(uint32_t, std::vector<block_posting> &)> &callback);
+
+public:
+    /** Maximum number of the blocks merged at once (every merged block is an open file) */
+    static constexpr size_t MERGE_WAYS = 64;
+
+    /**
+     * Constructor for the BlockIndexBuilder class
+     * @param index_path_dir Path to the directory the blocks and the built files are written to
+     * @param title Whether to build the index for titles
+     */
+    BlockIndexBuilder(const std::string &index_path_dir, bool title);
+
+    /**
+     * Add a document to the index (documents can come in any order)
+     * @param doc Tokenized document
+     */
+    void add(const TokenizedDocument &doc);
+    /**
+     * Merge the blocks and save the postings, term dictionary and norms (the blocks are removed)
+     */
+    void finish();
+};
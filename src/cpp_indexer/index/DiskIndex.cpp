@@ -0,0 +1,114 @@
+#include "DiskIndex.h"
+
+#include <algorithm>
+
+DiskIndex::DiskIndex(const std::string &index_path_dir) :
+        dictionary(index_path_dir + "tf_idf.dict"),
+        title_dictionary(index_path_dir + "title_tf_idf.dict"),
+        positions_dictionary(index_path_dir + "positions.dict"),
+        postings(index_path_dir + "tf_idf.postings", std::ios::binary),
+        title_postings(index_path_dir + "title_tf_idf.postings", std::ios::binary),
+        positions(index_path_dir + "positions.postings", std::ios::binary),
+        norms(FileBasedLoader::load_norms(index_path_dir)),
+        title_norms(FileBasedLoader::load_norms(index_path_dir, true)),
+        docs(index_path_dir + "docs.dict", index_path_dir + "docs.store"),
+        live_docs(),
+        posting_cache(POSTING_CACHE_SIZE),
+        positions_cache(POSITIONS_CACHE_SIZE),
+        mutex() {
+    auto doc_ids = this->docs.get_doc_ids();
+    std::sort(doc_ids.begin(), doc_ids.end());
+    this->live_docs = DocBitmap(doc_ids);
+}
+
+std::string DiskIndex::read(std::ifstream &file, uint64_t offset, size_t size) {
+    std::string buffer(size, '\0');
+    file.clear();
+    file.seekg(static_cast<std::streamoff>(offset));
+    file.read(buffer.data(), static_cast<std::streamsize>(size));
+    if (static_cast<size_t>(file.gcount()) != size)
+        throw std::runtime_error("[ERROR]: Unexpected end of the index file!");
+    return buffer;
+}
+
+std::shared_ptr<const map_element> DiskIndex::get_postings(const std::string &word, bool title) {
+    term_entry entry{};
+    if (!(title ? this->title_dictionary : this->dictionary).find(word, entry))
+        return nullptr;
+
+    std::lock_guard<std::mutex> lock(this->mutex);
+    std::string key = (title ? "t:" : "c:") + word;
+    if (auto cached = this->posting_cache.get(key))
+        return cached;
+
+    auto element = std::make_shared<map_element>();
+    element->idf = entry.idf;
+    element->max_score = entry.max_score;
+    try {
+        /* Compressed posting list, decoded block by block only when searching */
+        auto buffer = read(title ? this->title_postings : this->postings, entry.offset, entry.size);
+        BinaryReader reader(buffer.data(), buffer.size());
+        element->postings.from_binary(reader);
+    } catch (const std::runtime_error &e) {
+        std::cerr << e.what() << std::endl;
+        return nullptr;
+    }
+
+    this->posting_cache.put(key, element, element->postings.bytes() + key.size());
+    return element;
+}
+
+std::shared_ptr<const PositionList> DiskIndex::get_positions(const std::string &word) {
+    term_entry entry{};
+    if (!this->positions_dictionary.find(word, entry))
+        return nullptr;
+
+    std::lock_guard<std::mutex> lock(this->mutex);
+    if (auto cached = this->positions_cache.get(word))
+        return cached;
+
+    auto doc_positions = std::make_shared<PositionList>();
+    try {
+        /* Positions stay compressed in the cache, only the searched documents are decoded */
+        auto buffer = read(this->positions, entry.offset, entry.size);
+        BinaryReader reader(buffer.data(), buffer.size());
+        doc_positions->from_binary(reader);
+    } catch (const std::runtime_error &e) {
+        std::cerr << e.what() << std::endl;
+        return nullptr;
+    }
+
+    this->positions_cache.put(word, doc_positions, doc_positions->bytes() + word.size());
+    return doc_positions;
+}
+
+const std::map<int, float> &DiskIndex::get_norms(bool title) const {
+    return title ? this->title_norms : this->norms;
+}
+
+bool DiskIndex::get_doc(int doc_id, Document &doc) {
+    /* Document store reads from one shared stream */
+    std::lock_guard<std::mutex> lock(this->mutex);
+    return this->docs.get_doc(doc_id, doc);
+}
+
+bool DiskIndex::get_tokenized_doc(int doc_id, TokenizedDocument &doc) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    return this->docs.get_tokenized_doc(doc_id, doc);
+}
+
+std::vector<int> DiskIndex::get_doc_ids() const {
+    return this->docs.get_doc_ids();
+}
+
+const DocBitmap &DiskIndex::get_live_docs() const {
+    return this->live_docs;
+}
+
+size_t DiskIndex::get_index_size(bool title) const {
+    return (title ? this->title_dictionary : this->dictionary).size();
+}
+
+size_t DiskIndex::get_collection_size() const {
+    return this->docs.size();
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <fstream>
+#include "TF_IDF.h"
+#include "PositionList.h"
+#include "DocBitmap.h"
+#include "TermDictionary.h"
+#include "DocStore.h"
+#include "LruCache.h"
+
+/**
+ * Read side of the file based index
+ * Term dictionaries are memory mapped, postings and positions are read per word and kept in a small
+ * bounded cache, so a query only reads the data of its own words and the memory use stays low
+ */
+class DiskIndex {
+private:
+    /** Content term dictionary */
+    TermDictionary dictionary;
+    /** Title term dictionary */
+    TermDictionary title_dictionary;
+    /** Positions dictionary */
+    TermDictionary positions_dictionary;
+    /** Content postings */
+    std::ifstream postings;
+    /** Title postings */
+    std::ifstream title_postings;
+    /** Positions of the words */
+    std::ifstream positions;
+    /** Document norms (one float per document, kept in memory) */
+    std::map<int, float> norms;
+    /** Title norms (one float per document, kept in memory) */
+    std::map<int, float> title_norms;
+    /** Documents and tokenized documents */
+    DocStore docs;
+    /** IDs of all the documents (universe of NOT) */
+    DocBitmap live_docs;
+    /** Cache of the recently used postings */
+    LruCache<map_element> posting_cache;
+    /** Cache of the recently used positions */
+    LruCache<PositionList> positions_cache;
+    /** Lock for the files and caches */
+    std::mutex mutex;
+
+    /**
+     * Read bytes from the given file
+     * @param file File
+     * @param offset Offset in the file
+     * @param size Number of bytes
+     * @return Read bytes
+     */
+    static std::string read(std::ifstream &file, uint64_t offset, size_t size);
+
+public:
+    /** Size of the posting cache in bytes */
+    static constexpr size_t POSTING_CACHE_SIZE = 4 * 1024 * 1024;
+    /** Size of the positions cache in bytes */
+    static constexpr size_t POSITIONS_CACHE_SIZE = 4 * 1024 * 1024;
+
+    /**
+     * Open the file based index in the given directory
+     * @param index_path_dir Path to the directory with the index
+     */
+    explicit DiskIndex(const std::string &index_path_dir);
+
+    /**
+     * Get IDF, upper bound and postings of the given word
+     * @param word Word
+     * @param title Whether to use the title index
+     * @return Map element of the word or nullptr if the word is not in the index
+     */
+    std::shared_ptr<const map_element> get_postings(const std::string &word, bool title = false);
+    /**
+     * Get positions of the given word
+     * @param word Word
+     * @return Compact positions of the word or nullptr if the word has no positions
+     */
+    std::shared_ptr<const PositionList> get_positions(const std::string &word);
+    /**
+     * Get the document norms
+     * @param title Whether to get the title norms
+     * @return Norms
+     */
+    [[nodiscard]] const std::map<int, float> &get_norms(bool title = false) const;
+    /**
+     * Get the document with the given ID
+     * @param doc_id Document ID
+     * @param doc Document
+     * @return True if the document exists
+     */
+    bool get_doc(int doc_id, Document &doc);
+    /**
+     * Get the tokenized document with the given ID
+     * @param doc_id Document ID
+     * @param doc Tokenized document
+     * @return True if the document exists
+     */
+    bool get_tokenized_doc(int doc_id, TokenizedDocument &doc);
+    /**
+     * Get IDs of all the documents in ascending order
+     * @return Document IDs
+     */
+    [[nodiscard]] std::vector<int> get_doc_ids() const;
+    /**
+     * Get IDs of all the documents as a bitmap (built once when the index is opened)
+     * @return Document IDs
+     */
+    [[nodiscard]] const DocBitmap &get_live_docs() const;
+    /**
+     * Get the number of words in the index
+     * @param title Whether to use the title index
+     * @return Number of words
+     */
+    [[nodiscard]] size_t get_index_size(bool title = false) const;
+    /**
+     * Get the number of documents
+     * @return Number of documents
+     */
+    [[nodiscard]] size_t get_collection_size() const;
+};
@@ -0,0 +1,261 @@
+#include "DocBitmap.h"
+
+#include <algorithm>
+#include <bit>
+
+DocBitmap::DocBitmap() : containers() {
+    /* Nothing to do here :) */
+}
+
+DocBitmap::DocBitmap(const std::vector<int> &doc_ids) : containers() {
+    for (const auto &doc_id : doc_ids)
+        this->push_back(doc_id);
+}
+
+uint32_t DocBitmap::encode(int doc_id) {
+    return static_cast<uint32_t>(doc_id) ^ 0x80000000u;
+}
+
+int DocBitmap::decode(uint32_t value) {
+    return static_cast<int>(value ^ 0x80000000u);
+}
+
+size_t DocBitmap::gallop(const std::vector<uint16_t> &values, size_t from, uint16_t value) {
+    if (from >= values.size() || values[from] >= value)
+        return from;
+
+    /* Double the step until the value is overshot, then binary search the last step */
+    size_t low = from;
+    size_t step = 1;
+    while (low + step < values.size() && values[low + step] < value) {
+        low += step;
+        step *= 2;
+    }
+    auto high = std::min(low + step, values.size());
+    return std::lower_bound(values.begin() + static_cast<long>(low) + 1, values.begin() + static_cast<long>(high), value) - values.begin();
+}
+
+void DocBitmap::normalize(bitmap_container &container) {
+    if (container.is_bitmap() && container.cardinality <= ARRAY_LIMIT) {
+        container.array.clear();
+        container.array.reserve(container.cardinality);
+        for (size_t i = 0; i < BITMAP_WORDS; i++)
+            for (uint64_t word = container.bits[i]; word != 0; word &= word - 1)
+                container.array.emplace_back(static_cast<uint16_t>(i * 64 + std::countr_zero(word)));
+        container.bits.clear();
+        container.bits.shrink_to_fit();
+    } else if (!container.is_bitmap() && container.cardinality > ARRAY_LIMIT) {
+        container.bits.assign(BITMAP_WORDS, 0);
+        for (const auto &low : container.array)
+            container.bits[low >> 6] |= uint64_t(1) << (low & 63);
+        container.array.clear();
+        container.array.shrink_to_fit();
+    }
+}
+
+bitmap_container DocBitmap::intersect(const bitmap_container &first, const bitmap_container &second) {
+    bitmap_container result;
+    result.key = first.key;
+    if (first.is_bitmap() && second.is_bitmap()) {
+        result.bits.resize(BITMAP_WORDS);
+        for (size_t i = 0; i < BITMAP_WORDS; i++) {
+            result.bits[i] = first.bits[i] & second.bits[i];
+            result.cardinality += std::popcount(result.bits[i]);
+        }
+    } else if (first.is_bitmap() || second.is_bitmap()) {
+        /* Sparse side is checked against the bits of the dense side */
+        const auto &sparse = first.is_bitmap() ? second : first;
+        const auto &dense = first.is_bitmap() ? first : second;
+        for (const auto &low : sparse.array)
+            if (dense.bits[low >> 6] & (uint64_t(1) << (low & 63)))
+                result.array.emplace_back(low);
+        result.cardinality = result.array.size();
+    } else {
+        const auto &shorter = first.array.size() <= second.array.size() ? first.array : second.array;
+        const auto &longer = first.array.size() <= second.array.size() ? second.array : first.array;
+        if (shorter.size() * GALLOP_RATIO < longer.size()) {
+            /* Few values against many - gallop in the long array */
+            size_t j = 0;
+            for (const auto &low : shorter) {
+                j = gallop(longer, j, low);
+                if (j >= longer.size())
+                    break;
+                if (longer[j] == low)
+                    result.array.emplace_back(low);
+            }
+        } else {
+            std::set_intersection(shorter.begin(), shorter.end(), longer.begin(), longer.end(), std::back_inserter(result.array));
+        }
+        result.cardinality = result.array.size();
+    }
+    normalize(result);
+    return result;
+}
+
+bitmap_container DocBitmap::unite(const bitmap_container &first, const bitmap_container &second) {
+    bitmap_container result;
+    result.key = first.key;
+    if (first.is_bitmap() || second.is_bitmap()) {
+        /* Dense side is copied and the other one is added to it */
+        const auto &dense = first.is_bitmap() ? first : second;
+        const auto &other = first.is_bitmap() ? second : first;
+        result.bits = dense.bits;
+        if (other.is_bitmap())
+            for (size_t i = 0; i < BITMAP_WORDS; i++)
+                result.bits[i] |= other.bits[i];
+        else
+            for (const auto &low : other.array)
+                result.bits[low >> 6] |= uint64_t(1) << (low & 63);
+        for (const auto &word : result.bits)
+            result.cardinality += std::popcount(word);
+    } else {
+        std::set_union(first.array.begin(), first.array.end(), second.array.begin(), second.array.end(), std::back_inserter(result.array));
+        result.cardinality = result.array.size();
+    }
+    normalize(result);
+    return result;
+}
+
+bitmap_container DocBitmap::subtract(const bitmap_container &first, const bitmap_container &second) {
+    bitmap_container result;
+    result.key = first.key;
+    if (first.is_bitmap()) {
+        result.bits = first.bits;
+        if (second.is_bitmap())
+            for (size_t i = 0; i < BITMAP_WORDS; i++)
+                result.bits[i] &= ~second.bits[i];
+        else
+            for (const auto &low : second.array)
+                result.bits[low >> 6] &= ~(uint64_t(1) << (low & 63));
+        for (const auto &word : result.bits)
+            result.cardinality += std::popcount(word);
+    } else if (second.is_bitmap()) {
+        for (const auto &low : first.array)
+            if (!(second.bits[low >> 6] & (uint64_t(1) << (low & 63))))
+                result.array.emplace_back(low);
+        result.cardinality = result.array.size();
+    } else if (first.array.size() * GALLOP_RATIO < second.array.size()) {
+        /* Few values against many - gallop in the long array */
+        size_t j = 0;
+        for (const auto &low : first.array) {
+            j = gallop(second.array, j, low);
+            if (j >= second.array.size() || second.array[j] != low)
+                result.array.emplace_back(low);
+        }
+        result.cardinality = result.array.size();
+    } else {
+        std::set_difference(first.array.begin(), first.array.end(), second.array.begin(), second.array.end(), std::back_inserter(result.array));
+        result.cardinality = result.array.size();
+    }
+    normalize(result);
+    return result;
+}
+
+void DocBitmap::push_back(int doc_id) {
+    auto value = encode(doc_id);
+    auto key = static_cast<uint16_t>(value >> 16);
+    auto low = static_cast<uint16_t>(value & 0xFFFF);
+    if (this->containers.empty() || this->containers.back().key != key) {
+        this->containers.emplace_back();
+        this->containers.back().key = key;
+    }
+
+    auto &container = this->containers.back();
+    if (container.is_bitmap())
+        container.bits[low >> 6] |= uint64_t(1) << (low & 63);
+    else
+        container.array.emplace_back(low);
+    container.cardinality++;
+    normalize(container);
+}
+
+void DocBitmap::intersect(const DocBitmap &other) {
+    std::vector<bitmap_container> result;
+    size_t j = 0;
+    for (const auto &container : this->containers) {
+        while (j < other.containers.size() && other.containers[j].key < container.key)
+            j++;
+        if (j >= other.containers.size())
+            break;
+        if (other.containers[j].key != container.key)
+            continue;
+        auto intersection = intersect(container, other.containers[j]);
+        if (intersection.cardinality > 0)
+            result.emplace_back(std::move(intersection));
+    }
+    this->containers = std::move(result);
+}
+
+void DocBitmap::unite(const DocBitmap &other) {
+    std::vector<bitmap_container> result;
+    result.reserve(this->containers.size() + other.containers.size());
+    size_t i = 0;
+    size_t j = 0;
+    while (i < this->containers.size() || j < other.containers.size()) {
+        if (j >= other.containers.size() || (i < this->containers.size() && this->containers[i].key < other.containers[j].key))
+            result.emplace_back(std::move(this->containers[i++]));
+        else if (i >= this->containers.size() || other.containers[j].key < this->containers[i].key)
+            result.emplace_back(other.containers[j++]);
+        else
+            result.emplace_back(unite(this->containers[i++], other.containers[j++]));
+    }
+    this->containers = std::move(result);
+}
+
+void DocBitmap::subtract(const DocBitmap &other) {
+    std::vector<bitmap_container> result;
+    result.reserve(this->containers.size());
+    size_t j = 0;
+    for (auto &container : this->containers) {
+        while (j < other.containers.size() && other.containers[j].key < container.key)
+            j++;
+        if (j >= other.containers.size() || other.containers[j].key != container.key) {
+            result.emplace_back(std::move(container));
+            continue;
+        }
+        auto difference = subtract(container, other.containers[j]);
+        if (difference.cardinality > 0)
+            result.emplace_back(std::move(difference));
+    }
+    this->containers = std::move(result);
+}
+
+bool DocBitmap::contains(int doc_id) const {
+    auto value = encode(doc_id);
+    auto key = static_cast<uint16_t>(value >> 16);
+    auto low = static_cast<uint16_t>(value & 0xFFFF);
+    auto it = std::lower_bound(this->containers.begin(), this->containers.end(), key, [](const bitmap_container &container, uint16_t k) { return container.key < k; });
+    if (it == this->containers.end() || it->key != key)
+        return false;
+    if (it->is_bitmap())
+        return (it->bits[low >> 6] >> (low & 63)) & 1;
+    return std::binary_search(it->array.begin(), it->array.end(), low);
+}
+
+size_t DocBitmap::size() const {
+    size_t count = 0;
+    for (const auto &container : this->containers)
+        count += container.cardinality;
+    return count;
+}
+
+bool DocBitmap::empty() const {
+    return this->containers.empty();
+}
+
+std::vector<int> DocBitmap::to_vector() const {
+    std::vector<int> doc_ids;
+    doc_ids.reserve(this->size());
+    for (const auto &container : this->containers) {
+        uint32_t high = static_cast<uint32_t>(container.key) << 16;
+        if (container.is_bitmap()) {
+            for (size_t i = 0; i < BITMAP_WORDS; i++)
+                for (uint64_t word = container.bits[i]; word != 0; word &= word - 1)
+                    doc_ids.emplace_back(decode(high | static_cast<uint32_t>(i * 64 + std::countr_zero(word))));
+        } else {
+            for (const auto &low : container.array)
+                doc_ids.emplace_back(decode(high | low));
+        }
+    }
+    return doc_ids;
+}
@@ -0,0 +1,148 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * Document IDs sharing the upper 16 bits
+ * Sparse containers keep the sorted lower 16 bits, dense containers keep a bit for every possible ID
+ */
+struct bitmap_container {
+    /** Upper 16 bits of the document IDs */
+    uint16_t key = 0;
+    /** Number of document IDs */
+    uint32_t cardinality = 0;
+    /** Lower 16 bits of the document IDs (sorted, sparse container only) */
+    std::vector<uint16_t> array{};
+    /** Bits of the document IDs (dense container only) */
+    std::vector<uint64_t> bits{};
+
+    /**
+     * Whether the container is dense
+     * @return True if the IDs are kept as bits
+     */
+    [[nodiscard]] bool is_bitmap() const {
+        return !bits.empty();
+    }
+};
+
+/**
+ * Compressed set of document IDs (Roaring-style bitmap)
+ * IDs are split by the upper 16 bits into containers, every container picks its representation by its cardinality -
+ * sorted array when sparse (intersected by merging, or by galloping when the sizes differ a lot), bitmap when dense
+ * (combined a 64-bit word at a time)
+ */
+class DocBitmap {
+private:
+    /** Containers sorted by their keys */
+    std::vector<bitmap_container> containers;
+
+    /** Maximum cardinality of a sparse container (it takes as much memory as a dense one at this point) */
+    static constexpr uint32_t ARRAY_LIMIT = 4096;
+    /** Number of 64-bit words of a dense container */
+    static constexpr size_t BITMAP_WORDS = 65536 / 64;
+    /** Size ratio of two sparse containers from which the smaller one is galloped into the larger one */
+    static constexpr size_t GALLOP_RATIO = 32;
+
+    /**
+     * Map the document ID to an unsigned value keeping the order (negative IDs come first)
+     * @param doc_id Document ID
+     * @return Unsigned value
+     */
+    static uint32_t encode(int doc_id);
+    /**
+     * Map the unsigned value back to the document ID
+     * @param value Unsigned value
+     * @return Document ID
+     */
+    static int decode(uint32_t value);
+    /**
+     * Find the first value >= the given one using galloping search
+     * @param values Sorted values
+     * @param from Index to start the search from
+     * @param value Value
+     * @return Index of the value (size of the values if there is none)
+     */
+    static size_t gallop(const std::vector<uint16_t> &values, size_t from, uint16_t value);
+    /**
+     * Switch the container to the representation fitting its cardinality
+     * @param container Container
+     */
+    static void normalize(bitmap_container &container);
+    /**
+     * Intersection of two containers with the same key
+     * @param first First container
+     * @param second Second container
+     * @return Intersection
+     */
+    static bitmap_container intersect(const bitmap_container &first, const bitmap_container &second);
+    /**
+     * Union of two containers with the same key
+     * @param first First container
+     * @param second Second container
+     * @return Union
+     */
+    static bitmap_container unite(const bitmap_container &first, const bitmap_container &second);
+    /**
+     * Difference of two containers with the same key
+     * @param first First container
+     * @param second Container to subtract
+     * @return Difference
+     */
+    static bitmap_container subtract(const bitmap_container &first, const bitmap_container &second);
+
+public:
+    /**
+     * Constructor for the DocBitmap class (empty set)
+     */
+    DocBitmap();
+    /**
+     * Constructor for the DocBitmap class
+     * @param doc_ids Document IDs (sorted)
+     */
+    explicit DocBitmap(const std::vector<int> &doc_ids);
+
+    /**
+     * Add a document ID higher than all the IDs in the set
+     * @param doc_id Document ID
+     */
+    void push_back(int doc_id);
+    /**
+     * Keep only the documents that are also in the other set (AND)
+     * @param other Other set
+     */
+    void intersect(const DocBitmap &other);
+    /**
+     * Add the documents of the other set (OR)
+     * @param other Other set
+     */
+    void unite(const DocBitmap &other);
+    /**
+     * Remove the documents of the other set (AND NOT)
+     * @param other Other set
+     */
+    void subtract(const DocBitmap &other);
+
+    /**
+     * Whether the set has the given document
+     * @param doc_id Document ID
+     * @return True if the document is in the set
+     */
+    [[nodiscard]] bool contains(int doc_id) const;
+    /**
+     * Get the number of documents
+     * @return Number of documents
+     */
+    [[nodiscard]] size_t size() const;
+    /**
+     * Whether the set has no documents
+     * @return True if empty
+     */
+    [[nodiscard]] bool empty() const;
+    /**
+     * Get the document IDs
+     * @return Document IDs in ascending order
+     */
+    [[nodiscard]] std::vector<int> to_vector() const;
+};
@@ -0,0 +1,190 @@
+#include "ImpactIndex.h"
+
+#include <cstring>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define IMPACT_X86
+#define IMPACT_TARGET(isa) __attribute__((target(isa)))
+#include <immintrin.h>
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#define IMPACT_X86
+#define IMPACT_TARGET(isa)
+#include <immintrin.h>
+#include <intrin.h>
+#endif
+
+/**
+ * Add weight * impact of the postings to the scores of their documents (scalar fallback and tail of the vector kernels)
+ * @param doc_ids Document IDs
+ * @param impacts Quantized impacts
+ * @param count Number of postings
+ * @param weight Weight of one quantization step
+ * @param scores Dense scores indexed by document ID
+ */
+template<typename T>
+static void accumulate_scalar(const int *doc_ids, const T *impacts, size_t count, float weight, float *scores) {
+    for (size_t i = 0; i < count; i++)
+        scores[doc_ids[i]] += weight * static_cast<float>(impacts[i]);
+}
+
+#ifdef IMPACT_X86
+/**
+ * Same as accumulate_scalar, 4 postings at a time (SSE4.1)
+ */
+template<typename T>
+IMPACT_TARGET("sse4.1") static void accumulate_sse41(const int *doc_ids, const T *impacts, size_t count, float weight, float *scores) {
+    const __m128 step = _mm_set1_ps(weight);
+    alignas(16) float sums[4];
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128i quantized;
+        if constexpr (sizeof(T) == 1) {
+            int32_t packed;
+            std::memcpy(&packed, impacts + i, sizeof(packed));
+            quantized = _mm_cvtepu8_epi32(_mm_cvtsi32_si128(packed));
+        } else {
+            quantized = _mm_cvtepu16_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(impacts + i)));
+        }
+        __m128 sum = _mm_setr_ps(scores[doc_ids[i]], scores[doc_ids[i + 1]], scores[doc_ids[i + 2]], scores[doc_ids[i + 3]]);
+        sum = _mm_add_ps(sum, _mm_mul_ps(step, _mm_cvtepi32_ps(quantized)));
+        _mm_store_ps(sums, sum);
+        for (int lane = 0; lane < 4; lane++)
+            scores[doc_ids[i + lane]] = sums[lane];
+    }
+    accumulate_scalar(doc_ids + i, impacts + i, count - i, weight, scores);
+}
+
+/**
+ * Same as accumulate_scalar, 8 postings at a time (AVX2, the scores are gathered)
+ */
+template<typename T>
+IMPACT_TARGET("avx2") static void accumulate_avx2(const int *doc_ids, const T *impacts, size_t count, float weight, float *scores) {
+    const __m256 step = _mm256_set1_ps(weight);
+    alignas(32) float sums[8];
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i ids = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(doc_ids + i));
+        __m256i quantized;
+        if constexpr (sizeof(T) == 1)
+            quantized = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(impacts + i)));
+        else
+            quantized = _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(impacts + i)));
+        /* Documents of one posting list are distinct, so the lanes never write the same score */
+        __m256 sum = _mm256_i32gather_ps(scores, ids, sizeof(float));
+        sum = _mm256_add_ps(sum, _mm256_mul_ps(step, _mm256_cvtepi32_ps(quantized)));
+        _mm256_store_ps(sums, sum);
+        for (int lane = 0; lane < 8; lane++)
+            scores[doc_ids[i + lane]] = sums[lane];
+    }
+    accumulate_scalar(doc_ids + i, impacts + i, count - i, weight, scores);
+}
+#endif
+
+/**
+ * Run the kernel of the detected instruction set
+ * @param doc_ids Document IDs
+ * @param impacts Quantized impacts
+ * @param count Number of postings
+ * @param weight Weight of one quantization step
+ * @param scores Dense scores indexed by document ID
+ */
+template<typename T>
+static void accumulate_dispatch(const int *doc_ids, const T *impacts, size_t count, float weight, float *scores) {
+    switch (ImpactIndex::get_simd_level()) {
+#ifdef IMPACT_X86
+        case SimdLevel::AVX2:
+            accumulate_avx2(doc_ids, impacts, count, weight, scores);
+            return;
+        case SimdLevel::SSE41:
+            accumulate_sse41(doc_ids, impacts, count, weight, scores);
+            return;
+#endif
+        default:
+            accumulate_scalar(doc_ids, impacts, count, weight, scores);
+    }
+}
+
+ImpactIndex::ImpactIndex() : postings(), bits(8) {
+    /* Nothing to do here :) */
+}
+
+ImpactIndex::ImpactIndex(const std::vector<map_element> &index, const std::map<int, float> &norms, int bits) : postings(index.size()), bits(bits > 8 ? 16 : 8) {
+    float max_quantized = this->bits == 16 ? UINT16_MAX : UINT8_MAX;
+    std::vector<float> impacts;
+    for (uint32_t term = 0; term < index.size(); term++) {
+        const auto &element = index[term];
+        auto &list = this->postings[term];
+        impacts.clear();
+        element.postings.for_each([&](int doc_id, uint32_t tf) {
+            /* Documents with zero norm score 0 in the float path too */
+            auto it = norms.find(doc_id);
+            if (it == norms.end() || it->second <= 0)
+                return;
+            list.doc_ids.emplace_back(doc_id);
+            impacts.emplace_back(TF_IDF::tf_weight(tf) * element.idf / it->second);
+        });
+        float max_impact = impacts.empty() ? 0 : *std::max_element(impacts.begin(), impacts.end());
+        /* Words with zero IDF add nothing to any score */
+        if (max_impact <= 0) {
+            list = impact_postings();
+            continue;
+        }
+
+        /* Every posting keeps at least one step, so the documents that match in the float path match here too */
+        list.scale = max_impact / max_quantized;
+        list.max_impact = static_cast<uint16_t>(max_quantized);
+        for (const auto &impact : impacts) {
+            auto quantized = std::clamp(std::round(impact / list.scale), 1.0f, max_quantized);
+            if (this->bits == 16)
+                list.impacts16.emplace_back(static_cast<uint16_t>(quantized));
+            else
+                list.impacts8.emplace_back(static_cast<uint8_t>(quantized));
+        }
+    }
+}
+
+const impact_postings *ImpactIndex::get(uint32_t term) const {
+    if (term >= this->postings.size() || this->postings[term].doc_ids.empty())
+        return nullptr;
+    return &this->postings[term];
+}
+
+bool ImpactIndex::empty() const {
+    return this->postings.empty();
+}
+
+void ImpactIndex::accumulate(const impact_postings &list, float weight, float *scores) const {
+    if (this->bits == 16)
+        accumulate_dispatch(list.doc_ids.data(), list.impacts16.data(), list.doc_ids.size(), weight, scores);
+    else
+        accumulate_dispatch(list.doc_ids.data(), list.impacts8.data(), list.doc_ids.size(), weight, scores);
+}
+
+SimdLevel ImpactIndex::get_simd_level() {
+    static const SimdLevel level = [] {
+#if defined(IMPACT_X86) && defined(__GNUC__)
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2"))
+            return SimdLevel::AVX2;
+        if (__builtin_cpu_supports("sse4.1"))
+            return SimdLevel::SSE41;
+#elif defined(IMPACT_X86)
+        /* AVX2 needs the CPU flag and the OS saving the YMM registers */
+        int info[4];
+        __cpuid(info, 0);
+        int max_leaf = info[0];
+        __cpuid(info, 1);
+        bool sse41 = info[2] & (1 << 19);
+        bool avx = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && (_xgetbv(0) & 6) == 6;
+        if (avx && max_leaf >= 7) {
+            __cpuidex(info, 7, 0);
+            if (info[1] & (1 << 5))
+                return SimdLevel::AVX2;
+        }
+        if (sse41)
+            return SimdLevel::SSE41;
+#endif
+        return SimdLevel::SCALAR;
+    }();
+    return level;
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <vector>
+#include <map>
+#include <cstdint>
+#include "TF_IDF.h"
+#include "Const.h"
+
+/**
+ * Postings of a word with precomputed impacts (struct of arrays, so the kernels load whole vectors)
+ * Impact of a posting is its TF-IDF divided by the norm of the document, quantized to 8 or 16 bits
+ */
+struct impact_postings {
+    /** Document IDs (ascending) */
+    std::vector<int> doc_ids{};
+    /** Quantized impacts (8 bit index) */
+    std::vector<uint8_t> impacts8{};
+    /** Quantized impacts (16 bit index) */
+    std::vector<uint16_t> impacts16{};
+    /** Impact of one quantization step */
+    float scale = 0;
+    /** Largest quantized impact of the list (upper bound of the list in MaxScore) */
+    uint16_t max_impact = 0;
+};
+
+/**
+ * Instruction set used by the impact kernels
+ */
+enum class SimdLevel {
+    SCALAR,
+    SSE41,
+    AVX2
+};
+
+/**
+ * Index of the quantized impacts (indexed by term ID)
+ * Scores of the vector model are sums of query weight * impact, so no norm is looked up at query time
+ */
+class ImpactIndex {
+private:
+    /** Postings with impacts indexed by term ID */
+    std::vector<impact_postings> postings;
+    /** Bits of the quantized impacts (8 or 16) */
+    int bits;
+
+public:
+    /**
+     * Constructor for the ImpactIndex class (empty index)
+     */
+    ImpactIndex();
+    /**
+     * Constructor for the ImpactIndex class
+     * @param index Index (indexed by term ID, IDF and postings are used)
+     * @param norms Document norms
+     * @param bits Bits of the quantized impacts (8 or 16)
+     */
+    ImpactIndex(const std::vector<map_element> &index, const std::map<int, float> &norms, int bits);
+
+    /**
+     * Get the postings of the word
+     * @param term Term ID
+     * @return Postings (nullptr if the word has no postings)
+     */
+    [[nodiscard]] const impact_postings *get(uint32_t term) const;
+    /**
+     * Whether the index was built
+     * @return True if there are no postings
+     */
+    [[nodiscard]] bool empty() const;
+    /**
+     * Add weight * impact of every posting to the score of its document
+     * @param list Postings
+     * @param weight Weight of one quantization step (query weight * scale)
+     * @param scores Dense scores indexed by document ID (have to cover all the documents of the postings)
+     */
+    void accumulate(const impact_postings &list, float weight, float *scores) const;
+
+    /**
+     * Get the instruction set of the kernels (detected once at runtime)
+     * @return Instruction set
+     */
+    static SimdLevel get_simd_level();
+};
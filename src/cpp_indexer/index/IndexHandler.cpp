@@ -1,12 +1,34 @@
 #include "IndexHandler.h"
 
+thread_local index_progress *IndexHandler::progress = nullptr;
 Preprocessor IndexHandler::preprocessor = Preprocessor();
+std::vector<std::unique_ptr<Preprocessor>> IndexHandler::worker_preprocessors = std::vector<std::unique_ptr<Preprocessor>>();
+std::mutex IndexHandler::worker_preprocessors_mutex;
+std::mutex IndexHandler::preprocess_mutex;
+
+void IndexHandler::report_progress(index_progress *target) {
+    progress = target;
+}
+
+void IndexHandler::start_phase(IndexPhase phase, size_t total) {
+    if (!progress)
+        return;
+    progress->done = 0;
+    progress->total = total;
+    progress->phase = phase;
+}
+
+void IndexHandler::add_progress(size_t steps) {
+    if (progress)
+        progress->done += steps;
+}
 
 std::vector<Document> IndexHandler::load_documents(const std::string &dir_path, bool verbose) {
     if (verbose)
         std::cout << "Loading documents..." << std::endl;
     auto t_start = std::chrono::high_resolution_clock::now();
 
+    start_phase(IndexPhase::LOAD);
     auto docs = DataLoader::load_json_documents_from_dir(dir_path);
 
     auto t_end = std::chrono::high_resolution_clock::now();
@@ -18,54 +40,185 @@ std::vector<Document> IndexHandler::load_documents(const std::string &dir_path,
     return docs;
 }
 
-std::pair<std::vector<TokenizedDocument>, std::map<std::string, std::map<int, std::vector<int>>>> IndexHandler::preprocess_documents(std::vector<Document> &docs, bool verbose) {
-    if (verbose)
-        std::cout << "Preprocessing documents..." << std::endl;
-    auto t_start = std::chrono::high_resolution_clock::now();
+Preprocessor &IndexHandler::get_worker_preprocessor(size_t worker) {
+    if (worker == 0)
+        return preprocessor;
+    std::lock_guard<std::mutex> lock(worker_preprocessors_mutex);
+    while (worker_preprocessors.size() < worker)
+        worker_preprocessors.emplace_back(std::make_unique<Preprocessor>());
+    return *worker_preprocessors[worker - 1];
+}
+
+Preprocessor &IndexHandler::get_query_preprocessor() {
+    thread_local std::unique_ptr<Preprocessor> query_preprocessor;
+    if (!query_preprocessor) {
+        std::lock_guard<std::mutex> lock(worker_preprocessors_mutex);
+        query_preprocessor = std::make_unique<Preprocessor>();
+    }
+    return *query_preprocessor;
+}
 
-    auto tokenized_docs = std::vector<TokenizedDocument>();
+void IndexHandler::preprocess_range(Preprocessor &preprocessor, std::vector<Document> &docs, size_t begin, size_t end, std::vector<TokenizedDocument> &tokenized_docs, std::map<std::string, std::map<int, std::vector<int>>> &positions_map, index_progress *target) {
     std::map<int, std::map<std::string, std::vector<int>>> positions;
-    for (auto &doc : docs) {
+    for (auto i = begin; i < end; i++) {
+        auto &doc = docs[i];
         auto [title, title_pos] = preprocessor.preprocess_text(doc.title, false);
         auto [toc, toc_pos] = preprocessor.preprocess_text(doc.toc, false);
         auto [h1, h1_pos] = preprocessor.preprocess_text(doc.h1, false);
         auto [h2, h2_pos] = preprocessor.preprocess_text(doc.h2, false);
         auto [h3, h3_pos] = preprocessor.preprocess_text(doc.h3, false);
         auto [content, content_pos] = preprocessor.preprocess_text(doc.content, true);
-        tokenized_docs.emplace_back(doc.id, title, toc, h1, h2, h3, content);
-        positions[doc.id] = content_pos;
+        tokenized_docs[i] = TokenizedDocument(doc.id, title, toc, h1, h2, h3, content);
+        positions[doc.id] = std::move(content_pos);
+        if (target)
+            target->done++;
     }
 
     /* Transform positions to a map of word -> (doc_id, positions) */
-    std::map<std::string, std::map<int, std::vector<int>>> positions_map;
-    for (const auto& [doc_id, doc_positions] : positions)
-        for (const auto& [word, pos] : doc_positions)
-            positions_map[word][doc_id] = pos;
+    for (auto &[doc_id, doc_positions] : positions)
+        for (auto &[word, pos] : doc_positions)
+            positions_map[word][doc_id] = std::move(pos);
+}
+
+void IndexHandler::merge_positions(std::map<std::string, std::map<int, std::vector<int>>> &positions_map, std::vector<int> &doc_ids, std::map<std::string, std::map<int, std::vector<int>>> &other_positions_map, const std::vector<int> &other_doc_ids) {
+    /* Documents with the same ID in both ranges - positions of the earlier one are dropped as a whole */
+    std::vector<int> duplicate_ids;
+    std::set_intersection(doc_ids.begin(), doc_ids.end(), other_doc_ids.begin(), other_doc_ids.end(), std::back_inserter(duplicate_ids));
+    if (!duplicate_ids.empty())
+        for (auto it = positions_map.begin(); it != positions_map.end();) {
+            for (const auto &doc_id : duplicate_ids)
+                it->second.erase(doc_id);
+            if (it->second.empty())
+                it = positions_map.erase(it);
+            else
+                it++;
+        }
+
+    /* Words only in the later range are moved as whole nodes, the rest is merged document by document */
+    positions_map.merge(other_positions_map);
+    for (auto &[word, doc_positions] : other_positions_map) {
+        auto &target = positions_map[word];
+        for (auto &[doc_id, pos] : doc_positions)
+            target.insert_or_assign(doc_id, std::move(pos));
+    }
+    other_positions_map.clear();
+
+    std::vector<int> merged_ids;
+    std::set_union(doc_ids.begin(), doc_ids.end(), other_doc_ids.begin(), other_doc_ids.end(), std::back_inserter(merged_ids));
+    doc_ids = std::move(merged_ids);
+}
+
+std::pair<std::vector<TokenizedDocument>, std::map<std::string, std::map<int, std::vector<int>>>> IndexHandler::preprocess_documents(std::vector<Document> &docs, bool verbose) {
+    auto threads_count = get_threads_count(docs.size());
+    if (verbose)
+        std::cout << "Preprocessing documents (" << threads_count << " threads)..." << std::endl;
+    auto t_start = std::chrono::high_resolution_clock::now();
+
+    std::lock_guard<std::mutex> lock(preprocess_mutex);
+    /* Worker preprocessors are created before starting the threads */
+    std::vector<Preprocessor *> preprocessors;
+    for (size_t i = 0; i < threads_count; i++)
+        preprocessors.emplace_back(&get_worker_preprocessor(i));
+
+    /* Each worker preprocesses a contiguous range of documents into its own partial positions map */
+    auto tokenized_docs = std::vector<TokenizedDocument>(docs.size());
+    std::vector<std::map<std::string, std::map<int, std::vector<int>>>> partial_positions(threads_count);
+    std::vector<std::vector<int>> partial_doc_ids(threads_count);
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < threads_count; i++) {
+        size_t begin = docs.size() * i / threads_count;
+        size_t end = docs.size() * (i + 1) / threads_count;
+        for (auto j = begin; j < end; j++)
+            partial_doc_ids[i].emplace_back(docs[j].id);
+        std::sort(partial_doc_ids[i].begin(), partial_doc_ids[i].end());
+        partial_doc_ids[i].erase(std::unique(partial_doc_ids[i].begin(), partial_doc_ids[i].end()), partial_doc_ids[i].end());
+        if (i == threads_count - 1)
+            preprocess_range(*preprocessors[i], docs, begin, end, tokenized_docs, partial_positions[i], progress);
+        else
+            threads.emplace_back(preprocess_range, std::ref(*preprocessors[i]), std::ref(docs), begin, end, std::ref(tokenized_docs), std::ref(partial_positions[i]), progress);
+    }
+    for (auto &thread : threads)
+        thread.join();
+
+    /* Merge the partial maps pairwise in parallel, always the later range into the earlier one */
+    for (size_t step = 1; step < threads_count; step *= 2) {
+        threads.clear();
+        for (size_t i = 0; i + step < threads_count; i += 2 * step)
+            threads.emplace_back(merge_positions, std::ref(partial_positions[i]), std::ref(partial_doc_ids[i]), std::ref(partial_positions[i + step]), std::cref(partial_doc_ids[i + step]));
+        for (auto &thread : threads)
+            thread.join();
+    }
+    auto positions_map = std::move(partial_positions[0]);
 
     auto t_end = std::chrono::high_resolution_clock::now();
     if (verbose) {
         std::cout << "Preprocessed " << tokenized_docs.size() << " documents" << std::endl;
+        auto &cache = Preprocessor::get_cache();
+        std::cout << "Lemma cache: " << cache.size() << " words, hit rate " << cache.get_hit_rate() * 100 << "%" << std::endl;
         std::cout << "Preprocessing done in " << std::chrono::duration_cast<std::chrono::milliseconds>(t_end - t_start).count() << "ms" << std::endl << std::endl;
     }
 
     return {tokenized_docs, positions_map};
 }
 
+std::tuple<std::vector<Document>, std::vector<TokenizedDocument>, std::map<std::string, std::map<int, std::vector<int>>>> IndexHandler::load_and_preprocess_documents(const std::string &dir_path, bool verbose) {
+    if (verbose)
+        std::cout << "Loading and preprocessing documents..." << std::endl;
+    auto t_start = std::chrono::high_resolution_clock::now();
+
+    std::vector<Document> docs;
+    std::vector<TokenizedDocument> tokenized_docs;
+    std::map<std::string, std::map<int, std::vector<int>>> positions_map;
+    /* Loading of the next batch overlaps with preprocessing, so only the preprocessed documents are counted */
+    start_phase(IndexPhase::PREPROCESS, DataLoader::list_json_files(dir_path).size());
+    DataLoader::stream_json_documents_from_dir(dir_path, [&](std::vector<Document> &batch) {
+        auto [batch_tokenized_docs, batch_positions] = preprocess_documents(batch, false);
+        /* Every batch has new IDs, so the positions never collide */
+        std::vector<int> no_ids;
+        merge_positions(positions_map, no_ids, batch_positions, no_ids);
+        tokenized_docs.insert(tokenized_docs.end(), std::make_move_iterator(batch_tokenized_docs.begin()), std::make_move_iterator(batch_tokenized_docs.end()));
+        docs.insert(docs.end(), std::make_move_iterator(batch.begin()), std::make_move_iterator(batch.end()));
+    });
+
+    auto t_end = std::chrono::high_resolution_clock::now();
+    if (verbose) {
+        std::cout << "Loaded and preprocessed " << docs.size() << " documents" << std::endl;
+        std::cout << "Loading and preprocessing done in " << std::chrono::duration_cast<std::chrono::milliseconds>(t_end - t_start).count() << "ms" << std::endl << std::endl;
+    }
+
+    return {docs, tokenized_docs, positions_map};
+}
+
+void IndexHandler::save_lemma_cache(const std::string &dir_path) {
+    Preprocessor::save_cache((std::filesystem::path(dir_path) / LEMMA_CACHE_FILE).string());
+}
+
+void IndexHandler::load_lemma_cache(const std::string &dir_path) {
+    Preprocessor::load_cache((std::filesystem::path(dir_path) / LEMMA_CACHE_FILE).string());
+}
+
 void IndexHandler::save_index(Indexer &indexer, const string &index_path) {
     std::cout << "Saving index to " << index_path << "..." << std::endl;
     auto t_start = std::chrono::high_resolution_clock::now();
 
+    start_phase(IndexPhase::SAVE);
     DataLoader::save_index_to_file(indexer, index_path);
+    save_lemma_cache(std::filesystem::path(index_path).parent_path().string());
 
     auto t_end = std::chrono::high_resolution_clock::now();
     std::cout << "Index saved in " << std::chrono::duration_cast<std::chrono::milliseconds>(t_end - t_start).count() << "ms" << std::endl << std::endl;
 }
 
-void IndexHandler::load_index(Indexer &indexer, const string &index_path) {
+bool IndexHandler::load_index(Indexer &indexer, const string &index_path) {
     std::cout << "Loading index from " << index_path << "..." << std::endl;
     auto t_start = std::chrono::high_resolution_clock::now();
 
-    DataLoader::load_index_from_file(indexer, index_path);
+    start_phase(IndexPhase::LOAD);
+    if (!DataLoader::load_index_from_file(indexer, index_path))
+        return false;
+    /* All the indices in the directory share one cache, it is loaded only once */
+    if (Preprocessor::get_cache().size() == 0)
+        load_lemma_cache(std::filesystem::path(index_path).parent_path().string());
     indexer.docs_to_keywords();
     if (indexer.get_max_doc_id())
         DataLoader::id_counter = indexer.get_max_doc_id() + 1;
@@ -74,6 +227,7 @@ void IndexHandler::load_index(Indexer &indexer, const string &index_path) {
 
     auto t_end = std::chrono::high_resolution_clock::now();
     std::cout << "Index loaded in " << std::chrono::duration_cast<std::chrono::milliseconds>(t_end - t_start).count() << "ms" << std::endl << std::endl;
+    return true;
 }
 
 void IndexHandler::add_doc_url(Indexer &indexer, const string &url, bool verbose) {
@@ -135,6 +289,9 @@ void IndexHandler::update_docs(Indexer &indexer, std::vector<int> &doc_ids, std:
         std::cout << std::endl;
     }
 
+    /* New versions keep the IDs of the updated documents (positions are keyed by them) */
+    for (auto i = 0; i < docs.size() && i < doc_ids.size(); i++)
+        docs[i].id = doc_ids[i];
     auto [tokenized_docs, positions] = preprocess_documents(docs, false);
 
     indexer.update_docs(doc_ids, docs, tokenized_docs, positions);
@@ -188,18 +345,18 @@ void IndexHandler::print_query_results(const std::string &query, std::vector<Doc
     std::cout << std::endl;
 }
 
-std::tuple<std::vector<Document>, std::vector<float>, std::map<std::string, std::map<int, std::vector<int>>>> IndexHandler::search(Indexer &indexer, std::string &query, int k, FieldType field, int proximity, bool print) {
+std::tuple<std::vector<Document>, std::vector<float>, std::map<std::string, std::map<int, std::vector<int>>>> IndexHandler::search(Indexer &indexer, std::string &query, int k, FieldType field, int proximity, bool print, bool phrase) {
     std::cout << "Query: " << query << std::endl << "Query tokens: ";
-    auto [query_tokens, _] = preprocessor.preprocess_text(query, true);
+    auto [query_tokens, _] = get_query_preprocessor().preprocess_text(query, true);
     for (auto &token : query_tokens)
         std::cout << token << " ";
     std::cout << std::endl;
 
     std::tuple<std::vector<int>, std::vector<float>, std::map<std::string, std::map<int, std::vector<int>>>> result;
     if (FILE_BASED)
-        result = indexer.search_file_based(query_tokens, k, field, proximity);
+        result = indexer.search_file_based(query_tokens, k, field, proximity, phrase);
     else
-        result = indexer.search(query_tokens, k, field, proximity);
+        result = indexer.search(query_tokens, k, field, proximity, phrase);
     auto [doc_ids, scores, positions] = result;
 
     auto result_docs = get_docs(indexer, doc_ids, false);
@@ -215,7 +372,7 @@ std::tuple<std::vector<Document>, std::vector<float>, std::map<std::string, std:
 
 std::tuple<std::vector<Document>, std::map<std::string, std::map<int, std::vector<int>>>> IndexHandler::search(Indexer &indexer, std::string &query, FieldType field, bool print) {
     std::cout << "Query: " << query << std::endl << "Postfix notation: ";
-    auto bool_tokens = preprocessor.parse_bool_query(query);
+    auto bool_tokens = get_query_preprocessor().parse_bool_query(query);
     for (auto &token : bool_tokens)
         std::cout << token << " ";
     std::cout << std::endl;
@@ -243,7 +400,7 @@ std::tuple<std::string, std::vector<int>> IndexHandler::create_snippet(Indexer &
     auto content = doc.content;
     auto tokenized_doc = indexer.get_tokenized_doc(doc_id);
     auto words_tok = tokenized_doc.content;
-    auto [words_orig, _] = preprocessor.tokenize(content);
+    auto [words_orig, _] = get_query_preprocessor().tokenize(content);
 
     if (words_tok.size() <= window_size) /* WTF? ID 278 has only 28 words */
         window_size = words_tok.size();
@@ -1,14 +1,102 @@
 #include <iostream>
 #include <chrono>
+#include <thread>
+#include <mutex>
+#include <memory>
+#include <atomic>
 #include "DataLoader.h"
 #include "Preprocessor.h"
 #include "Indexer.h"
 #include "PyHandler.h"
 #include "Const.h"
 
+/**
+ * Phase of building or loading an index
+ */
+enum class IndexPhase {
+    IDLE,
+    LOAD,
+    PREPROCESS,
+    LANG_DETECT,
+    TF_IDF,
+    SAVE
+};
+
+/**
+ * Progress of the index that is being built or loaded (written by the indexing threads, read by the GUI)
+ * Every index job has its own, so the changes of other indices do not move it
+ */
+struct index_progress {
+    /** Current phase */
+    std::atomic<IndexPhase> phase = IndexPhase::IDLE;
+    /** Finished steps of the phase */
+    std::atomic<size_t> done = 0;
+    /** Steps of the phase (0 if unknown) */
+    std::atomic<size_t> total = 0;
+};
+
 class IndexHandler {
 public:
+    /** Progress the calling thread reports to (nullptr if its indexing is not reported, e.g. edits in the GUI) */
+    static thread_local index_progress *progress;
     static Preprocessor preprocessor;
+    /** Preprocessors of the worker threads (stemmer and lemmatizer instances are not shared between threads) */
+    static std::vector<std::unique_ptr<Preprocessor>> worker_preprocessors;
+    /** Lock for creating the worker preprocessors (the lemmatizer library is loaded globally) */
+    static std::mutex worker_preprocessors_mutex;
+    /** Lock for preprocessing documents (the shared and the worker preprocessors are used by one caller at a time) */
+    static std::mutex preprocess_mutex;
+
+    /**
+     * Report the progress of the indexing done by the calling thread (and its workers) to the given progress
+     * @param target Progress (nullptr to stop reporting)
+     */
+    static void report_progress(index_progress *target);
+    /**
+     * Start a new phase of building or loading an index (nothing happens if the calling thread does not report)
+     * @param phase Phase
+     * @param total Steps of the phase (0 if unknown)
+     */
+    static void start_phase(IndexPhase phase, size_t total=0);
+    /**
+     * Add finished steps to the current phase (nothing happens if the calling thread does not report)
+     * @param steps Number of the steps
+     */
+    static void add_progress(size_t steps = 1);
+
+    /**
+     * Get the preprocessor of the given worker thread (the first worker uses the shared preprocessor)
+     * @param worker Index of the worker thread
+     * @return Preprocessor
+     */
+    static Preprocessor &get_worker_preprocessor(size_t worker);
+    /**
+     * Get the preprocessor of the calling thread for the queries (searching threads do not share stemmer and lemmatizer)
+     * @return Preprocessor
+     */
+    static Preprocessor &get_query_preprocessor();
+
+    /**
+     * Preprocess a range of documents (one worker of preprocess_documents)
+     * @param preprocessor Preprocessor of the worker
+     * @param docs Documents
+     * @param begin First document of the range
+     * @param end End of the range
+     * @param tokenized_docs Tokenized documents (same size as docs, only the range is written)
+     * @param positions_map Positions of the words in the documents of the range
+     * @param target Progress of the thread that started the preprocessing (nullptr if not reported)
+     */
+    static void preprocess_range(Preprocessor &preprocessor, std::vector<Document> &docs, size_t begin, size_t end, std::vector<TokenizedDocument> &tokenized_docs, std::map<std::string, std::map<int, std::vector<int>>> &positions_map, index_progress *target);
+
+    /**
+     * Merge positions of a later range of documents into positions of an earlier one
+     * Same document ID in both ranges is resolved the same way as in a single range (the later document wins)
+     * @param positions_map Positions of the earlier range
+     * @param doc_ids IDs of the documents of the earlier range (sorted)
+     * @param other_positions_map Positions of the later range (moved from)
+     * @param other_doc_ids IDs of the documents of the later range (sorted)
+     */
+    static void merge_positions(std::map<std::string, std::map<int, std::vector<int>>> &positions_map, std::vector<int> &doc_ids, std::map<std::string, std::map<int, std::vector<int>>> &other_positions_map, const std::vector<int> &other_doc_ids);
 
     /**
      * Load documents from the given directory
@@ -20,7 +108,7 @@ public:
 
     /**
      * Preprocess documents (Documents -> TokenizedDocuments)
-     * @param preprocessor Preprocessor object instance
+     * Documents are split into contiguous ranges preprocessed by THREADS workers, the result does not depend on the number of threads
      * @param docs Documents to preprocess
      * @param verbose Whether to print the progress
      * @return Tokenized documents (preprocessed), positions of words in documents
@@ -28,18 +116,40 @@ public:
     static std::pair<std::vector<TokenizedDocument>, std::map<std::string, std::map<int, std::vector<int>>>> preprocess_documents(std::vector<Document> &docs, bool verbose=true);
 
     /**
-     * Save the index to the given path
+     * Load and preprocess documents from the given directory in batches
+     * Loading of the next batch overlaps with preprocessing of the current one and the parsed JSON is never held for the whole corpus
+     * @param dir_path Directory path
+     * @param verbose Whether to print the progress
+     * @return Documents, tokenized documents (preprocessed), positions of words in documents
+     */
+    static std::tuple<std::vector<Document>, std::vector<TokenizedDocument>, std::map<std::string, std::map<int, std::vector<int>>>> load_and_preprocess_documents(const std::string &dir_path, bool verbose=true);
+
+    /**
+     * Save the lemma cache to the given directory
+     * @param dir_path Directory path
+     */
+    static void save_lemma_cache(const std::string &dir_path);
+
+    /**
+     * Load the lemma cache from the given directory (if there is one)
+     * @param dir_path Directory path
+     */
+    static void load_lemma_cache(const std::string &dir_path);
+
+    /**
+     * Save the index to the given path (the lemma cache is saved next to it)
      * @param indexer Indexer
      * @param index_path Index path
      */
     static void save_index(Indexer &indexer, const std::string &index_path);
 
     /**
-     * Load the index from the given path
+     * Load the index from the given path (the lemma cache next to it is loaded too)
      * @param indexer Indexer
      * @param index_path Index path
+     * @return True if the index was loaded successfully
      */
-    static void load_index(Indexer &indexer, const std::string &index_path);
+    static bool load_index(Indexer &indexer, const std::string &index_path);
 
     /**
      * Add a document to the indexer and cache it from the given URL
@@ -108,10 +218,12 @@ public:
      * @param query Query
      * @param k Number of results
      * @param field Field to search in
+     * @param proximity Proximity search (if 0, no proximity search)
      * @param print Whether to print the results
+     * @param phrase Whether the whole query has to occur as a phrase (proximity is the distance of the following words)
      * @return Documents and scores and positions
      */
-    static std::tuple<std::vector<Document>, std::vector<float>, std::map<std::string, std::map<int, std::vector<int>>>> search(Indexer &indexer, std::string &query, int k, FieldType field=FieldType::ALL, int proximity=0, bool print=true);
+    static std::tuple<std::vector<Document>, std::vector<float>, std::map<std::string, std::map<int, std::vector<int>>>> search(Indexer &indexer, std::string &query, int k, FieldType field=FieldType::ALL, int proximity=0, bool print=true, bool phrase=false);
 
     /**
      * Search for the given query (Boolean model)
@@ -0,0 +1,197 @@
+#include "IndexSegment.h"
+#include "QueryDeadline.h"
+
+void IndexSegments::add_positions(index_segment &segment, std::map<std::string, std::map<int, std::vector<int>>> &new_positions) {
+    for (auto &[word, doc_positions] : new_positions) {
+        auto term = segment.vocabulary.add(word);
+        if (term >= segment.positional_index.size())
+            segment.positional_index.resize(segment.vocabulary.size());
+        auto &word_positions = segment.positional_index[term];
+        for (auto &[doc_id, pos] : doc_positions)
+            word_positions.set(doc_id, pos);
+    }
+}
+
+std::shared_ptr<index_segment> IndexSegments::merge(const std::vector<std::shared_ptr<const index_segment>> &segments, const std::vector<DocBitmap> &deleted) {
+    auto merged = std::make_shared<index_segment>();
+    std::map<std::string, std::vector<std::pair<int, std::vector<int>>>> positions;
+    for (size_t s = 0; s < segments.size(); s++) {
+        const auto &segment = *segments[s];
+        /* Term IDs differ between the segments, the documents are moved over by their words */
+        for (const auto &doc : segment.collection)
+            if (!deleted[s].contains(doc.id))
+                merged->collection.emplace_back(merged->vocabulary.encode(segment.vocabulary.decode(doc)));
+        for (const auto &[doc_id, doc] : segment.doc_cache)
+            if (!deleted[s].contains(doc_id))
+                merged->doc_cache.insert_or_assign(doc_id, doc);
+        for (uint32_t term = 0; term < segment.positional_index.size(); term++) {
+            const auto &word_positions = segment.positional_index[term];
+            for (size_t i = 0; i < word_positions.size(); i++)
+                if (!deleted[s].contains(word_positions.get_doc_id(i)))
+                    positions[segment.vocabulary.get_word(term)].emplace_back(word_positions.get_doc_id(i), word_positions.get_positions(i));
+        }
+    }
+
+    /* Documents of the segments interleave (updated documents keep their IDs), positions are added in ID order */
+    for (auto &[word, doc_positions] : positions) {
+        std::sort(doc_positions.begin(), doc_positions.end(), [](const auto &a, const auto &b) { return a.first < b.first; });
+        auto term = merged->vocabulary.add(word);
+        if (term >= merged->positional_index.size())
+            merged->positional_index.resize(merged->vocabulary.size());
+        for (const auto &[doc_id, pos] : doc_positions)
+            merged->positional_index[term].set(doc_id, pos);
+    }
+    return merged;
+}
+
+size_t IndexSegments::base_stats(const Vocabulary &vocabulary, const std::vector<std::shared_ptr<const index_segment>> &segments, std::vector<uint32_t> &base_df) {
+    base_df.assign(vocabulary.size(), 0);
+    size_t base_docs = 0;
+    for (size_t s = 0; s < segments.size(); s++) {
+        const auto &segment = *segments[s];
+        /* Postings of the deleted documents stay until the merge, so the documents count too (DF never exceeds N) */
+        base_docs += segment.doc_ids.size();
+        for (uint32_t term = 0; term < vocabulary.size(); term++) {
+            auto other = segment.vocabulary.find(vocabulary.get_word(term));
+            if (other < segment.index.size())
+                base_df[term] += segment.index[other].postings.size();
+        }
+    }
+    return base_docs;
+}
+
+void IndexSegments::weigh(index_segment &segment, const std::vector<uint32_t> &base_df, size_t base_docs) {
+    segment.norms.clear();
+    segment.title_norms.clear();
+    /* Content and title index are built together, every sharded pass of the worker threads covers both fields */
+    TF_IDF::calc_tf_idf(segment.collection, segment.vocabulary.size(), segment.index, segment.title_index, segment.norms, segment.title_norms, base_df, base_docs);
+    segment.idf_docs = segment.collection.size() + base_docs;
+    build_impacts(segment);
+    collect_doc_ids(segment);
+}
+
+void IndexSegments::build_impacts(index_segment &segment) {
+    if (IMPACT_BITS <= 0)
+        return;
+    segment.impacts = ImpactIndex(segment.index, segment.norms, IMPACT_BITS);
+    segment.title_impacts = ImpactIndex(segment.title_index, segment.title_norms, IMPACT_BITS);
+}
+
+void IndexSegments::collect_doc_ids(index_segment &segment) {
+    std::vector<int> doc_ids;
+    doc_ids.reserve(segment.collection.size());
+    for (const auto &doc : segment.collection)
+        doc_ids.emplace_back(doc.id);
+    std::sort(doc_ids.begin(), doc_ids.end());
+    doc_ids.erase(std::unique(doc_ids.begin(), doc_ids.end()), doc_ids.end());
+    segment.doc_ids = DocBitmap(doc_ids);
+}
+
+std::vector<size_t> IndexSegments::select_merge(const std::vector<std::shared_ptr<const index_segment>> &segments, const std::vector<DocBitmap> &deleted) {
+    std::map<int, std::vector<size_t>> tiers;
+    for (size_t s = 0; s < segments.size(); s++) {
+        if (!segments[s]->sealed)
+            continue;
+        auto live = segments[s]->doc_ids.size() - deleted[s].size();
+        int tier = 0;
+        for (size_t size = SEGMENT_SIZE * MERGE_FACTOR; live >= size; size *= MERGE_FACTOR)
+            tier++;
+        tiers[tier].emplace_back(s);
+    }
+    /* Smallest tiers first, they fill up the fastest */
+    for (const auto &[_, members] : tiers)
+        if (members.size() >= MERGE_FACTOR)
+            return {members.begin(), members.begin() + MERGE_FACTOR};
+
+    for (size_t s = 0; s < segments.size(); s++)
+        if (segments[s]->sealed && deleted[s].size() * 2 > segments[s]->doc_ids.size())
+            return {s};
+    return {};
+}
+
+std::map<std::string, float> IndexSegments::calc_query_idf(const std::vector<std::shared_ptr<const index_segment>> &segments, const std::vector<DocBitmap> &deleted, const std::vector<std::string> &words, size_t docs_count) {
+    std::map<std::string, float> query_idf;
+    for (const auto &word : words) {
+        if (query_idf.find(word) != query_idf.end())
+            continue;
+        uint32_t df = 0;
+        for (size_t s = 0; s < segments.size(); s++) {
+            const auto &segment = *segments[s];
+            auto term = segment.vocabulary.find(word);
+            if (term >= segment.index.size())
+                continue;
+            const auto &postings = segment.index[term].postings;
+            if (deleted[s].empty()) {
+                df += postings.size();
+                continue;
+            }
+            postings.for_each([&](int doc_id, uint32_t) {
+                if (!deleted[s].contains(doc_id))
+                    df++;
+            });
+        }
+        query_idf[word] = df > 0 ? std::log10(static_cast<float>(docs_count) / static_cast<float>(df)) : 0;
+    }
+    return query_idf;
+}
+
+std::vector<map_element> IndexSegments::load_query_postings(const std::vector<std::shared_ptr<const index_segment>> &segments, const std::vector<DocBitmap> &deleted, const Vocabulary &query_vocabulary, bool title) {
+    std::vector<map_element> query_index(query_vocabulary.size());
+    std::vector<std::pair<int, uint32_t>> postings;
+    for (uint32_t term = 0; term < query_vocabulary.size(); term++) {
+        QueryDeadline::check();
+        postings.clear();
+        for (size_t s = 0; s < segments.size(); s++) {
+            const auto &segment = *segments[s];
+            const auto &segment_index = title ? segment.title_index : segment.index;
+            auto segment_term = segment.vocabulary.find(query_vocabulary.get_word(term));
+            if (segment_term >= segment_index.size())
+                continue;
+            segment_index[segment_term].postings.for_each([&](int doc_id, uint32_t tf) {
+                if (deleted[s].empty() || !deleted[s].contains(doc_id))
+                    postings.emplace_back(doc_id, tf);
+            });
+        }
+
+        std::sort(postings.begin(), postings.end());
+        for (const auto &[doc_id, tf] : postings)
+            query_index[term].postings.push_back(doc_id, tf);
+    }
+    return query_index;
+}
+
+std::vector<PositionList> IndexSegments::load_query_positions(const std::vector<std::shared_ptr<const index_segment>> &segments, const std::vector<DocBitmap> &deleted, const Vocabulary &query_vocabulary, const std::vector<std::string> &words) {
+    std::vector<PositionList> positions(query_vocabulary.size());
+    std::vector<std::pair<int, std::vector<int>>> doc_positions;
+    for (const auto &word : words) {
+        auto term = query_vocabulary.find(word);
+        if (term == Vocabulary::NO_TERM || !positions[term].empty())
+            continue;
+        doc_positions.clear();
+        for (size_t s = 0; s < segments.size(); s++) {
+            const auto &segment = *segments[s];
+            auto segment_term = segment.vocabulary.find(word);
+            if (segment_term >= segment.positional_index.size())
+                continue;
+            const auto &word_positions = segment.positional_index[segment_term];
+            for (size_t i = 0; i < word_positions.size(); i++)
+                if (!deleted[s].contains(word_positions.get_doc_id(i)))
+                    doc_positions.emplace_back(word_positions.get_doc_id(i), word_positions.get_positions(i));
+        }
+        std::sort(doc_positions.begin(), doc_positions.end(), [](const auto &a, const auto &b) { return a.first < b.first; });
+        for (const auto &[doc_id, pos] : doc_positions)
+            positions[term].set(doc_id, pos);
+    }
+    return positions;
+}
+
+std::unordered_set<std::string> IndexSegments::collect_words(const std::vector<std::shared_ptr<const index_segment>> &segments, bool title) {
+    std::unordered_set<std::string> words;
+    for (const auto &segment : segments) {
+        const auto &segment_index = title ? segment->title_index : segment->index;
+        for (uint32_t term = 0; term < segment_index.size(); term++)
+            if (!segment_index[term].postings.empty())
+                words.insert(segment->vocabulary.get_word(term));
+    }
+    return words;
+}
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include "TF_IDF.h"
+#include "PositionList.h"
+#include "DocBitmap.h"
+#include "ImpactIndex.h"
+#include "Vocabulary.h"
+#include "Const.h"
+
+/**
+ * Segment of the in-memory index
+ * Every segment has its own dictionary, postings, positions, norms and documents. Published segments are never
+ * changed - documents are deleted by the deleted sets of the snapshot and dropped when the segment is merged
+ */
+struct index_segment {
+    /** Dictionary of word <-> term ID (stems of the indexed fields and surface words of the positions) */
+    Vocabulary vocabulary{};
+    /** Documents of the segment */
+    std::vector<term_document> collection{};
+    /** Main index (indexed by term ID) */
+    std::vector<map_element> index{};
+    /** Title index (indexed by term ID) */
+    std::vector<map_element> title_index{};
+    /** Document norms (cosine similarity) */
+    std::map<int, float> norms{};
+    /** Title norms (cosine similarity) */
+    std::map<int, float> title_norms{};
+    /** Term ID -> compact positions (doc_id, positions) */
+    std::vector<PositionList> positional_index{};
+    /** Quantized impacts of the main index (empty unless IMPACT_BITS is set) */
+    ImpactIndex impacts{};
+    /** Quantized impacts of the title index (empty unless IMPACT_BITS is set) */
+    ImpactIndex title_impacts{};
+    /** Document cache */
+    std::unordered_map<int, Document> doc_cache{};
+    /** IDs of the documents of the segment */
+    DocBitmap doc_ids{};
+    /** Number of documents IDF and norms were calculated over (the whole index at the time the segment was weighted) */
+    size_t idf_docs = 0;
+    /** Whether the segment is full (new documents go to a new segment) */
+    bool sealed = false;
+};
+
+/**
+ * Class for building, merging and searching the segments of the in-memory index
+ */
+class IndexSegments {
+public:
+    /** Number of documents at which the open segment is sealed */
+    static constexpr size_t SEGMENT_SIZE = 1000;
+    /** Number of segments of one tier merged into a segment of the next tier */
+    static constexpr size_t MERGE_FACTOR = 4;
+
+    /**
+     * Add positions of new documents to the segment, the words are interned
+     * @param segment Segment
+     * @param new_positions Positions of the new documents (moved from)
+     */
+    static void add_positions(index_segment &segment, std::map<std::string, std::map<int, std::vector<int>>> &new_positions);
+    /**
+     * Copy the live documents of the given segments into a new segment (not weighted yet)
+     * @param segments Segments
+     * @param deleted Deleted documents of the segments
+     * @return New segment
+     */
+    static std::shared_ptr<index_segment> merge(const std::vector<std::shared_ptr<const index_segment>> &segments, const std::vector<DocBitmap> &deleted);
+    /**
+     * Collect DF of the segment's terms in the given segments (deleted documents count until they are merged away,
+     * both in DF and in the number of documents)
+     * @param vocabulary Dictionary of the segment
+     * @param segments Other segments
+     * @param base_df DF of the segment's terms (overwritten)
+     * @return Number of documents in the other segments
+     */
+    static size_t base_stats(const Vocabulary &vocabulary, const std::vector<std::shared_ptr<const index_segment>> &segments, std::vector<uint32_t> &base_df);
+    /**
+     * Calculate IDF, TF-IDF, norms, upper bounds and impacts of the segment
+     * @param segment Segment
+     * @param base_df DF of the segment's terms in the rest of the index
+     * @param base_docs Number of documents in the rest of the index
+     */
+    static void weigh(index_segment &segment, const std::vector<uint32_t> &base_df = {}, size_t base_docs = 0);
+    /**
+     * Build the quantized impacts of the segment from its indices and norms (only if IMPACT_BITS is set)
+     * @param segment Segment
+     */
+    static void build_impacts(index_segment &segment);
+    /**
+     * Collect the IDs of the documents of the segment
+     * @param segment Segment
+     */
+    static void collect_doc_ids(index_segment &segment);
+    /**
+     * Pick the segments to merge (tiered policy)
+     * Sealed segments are put into tiers by their live documents, MERGE_FACTOR segments of one tier are merged into
+     * a segment of the next tier, a segment with mostly deleted documents is rewritten on its own
+     * @param segments Segments
+     * @param deleted Deleted documents of the segments
+     * @return Indices of the segments to merge (empty if there is nothing to merge)
+     */
+    static std::vector<size_t> select_merge(const std::vector<std::shared_ptr<const index_segment>> &segments, const std::vector<DocBitmap> &deleted);
+    /**
+     * Calculate IDF of the query words from the live documents of the whole index
+     * Segments keep the IDF they were weighted with (their norms match it), this one only weights the query
+     * @param segments Segments
+     * @param deleted Deleted documents of the segments
+     * @param words Query words
+     * @param docs_count Number of live documents
+     * @return Word -> IDF (zero for words not in the content index)
+     */
+    [[nodiscard]] static std::map<std::string, float> calc_query_idf(const std::vector<std::shared_ptr<const index_segment>> &segments, const std::vector<DocBitmap> &deleted, const std::vector<std::string> &words, size_t docs_count);
+    /**
+     * Merge the postings of the words of the query dictionary over all the segments (no weights, Boolean model)
+     * @param segments Segments
+     * @param deleted Deleted documents of the segments
+     * @param query_vocabulary Dictionary of the query words
+     * @param title Whether to merge the title index (content index otherwise)
+     * @return Index of the query words (indexed by their term IDs)
+     */
+    [[nodiscard]] static std::vector<map_element> load_query_postings(const std::vector<std::shared_ptr<const index_segment>> &segments, const std::vector<DocBitmap> &deleted, const Vocabulary &query_vocabulary, bool title);
+    /**
+     * Merge the positions of the given words over all the segments
+     * @param segments Segments
+     * @param deleted Deleted documents of the segments
+     * @param query_vocabulary Dictionary of the query words
+     * @param words Words to merge (have to be in the query dictionary)
+     * @return Term ID -> compact positions
+     */
+    [[nodiscard]] static std::vector<PositionList> load_query_positions(const std::vector<std::shared_ptr<const index_segment>> &segments, const std::vector<DocBitmap> &deleted, const Vocabulary &query_vocabulary, const std::vector<std::string> &words);
+    /**
+     * Collect the words with any postings in the segments
+     * @param segments Segments
+     * @param title Whether to collect the words of the title index (content index otherwise)
+     * @return Words
+     */
+    [[nodiscard]] static std::unordered_set<std::string> collect_words(const std::vector<std::shared_ptr<const index_segment>> &segments, bool title);
+};
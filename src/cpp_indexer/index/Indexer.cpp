@@ -1,85 +1,335 @@
 #include "Indexer.h"
 
+#include <climits>
 #include <utility>
+#include <thread>
+#include "IndexHandler.h"
+
+index_head::~index_head() {
+    if (!this->merge_thread.joinable())
+        return;
+    /* Last copy of the indexer can be dropped by the merge itself */
+    if (this->merge_thread.get_id() == std::this_thread::get_id())
+        this->merge_thread.detach();
+    else
+        this->merge_thread.join();
+}
 
-Indexer::Indexer() : collection(std::vector<TokenizedDocument>()), keywords(), doc_cache(), index(std::map<std::string, map_element>()), norms(std::map<int, float>()), positions_map() {
+Indexer::Indexer() : head(std::make_shared<index_head>()) {
     /* Nothing to do here :) */
 }
 
-Indexer::Indexer(const string &index_path_dir, bool reindex_immediately) : collection(std::vector<TokenizedDocument>()), keywords(), doc_cache(), index(std::map<std::string, map_element>()), norms(std::map<int, float>()), positions_map() {
+Indexer::Indexer(const string &index_path_dir, bool reindex_immediately) : head(std::make_shared<index_head>()) {
     this->index_path_dir = index_path_dir;
-    if (reindex_immediately)
+    if (reindex_immediately && !FileBasedLoader::is_up_to_date(this->index_path_dir)) {
+        auto lock = this->begin_write();
         this->index_everything_file_based();
+        this->publish();
+    } else if (reindex_immediately) {
+        /* Index was already built from the same documents, only the keywords are collected */
+        std::cout << "Index " << this->index_path_dir << " is up to date" << std::endl;
+        auto lock = this->begin_write();
+        this->update_keywords();
+        this->publish();
+        std::atomic_store(&this->head->disk_index, std::make_shared<DiskIndex>(this->index_path_dir));
+    } else {
+        std::atomic_store(&this->head->disk_index, std::make_shared<DiskIndex>(this->index_path_dir));
+    }
 }
 
-Indexer::Indexer(const std::vector<Document> &original_collection, const std::vector<TokenizedDocument> &tokenized_collection, std::map<std::string, std::map<int, std::vector<int>>> &positions_map) : collection(std::vector<TokenizedDocument>()), keywords(), doc_cache(), index(std::map<std::string, map_element>()), norms(std::map<int, float>()), positions_map() {
+Indexer::Indexer(const std::vector<Document> &original_collection, const std::vector<TokenizedDocument> &tokenized_collection, std::map<std::string, std::map<int, std::vector<int>>> &positions_map) : head(std::make_shared<index_head>()) {
     this->add_docs(original_collection, tokenized_collection, positions_map);
 }
 
+void Indexer::move_to(const std::string &index_path_dir) {
+    std::lock_guard<std::mutex> lock(this->head->write_mutex);
+    this->index_path_dir = index_path_dir;
+}
+
+std::unique_lock<std::mutex> Indexer::begin_write() {
+    std::unique_lock<std::mutex> lock(this->head->write_mutex);
+    /* Copy on write, the published snapshot stays untouched for the readers (segments are shared, not copied) */
+    this->state = std::make_shared<index_snapshot>(*this->get_snapshot());
+    return lock;
+}
+
+void Indexer::publish() {
+    std::atomic_store(&this->head->snapshot, std::shared_ptr<const index_snapshot>(std::move(this->state)));
+}
+
+std::shared_ptr<const index_snapshot> Indexer::get_snapshot() const {
+    return std::atomic_load(&this->head->snapshot);
+}
+
+std::shared_ptr<DiskIndex> Indexer::get_disk_index() const {
+    return std::atomic_load(&this->head->disk_index);
+}
+
 void Indexer::docs_to_keywords() {
-    /* Clear the keywords */
-    this->keywords.clear();
-    /* Add words from the collection to the keywords */
-    std::vector<TokenizedDocument> collection_to_use;
-    if (FILE_BASED)
-        collection_to_use = FileBasedLoader::load_tokenized_docs(this->index_path_dir);
-    else
-        collection_to_use = this->collection;
-    for (const auto &doc : collection_to_use) {
-        for (const auto &word : doc.title)
-            this->keywords.insert(word);
-        for (const auto &word : doc.toc)
-            this->keywords.insert(word);
-        for (const auto &word : doc.h1)
-            this->keywords.insert(word);
-        for (const auto &word : doc.h2)
-            this->keywords.insert(word);
-        for (const auto &word : doc.h3)
-            this->keywords.insert(word);
-        for (const auto &word : doc.content)
-            this->keywords.insert(word);
-    }
-}
-
-void Indexer::index_everything() {
+    auto lock = this->begin_write();
+    this->update_keywords();
+    this->publish();
+}
+
+void Indexer::update_keywords() {
+    /* Keywords of the in-memory index are the words of the segments */
+    if (!FILE_BASED)
+        return;
+    /* Add words from the collection to the keywords (file based documents are interned on the way) */
+    this->state->keywords.clear();
+    FileBasedLoader::for_each_tokenized_doc(this->index_path_dir, [this](const TokenizedDocument &doc) {
+        auto encoded = this->state->vocabulary.encode(doc);
+        for (const auto &term : encoded.get_terms())
+            this->state->keywords.insert(term);
+        for (const auto &term : encoded.title)
+            this->state->keywords.insert(term);
+    });
+}
+
+void Indexer::index_everything(index_segment &segment) {
     /* Detect languages */
     if (DETECT_LANG) {
         std::vector<Document> docs;
-        for (const auto &[_, doc]: this->doc_cache)
+        for (const auto &[_, doc]: segment.doc_cache)
             docs.emplace_back(doc);
-        auto langs = PyHandler::detect_lang(docs);
-        for (auto i = 0; i < docs.size(); i++) {
-            auto id = docs[i].id;
-            this->doc_cache[id].lang = langs[i];
-            this->collection[i].lang = langs[i];
-        }
+        detect_langs(segment, docs);
     }
 
     std::cout << "Indexing documents..." << std::endl;
     auto t_start = std::chrono::high_resolution_clock::now();
 
-    this->docs_to_keywords();
-    this->norms.clear();
-    this->title_norms.clear();
-    this->index = TF_IDF::calc_tf_idf(this->collection, this->norms);
-    this->title_index = TF_IDF::calc_tf_idf(this->collection, this->title_norms, true);
+    /* Content and title index */
+    IndexHandler::start_phase(IndexPhase::TF_IDF, 2);
+    IndexSegments::weigh(segment);
+    IndexHandler::add_progress(2);
 
     auto t_end = std::chrono::high_resolution_clock::now();
-    std::cout << "Indexed " << this->get_collection_size() << " documents and " << this->get_index_size() << " words using TF-IDF" << std::endl;
-    std::cout << "(Indexed " << this->get_title_index_size() << " words in titles using TF-IDF)" << std::endl;
+    std::cout << "Indexed " << segment.collection.size() << " documents and " << count_words(segment.index) << " words using TF-IDF" << std::endl;
+    std::cout << "(Indexed " << count_words(segment.title_index) << " words in titles using TF-IDF)" << std::endl;
     std::cout << "Indexing done in " << std::chrono::duration_cast<std::chrono::milliseconds>(t_end - t_start).count() << "ms" << std::endl << std::endl;
 }
 
+void Indexer::compact() {
+    auto lock = this->begin_write();
+    this->merge_all();
+    this->publish();
+}
+
+void Indexer::merge_all() {
+    this->head->changes_since_reweight = 0;
+    if (this->state->segments.empty())
+        return;
+    /* Every segment is merged even if there is just one, its weights may be out of date */
+    auto merged = IndexSegments::merge(this->state->segments, this->state->deleted);
+    IndexSegments::weigh(*merged);
+    merged->sealed = merged->collection.size() >= IndexSegments::SEGMENT_SIZE;
+    this->state->segments = {merged};
+    this->state->deleted = {DocBitmap()};
+    this->update_live_docs();
+}
+
+void Indexer::count_changes(int changes) {
+    /* Segments keep IDF of the time they were weighted, after many changes the whole index is weighted again */
+    this->head->changes_since_reweight += changes;
+    if (static_cast<float>(this->head->changes_since_reweight) > reweight_threshold * static_cast<float>(this->state->live_docs.size())) {
+        std::cout << "Recalculating IDF after " << this->head->changes_since_reweight << " changed documents..." << std::endl;
+        this->merge_all();
+    }
+}
+
+void Indexer::update_live_docs() {
+    /* Segments without live documents are dropped right away, they need no merge */
+    for (size_t s = this->state->segments.size(); s-- > 0;)
+        if (this->state->deleted[s].size() == this->state->segments[s]->doc_ids.size()) {
+            this->state->segments.erase(this->state->segments.begin() + static_cast<long>(s));
+            this->state->deleted.erase(this->state->deleted.begin() + static_cast<long>(s));
+        }
+
+    this->state->live_docs = DocBitmap();
+    for (size_t s = 0; s < this->state->segments.size(); s++) {
+        auto live = this->state->segments[s]->doc_ids;
+        live.subtract(this->state->deleted[s]);
+        this->state->live_docs.unite(live);
+    }
+}
+
+bool Indexer::delete_doc(int doc_id) {
+    /* Updated documents keep their IDs, only the newest version can be live */
+    for (size_t s = this->state->segments.size(); s-- > 0;)
+        if (this->state->segments[s]->doc_ids.contains(doc_id) && !this->state->deleted[s].contains(doc_id)) {
+            this->state->deleted[s].unite(DocBitmap({doc_id}));
+            return true;
+        }
+    return false;
+}
+
+void Indexer::add_to_buffer(const std::vector<Document> &docs, const std::vector<TokenizedDocument> &tokenized_docs, std::map<std::string, std::map<int, std::vector<int>>> &positions_map) {
+    /* Open segment is small, it is rebuilt with the new documents (its deleted documents are dropped on the way) */
+    std::vector<std::shared_ptr<const index_segment>> open;
+    std::vector<DocBitmap> open_deleted;
+    if (!this->state->segments.empty() && !this->state->segments.back()->sealed) {
+        open.emplace_back(this->state->segments.back());
+        open_deleted.emplace_back(this->state->deleted.back());
+        this->state->segments.pop_back();
+        this->state->deleted.pop_back();
+    }
+    auto segment = IndexSegments::merge(open, open_deleted);
+    for (int i = 0; i < docs.size(); i++) {
+        segment->doc_cache.insert_or_assign(docs[i].id, docs[i]);
+        segment->collection.emplace_back(segment->vocabulary.encode(tokenized_docs[i]));
+    }
+    IndexSegments::add_positions(*segment, positions_map);
+    if (DETECT_LANG && !docs.empty())
+        detect_langs(*segment, docs);
+
+    /* IDF of the new documents counts the whole index, so their scores are comparable with the other segments */
+    std::vector<uint32_t> base_df;
+    auto base_docs = IndexSegments::base_stats(segment->vocabulary, this->state->segments, base_df);
+    IndexSegments::weigh(*segment, base_df, base_docs);
+    segment->sealed = segment->collection.size() >= IndexSegments::SEGMENT_SIZE;
+    this->state->segments.emplace_back(std::move(segment));
+    this->state->deleted.emplace_back();
+}
+
+void Indexer::schedule_merge() {
+    auto snapshot = this->get_snapshot();
+    if (this->head->merging || IndexSegments::select_merge(snapshot->segments, snapshot->deleted).empty())
+        return;
+    /* Previous merge already finished (it clears the flag under the lock right before it ends) */
+    if (this->head->merge_thread.joinable())
+        this->head->merge_thread.join();
+    this->head->merging = true;
+    this->head->merge_thread = std::thread(merge_segments, std::weak_ptr<index_head>(this->head));
+}
+
+void Indexer::merge_segments(const std::weak_ptr<index_head> &weak_head) {
+    while (true) {
+        std::vector<std::shared_ptr<const index_segment>> sources;
+        std::vector<DocBitmap> sources_deleted;
+        std::vector<std::shared_ptr<const index_segment>> others;
+        {
+            auto head = weak_head.lock();
+            if (!head)
+                return;
+            std::lock_guard<std::mutex> lock(head->write_mutex);
+            auto snapshot = std::atomic_load(&head->snapshot);
+            auto picked = IndexSegments::select_merge(snapshot->segments, snapshot->deleted);
+            if (picked.empty()) {
+                head->merging = false;
+                return;
+            }
+            for (size_t s = 0; s < snapshot->segments.size(); s++) {
+                if (std::find(picked.begin(), picked.end(), s) == picked.end()) {
+                    others.emplace_back(snapshot->segments[s]);
+                    continue;
+                }
+                sources.emplace_back(snapshot->segments[s]);
+                sources_deleted.emplace_back(snapshot->deleted[s]);
+            }
+        }
+
+        /* Heavy part runs without the lock, writers and queries go on meanwhile */
+        auto merged = IndexSegments::merge(sources, sources_deleted);
+        std::vector<uint32_t> base_df;
+        auto base_docs = IndexSegments::base_stats(merged->vocabulary, others, base_df);
+        IndexSegments::weigh(*merged, base_df, base_docs);
+        merged->sealed = true;
+
+        auto head = weak_head.lock();
+        if (!head)
+            return;
+        std::lock_guard<std::mutex> lock(head->write_mutex);
+        auto snapshot = std::make_shared<index_snapshot>(*std::atomic_load(&head->snapshot));
+        std::vector<size_t> positions;
+        for (const auto &source : sources) {
+            auto it = std::find(snapshot->segments.begin(), snapshot->segments.end(), source);
+            if (it == snapshot->segments.end())
+                break;
+            positions.emplace_back(it - snapshot->segments.begin());
+        }
+        /* Some source was dropped meanwhile (all its documents deleted), the policy picks again */
+        if (positions.size() != sources.size())
+            continue;
+
+        /* Documents deleted during the merge are still in the merged segment */
+        DocBitmap deleted;
+        for (size_t i = 0; i < sources.size(); i++) {
+            auto newly_deleted = snapshot->deleted[positions[i]];
+            newly_deleted.subtract(sources_deleted[i]);
+            deleted.unite(newly_deleted);
+        }
+        auto first = *std::min_element(positions.begin(), positions.end());
+        snapshot->segments[first] = merged;
+        snapshot->deleted[first] = deleted;
+        std::sort(positions.begin(), positions.end());
+        for (size_t i = positions.size(); i-- > 1;) {
+            snapshot->segments.erase(snapshot->segments.begin() + static_cast<long>(positions[i]));
+            snapshot->deleted.erase(snapshot->deleted.begin() + static_cast<long>(positions[i]));
+        }
+        std::atomic_store(&head->snapshot, std::shared_ptr<const index_snapshot>(std::move(snapshot)));
+    }
+}
+
+std::shared_ptr<const index_segment> Indexer::flatten(const index_snapshot &snapshot) {
+    if (snapshot.segments.size() == 1 && snapshot.deleted[0].empty() && snapshot.segments[0]->idf_docs == snapshot.segments[0]->collection.size())
+        return snapshot.segments[0];
+    auto merged = IndexSegments::merge(snapshot.segments, snapshot.deleted);
+    IndexSegments::weigh(*merged);
+    return merged;
+}
+
+void Indexer::detect_langs(index_segment &segment, const std::vector<Document> &docs) {
+    IndexHandler::start_phase(IndexPhase::LANG_DETECT, docs.size());
+    auto langs = PyHandler::detect_lang(docs);
+    IndexHandler::add_progress(docs.size());
+    std::unordered_map<int, std::string> langs_by_id;
+    for (auto i = 0; i < docs.size() && i < langs.size(); i++) {
+        segment.doc_cache[docs[i].id].lang = langs[i];
+        langs_by_id[docs[i].id] = langs[i];
+    }
+    /* Collection is not in the same order as the document cache */
+    for (auto &doc : segment.collection) {
+        auto it = langs_by_id.find(doc.id);
+        if (it != langs_by_id.end())
+            doc.lang = it->second;
+    }
+}
+
+void Indexer::merge_positions(std::map<std::string, std::map<int, std::vector<int>>> &positions_map, std::map<std::string, std::map<int, std::vector<int>>> &new_positions) {
+    for (auto &[word, doc_positions] : new_positions) {
+        auto &word_positions = positions_map[word];
+        for (auto &[doc_id, pos] : doc_positions)
+            word_positions[doc_id] = std::move(pos);
+    }
+}
+
+void Indexer::purge_positions(std::map<std::string, std::map<int, std::vector<int>>> &positions_map, const std::unordered_set<int> &doc_ids) {
+    if (doc_ids.empty())
+        return;
+    /* Positions are keyed by the words before stemming, so every word has to be checked */
+    for (auto it = positions_map.begin(); it != positions_map.end();) {
+        for (const auto &doc_id : doc_ids)
+            it->second.erase(doc_id);
+        if (it->second.empty())
+            it = positions_map.erase(it);
+        else
+            it++;
+    }
+}
+
 void Indexer::index_everything_file_based() {
     std::cout << "Indexing documents..." << std::endl;
     auto t_start = std::chrono::high_resolution_clock::now();
+    FileBasedLoader::remove_manifest(this->index_path_dir);
 
     if (DETECT_LANG) {
         auto doc_cache_ = FileBasedLoader::load_doc_cache(this->index_path_dir);
         std::vector<Document> docs;
         for (const auto &[_, doc]: doc_cache_)
             docs.emplace_back(doc);
+        IndexHandler::start_phase(IndexPhase::LANG_DETECT, docs.size());
         auto langs = PyHandler::detect_lang(docs);
+        IndexHandler::add_progress(docs.size());
         auto docs_tok = FileBasedLoader::load_tokenized_docs(this->index_path_dir);
         for (auto i = 0; i < docs.size(); i++) {
             auto id = docs[i].id;
@@ -90,16 +340,28 @@ void Indexer::index_everything_file_based() {
         FileBasedLoader::save_tokenized_docs(docs_tok, this->index_path_dir);
     }
 
-    this->docs_to_keywords();
-
-    TF_IDF::calc_tf_idf_file_based(this->index_path_dir);
-    TF_IDF::calc_tf_idf_file_based(this->index_path_dir, true);
+    this->update_keywords();
+
+    /* Readers still search the old files, the new ones are built aside and swapped in when complete */
+    auto staging_dir = FileBasedLoader::create_staging_dir(this->index_path_dir);
+    IndexHandler::start_phase(IndexPhase::TF_IDF, 2);
+    TF_IDF::calc_tf_idf_file_based(this->index_path_dir, staging_dir);
+    IndexHandler::add_progress();
+    TF_IDF::calc_tf_idf_file_based(this->index_path_dir, staging_dir, true);
+    IndexHandler::add_progress();
+    IndexHandler::start_phase(IndexPhase::SAVE);
+    FileBasedLoader::save_positions_index(FileBasedLoader::load_positions_map(this->index_path_dir), staging_dir);
+    DocStore::save(staging_dir + "docs.dict", staging_dir + "docs.store", FileBasedLoader::load_doc_cache(this->index_path_dir), FileBasedLoader::load_tokenized_docs(this->index_path_dir));
+    FileBasedLoader::install_index(staging_dir, this->index_path_dir);
+    std::atomic_store(&this->head->disk_index, std::make_shared<DiskIndex>(this->index_path_dir));
+    FileBasedLoader::save_manifest(this->index_path_dir);
 
     auto t_end = std::chrono::high_resolution_clock::now();
     std::cout << "Indexing done in " << std::chrono::duration_cast<std::chrono::milliseconds>(t_end - t_start).count() << "ms" << std::endl << std::endl;
 }
 
 void Indexer::add_docs(const std::vector<Document> &docs, const std::vector<TokenizedDocument> &tokenized_docs, std::map<std::string, std::map<int, std::vector<int>>> &positions_map) {
+    auto lock = this->begin_write();
     if (FILE_BASED) {
         auto doc_cache_ = FileBasedLoader::load_doc_cache(this->index_path_dir);
         auto tokenized_docs_ = FileBasedLoader::load_tokenized_docs(this->index_path_dir);
@@ -107,46 +369,85 @@ void Indexer::add_docs(const std::vector<Document> &docs, const std::vector<Toke
         for (int i = 0; i < docs.size(); i++) {
             doc_cache_.erase(docs[i].id);
             doc_cache_.insert({docs[i].id, docs[i]});
-            tokenized_docs_[i] = tokenized_docs[i];
+            auto it = std::find_if(tokenized_docs_.begin(), tokenized_docs_.end(), [&docs, i](const TokenizedDocument &d) { return d.id == docs[i].id; });
+            if (it != tokenized_docs_.end())
+                *it = tokenized_docs[i];
+            else
+                tokenized_docs_.emplace_back(tokenized_docs[i]);
         }
-        positions_map_ = std::move(positions_map);
+        merge_positions(positions_map_, positions_map);
         FileBasedLoader::save_doc_cache(doc_cache_, this->index_path_dir);
         FileBasedLoader::save_tokenized_docs(tokenized_docs_, this->index_path_dir);
         FileBasedLoader::save_positions_map(positions_map_, this->index_path_dir);
         this->index_everything_file_based();
     } else {
-        for (int i = 0; i < docs.size(); i++) {
-            this->doc_cache.insert({docs[i].id, docs[i]});
-            this->collection.emplace_back(tokenized_docs[i]);
+        /* Nothing to add to, the whole collection is indexed into one segment */
+        if (this->state->segments.empty()) {
+            if (docs.empty()) {
+                this->publish();
+                return;
+            }
+            auto segment = std::make_shared<index_segment>();
+            for (int i = 0; i < docs.size(); i++) {
+                segment->doc_cache.insert({docs[i].id, docs[i]});
+                segment->collection.emplace_back(segment->vocabulary.encode(tokenized_docs[i]));
+            }
+            IndexSegments::add_positions(*segment, positions_map);
+            index_everything(*segment);
+            segment->sealed = segment->collection.size() >= IndexSegments::SEGMENT_SIZE;
+            this->state->segments.emplace_back(std::move(segment));
+            this->state->deleted.emplace_back();
+            this->update_live_docs();
+            this->publish();
+            return;
         }
-        this->positions_map = std::move(positions_map);
-        this->index_everything();
+
+        /* Documents with an already used ID replace the old ones */
+        for (const auto &doc : docs)
+            this->delete_doc(doc.id);
+        this->add_to_buffer(docs, tokenized_docs, positions_map);
+        this->update_live_docs();
+        this->count_changes(static_cast<int>(docs.size()));
     }
+    this->publish();
+    this->schedule_merge();
 }
 
 Document Indexer::get_doc(int doc_id) {
-    std::unordered_map<int, Document> doc_cache_to_use;
-    if (FILE_BASED)
-        doc_cache_to_use = FileBasedLoader::load_doc_cache(this->index_path_dir);
-    else
-        doc_cache_to_use = this->doc_cache;
-    try {
-        return doc_cache_to_use.at(doc_id);
-    } catch (const std::out_of_range &e) {
-        std::cerr << "[ERROR]: Document with ID " << doc_id << " not found!" << std::endl;
-        return {-1, {"NENALEZENO"}, {"NENALEZENO"}, {"NENALEZENO"}, {"NENALEZENO"}, {"NENALEZENO"}, {"NENALEZENO"}};
+    if (FILE_BASED) {
+        Document doc;
+        auto disk_index = this->get_disk_index();
+        if (disk_index && disk_index->get_doc(doc_id, doc))
+            return doc;
+    } else {
+        auto snapshot = this->get_snapshot();
+        for (size_t s = snapshot->segments.size(); s-- > 0;) {
+            auto it = snapshot->segments[s]->doc_cache.find(doc_id);
+            if (it != snapshot->segments[s]->doc_cache.end() && !snapshot->deleted[s].contains(doc_id))
+                return it->second;
+        }
     }
+    std::cerr << "[ERROR]: Document with ID " << doc_id << " not found!" << std::endl;
+    return {-1, {"NENALEZENO"}, {"NENALEZENO"}, {"NENALEZENO"}, {"NENALEZENO"}, {"NENALEZENO"}, {"NENALEZENO"}};
 }
 
 TokenizedDocument Indexer::get_tokenized_doc(int doc_id) {
-    std::vector<TokenizedDocument> collection_to_use;
-    if (FILE_BASED)
-        collection_to_use = FileBasedLoader::load_tokenized_docs(this->index_path_dir);
-    else
-        collection_to_use = this->collection;
-    for (const auto &doc : collection_to_use)
-        if (doc.id == doc_id)
+    if (FILE_BASED) {
+        TokenizedDocument doc;
+        auto disk_index = this->get_disk_index();
+        if (disk_index && disk_index->get_tokenized_doc(doc_id, doc))
             return doc;
+    } else {
+        auto snapshot = this->get_snapshot();
+        for (size_t s = snapshot->segments.size(); s-- > 0;) {
+            const auto &segment = *snapshot->segments[s];
+            if (!segment.doc_ids.contains(doc_id) || snapshot->deleted[s].contains(doc_id))
+                continue;
+            for (const auto &doc : segment.collection)
+                if (doc.id == doc_id)
+                    return segment.vocabulary.decode(doc);
+        }
+    }
     return {-1, {"NENALEZENO"}, {"NENALEZENO"}, {"NENALEZENO"}, {"NENALEZENO"}, {"NENALEZENO"}, {"NENALEZENO"}};
 }
 
@@ -159,6 +460,8 @@ std::vector<Document> Indexer::get_docs(const std::vector<int> &doc_ids) {
 }
 
 void Indexer::update_docs(const std::vector<int> &doc_ids, const std::vector<Document> &docs, const std::vector<TokenizedDocument> &tokenized_docs, std::map<std::string, std::map<int, std::vector<int>>> &positions_map) {
+    auto lock = this->begin_write();
+    std::unordered_set<int> updated_ids(doc_ids.begin(), doc_ids.end());
     if (FILE_BASED) {
         auto doc_cache_ = FileBasedLoader::load_doc_cache(this->index_path_dir);
         auto tokenized_docs_ = FileBasedLoader::load_tokenized_docs(this->index_path_dir);
@@ -166,28 +469,45 @@ void Indexer::update_docs(const std::vector<int> &doc_ids, const std::vector<Doc
         for (int i = 0; i < doc_ids.size(); i++) {
             doc_cache_.erase(doc_ids[i]);
             doc_cache_.insert({doc_ids[i], docs[i]});
-            tokenized_docs_[i] = tokenized_docs[i];
+            for (auto &d : tokenized_docs_)
+                if (d.id == doc_ids[i])
+                    d = tokenized_docs[i];
         }
-        positions_map_ = std::move(positions_map);
+        purge_positions(positions_map_, updated_ids);
+        merge_positions(positions_map_, positions_map);
         FileBasedLoader::save_doc_cache(doc_cache_, this->index_path_dir);
         FileBasedLoader::save_tokenized_docs(tokenized_docs_, this->index_path_dir);
         FileBasedLoader::save_positions_map(positions_map_, this->index_path_dir);
         this->index_everything_file_based();
     } else {
+        /* Old versions are deleted and the new ones added under the same IDs */
+        std::unordered_set<int> missing_ids;
+        std::vector<Document> updated_docs;
+        std::vector<TokenizedDocument> updated_tokenized_docs;
         for (int i = 0; i < doc_ids.size(); i++) {
-            this->doc_cache.erase(doc_ids[i]);
-            this->doc_cache.insert({doc_ids[i], docs[i]});
-
-            for (auto &d: this->collection)
-                if (d.id == doc_ids[i])
-                    d = tokenized_docs[i];
+            if (!this->delete_doc(doc_ids[i])) {
+                std::cerr << "[ERROR]: Document with ID " << doc_ids[i] << " not found!" << std::endl;
+                missing_ids.insert(doc_ids[i]);
+                continue;
+            }
+            updated_docs.emplace_back(docs[i]);
+            updated_docs.back().id = doc_ids[i];
+            updated_tokenized_docs.emplace_back(tokenized_docs[i]);
+            updated_tokenized_docs.back().id = doc_ids[i];
         }
-        this->positions_map = std::move(positions_map);
-        this->index_everything();
+        purge_positions(positions_map, missing_ids);
+        if (!updated_docs.empty())
+            this->add_to_buffer(updated_docs, updated_tokenized_docs, positions_map);
+        this->update_live_docs();
+        this->count_changes(static_cast<int>(updated_docs.size()));
     }
+    this->publish();
+    this->schedule_merge();
 }
 
 void Indexer::remove_docs(const std::vector<int> &doc_ids) {
+    auto lock = this->begin_write();
+    std::unordered_set<int> removed_ids;
     if (FILE_BASED) {
         auto doc_cache_ = FileBasedLoader::load_doc_cache(this->index_path_dir);
         auto tokenized_docs_ = FileBasedLoader::load_tokenized_docs(this->index_path_dir);
@@ -205,585 +525,510 @@ void Indexer::remove_docs(const std::vector<int> &doc_ids) {
                     doc_cache_.erase(doc_id);
                     break;
                 }
-            for (auto it = positions_map_.begin(); it != positions_map_.end(); it++)
-                if (it->second.begin()->first == doc_id) {
-                    positions_map_.erase(it);
-                    break;
-                }
+            removed_ids.insert(doc_id);
         }
+        purge_positions(positions_map_, removed_ids);
         FileBasedLoader::save_doc_cache(doc_cache_, this->index_path_dir);
         FileBasedLoader::save_tokenized_docs(tokenized_docs_, this->index_path_dir);
         FileBasedLoader::save_positions_map(positions_map_, this->index_path_dir);
         this->index_everything_file_based();
     } else {
         for (const auto &doc_id : doc_ids) {
-            try {
-                this->doc_cache.at(doc_id);
-            } catch (const std::out_of_range &e) {
+            if (!this->delete_doc(doc_id)) {
                 std::cerr << "[ERROR]: Document with ID " << doc_id << " not found!" << std::endl;
                 continue;
             }
-            for (auto it = this->collection.begin(); it != this->collection.end(); it++)
-                if (it->id == doc_id) {
-                    this->collection.erase(it);
-                    this->doc_cache.erase(doc_id);
-                    break;
-                }
-            for (auto it = this->positions_map.begin(); it != this->positions_map.end(); it++)
-                if (it->second.begin()->first == doc_id) {
-                    this->positions_map.erase(it);
-                    break;
-                }
+            removed_ids.insert(doc_id);
         }
-        this->index_everything();
+        this->update_live_docs();
+        this->count_changes(static_cast<int>(removed_ids.size()));
     }
+    this->publish();
+    this->schedule_merge();
 }
 
-float Indexer::cosine_similarity(const std::map<std::string, float> &query, int doc_id, bool title) const {
-    /* Initialize dot product and norms */
-    float dot = 0;
-    float norm_query = 0;
-    float norm_doc = this->norms.at(doc_id);
-    if (title)
-        norm_doc = this->title_norms.at(doc_id);
-
-    /* Iterate over TF-IDF of words in query */
-    for (const auto& [word, value] : query) {
-        /* If word is found in a document use it for dot product */
-        if (title && this->title_index.find(word) != this->title_index.end()) {
-            for (const auto &[id, tf_idf]: this->title_index.at(word).doc_tf_idf)
-                if (id == doc_id)
-                    dot += value * tf_idf;
-        } else if (!title && this->index.find(word) != this->index.end()) {
-                for (const auto &[id, tf_idf]: this->index.at(word).doc_tf_idf)
-                    if (id == doc_id)
-                        dot += value * tf_idf;
+std::vector<posting_cursor> Indexer::create_cursors(const std::vector<std::pair<uint32_t, float>> &tf_idf_query, float norm_query, FieldType field, const std::vector<map_element> &index, const std::vector<map_element> &title_index, const std::map<int, float> &norms, const std::map<int, float> &title_norms, const ImpactIndex *impacts, const ImpactIndex *title_impacts) {
+    std::vector<posting_cursor> cursors;
+    if (norm_query == 0)
+        return cursors;
+
+    /* Cursor over the impacts if the field has them (same scores as the term at a time path), otherwise over the postings */
+    auto add_cursor = [&](uint32_t term, float weight, const std::vector<map_element> &field_index, const std::map<int, float> &field_norms, const ImpactIndex *field_impacts) {
+        if (field_impacts) {
+            /* Words with zero IDF have no impacts, they add nothing to any score */
+            if (const auto *list = field_impacts->get(term)) {
+                float step = weight * list->scale;
+                cursors.push_back({posting_iterator(), 0, nullptr, step, step * list->max_impact, list});
+            }
+        } else if (term < field_index.size() && !field_index[term].postings.empty()) {
+            cursors.push_back({posting_iterator(&field_index[term].postings), field_index[term].idf, &field_norms, weight, weight * field_index[term].max_score});
         }
-        norm_query += value * value;
+    };
+    for (const auto& [term, value] : tf_idf_query) {
+        /* Words with zero weight can not change the score */
+        if (value == 0)
+            continue;
+        float weight = value / norm_query;
+        if (field != FieldType::TITLE)
+            add_cursor(term, weight, index, norms, impacts);
+        if (field != FieldType::CONTENT)
+            add_cursor(term, field == FieldType::ALL ? weight * title_weight : weight, title_index, title_norms, title_impacts);
     }
 
-    /* Calculate cosine similarity */
-    return dot / (std::sqrt(norm_query) * norm_doc);
+    return cursors;
 }
 
-float Indexer::cosine_similarity_file_based(const map<std::string, float> &query, int doc_id, std::map<int, float> &norms, std::map<std::string, map_element> &index) const {
-    /* Initialize dot product and norms */
-    float dot = 0;
-    float norm_query = 0;
-    float norm_doc = norms.at(doc_id);
-
-    /* Iterate over TF-IDF of words in query */
-    for (const auto& [word, value] : query) {
-        /* If word is found in a document use it for dot product */
-        if (index.find(word) != index.end()) {
-            for (const auto &[id, tf_idf]: index.at(word).doc_tf_idf)
-                if (id == doc_id)
-                    dot += value * tf_idf;
-        }
-        norm_query += value * value;
+std::tuple<std::vector<int>, std::vector<float>, std::map<std::string, std::map<int, std::vector<int>>>> Indexer::search(const std::vector<std::string> &query, int k, FieldType field, int proximity, bool phrase) const {
+    auto snapshot = this->get_snapshot();
+    /* Single up to date segment is searched directly */
+    if (snapshot->segments.size() == 1 && snapshot->deleted[0].empty() && snapshot->segments[0]->idf_docs == snapshot->segments[0]->collection.size()) {
+        const auto &segment = *snapshot->segments[0];
+        return search_vector(query, k, field, proximity, phrase, segment.vocabulary, segment.index, segment.title_index, segment.norms, segment.title_norms, segment.positional_index, segment.impacts.empty() ? nullptr : &segment.impacts, segment.title_impacts.empty() ? nullptr : &segment.title_impacts);
     }
 
-    /* Calculate cosine similarity */
-    return dot / (std::sqrt(norm_query) * norm_doc);
-}
-
-std::tuple<std::vector<int>, std::vector<float>, std::map<std::string, std::map<int, std::vector<int>>>> Indexer::search(const std::vector<std::string> &query, int k, FieldType field, int proximity) const {
-    /* Calculate TF for the query */
-    auto tf_query = TF_IDF::calc_tf(query);
-    std::map<std::string, float> tf_idf_query;
-
-    /* Calculate TF-IDF for the query */
-    for (const auto& [word, value] : tf_query)
-        if (this->index.find(word) != this->index.end())
-            tf_idf_query[word] = value * this->index.at(word).idf;
-        else
-            tf_idf_query[word] = 0;
-
-    /* Calculate cosine similarity for each document */
-    std::vector<std::pair<int, float>> title_results;
-    for (const auto& doc: this->collection)
-        title_results.emplace_back(doc.id, this->cosine_similarity(tf_idf_query, doc.id, true));
+    /* Every segment is scored by its own IDF and norms (so the scores stay cosine similarities), only the query is
+     * weighted by IDF of the live documents of the whole index */
+    auto query_idf = IndexSegments::calc_query_idf(snapshot->segments, snapshot->deleted, query, snapshot->live_docs.size());
     std::vector<std::pair<int, float>> results;
-    for (const auto& doc: this->collection)
-        results.emplace_back(doc.id, this->cosine_similarity(tf_idf_query, doc.id));
-
-    /* Take care of NaNs - some documents are just titles - WTF? (ID 1492) */
-    for (auto& [doc_id, value] : results)
-        if (std::isnan(value))
-            value = 0;
-    for (auto& [doc_id, value] : title_results)
-        if (std::isnan(value))
-            value = 0;
-
-    if (field == FieldType::ALL) {
-        /* Combine results from title and content, title matches are weighted more */
-        const float title_weight = 1.5;
-        for (const auto& [doc_id, value] : results)
-            results[doc_id].second += title_weight * title_results[doc_id].second;
-    } else if (field == FieldType::TITLE) {
-        results = title_results;
-    } else if (field == FieldType::CONTENT) {
-        /* Do nothing */
-    }
-
-    /* Get positions of the words in the query */
-    std::map<std::string, std::map<int, std::vector<int>>> positions;
-    for (const auto& word : query) {
-        if (this->positions_map.find(word) != this->positions_map.end())
-            positions[word] = this->positions_map.at(word);
-    }
-
-    /* Postfilter results using proximity search */
-    if (proximity > 0) {
-        std::map<int, float> filtered_results_ids_prox_score;
-
-        /* For each pair of query words */
-        for (int i = 0; i < query.size(); i++) {
-            for (int j = i + 1; j < query.size(); j++) {
-                // Get the positions of the words in the documents */
-                auto &positions1 = positions[query[i]];
-                auto &positions2 = positions[query[j]];
-
-                /* For each document where both words appear */
-                for (auto &[doc_id, pos1]: positions1) {
-                    if (positions2.find(doc_id) != positions2.end()) {
-                        auto &pos2 = positions2[doc_id];
-
-                        /* For each pair of positions, calculate the distance */
-                        for (int pos_1: pos1) {
-                            for (int pos_2: pos2) {
-                                int distance = std::abs(pos_1 - pos_2);
-
-                                /* If the distance is less than or equal to the proximity, add the document to the result set */
-                                if (distance <= proximity) {
-                                    if (filtered_results_ids_prox_score.find(doc_id) == filtered_results_ids_prox_score.end())
-                                        filtered_results_ids_prox_score[doc_id] = 0;
-                                    filtered_results_ids_prox_score[doc_id] += 1.0 / (1 + distance);
-                                }
-                            }
-                        }
-                    }
-                }
-            }
-        }
-        /* Replace the original results with the filtered results */
-        std::vector<std::pair<int, float>> filtered_results;
-        for (const auto& [doc_id, value]: results)
-            if (filtered_results_ids_prox_score.find(doc_id) != filtered_results_ids_prox_score.end())
-                filtered_results.emplace_back(doc_id, value + filtered_results_ids_prox_score[doc_id]);
-        results = filtered_results;
-    }
-
-    /* Throw away results with score of 0 */
-    results.erase(std::remove_if(results.begin(), results.end(), [](const std::pair<int, float> &a) {
-        return a.second == 0;
-    }), results.end());
-
-    /* Sort results by cosine similarity */
-    std::sort(results.begin(), results.end(), [](const std::pair<int, float> &a, const std::pair<int, float> &b) {
-        return a.second > b.second;
-    });
-
-    /* Return top k results */
-    std::tuple<std::vector<int>, std::vector<float>, std::vector<int>> top_k;
-    if (k > results.size())
-        k = static_cast<int>(results.size());
-
-    for (int i = 0; i < k; i++) {
-        std::get<0>(top_k).emplace_back(results[i].first);
-        std::get<1>(top_k).emplace_back(results[i].second);
+    std::vector<std::map<std::string, std::map<int, std::vector<int>>>> segment_positions;
+    for (size_t s = 0; s < snapshot->segments.size(); s++) {
+        QueryDeadline::check();
+        const auto &segment = *snapshot->segments[s];
+        const auto &deleted = snapshot->deleted[s];
+        /* Deleted documents are dropped afterwards, the segment returns that many more results */
+        int segment_k = k < 0 ? k : static_cast<int>(std::min<size_t>(INT_MAX, static_cast<size_t>(k) + deleted.size()));
+        auto [ids, scores, positions] = search_vector(query, segment_k, field, proximity, phrase, segment.vocabulary, segment.index, segment.title_index, segment.norms, segment.title_norms, segment.positional_index, segment.impacts.empty() ? nullptr : &segment.impacts, segment.title_impacts.empty() ? nullptr : &segment.title_impacts, &query_idf);
+        for (size_t i = 0; i < ids.size(); i++)
+            if (deleted.empty() || !deleted.contains(ids[i]))
+                results.emplace_back(ids[i], scores[i]);
+        segment_positions.emplace_back(std::move(positions));
     }
+    auto top_k = TopKHeap::select(results, k);
 
-    /* Filter positions to only include the top k results */
-    for (const auto& [word, pos] : positions) {
-        std::map<int, std::vector<int>> temp;
-        for (const auto& [doc_id, positions_] : pos)
-            if (std::find(std::get<0>(top_k).begin(), std::get<0>(top_k).end(), doc_id) != std::get<0>(top_k).end())
-                temp[doc_id] = positions_;
-        positions[word] = temp;
+    std::vector<int> top_k_ids;
+    std::vector<float> top_k_scores;
+    for (const auto &[doc_id, score] : top_k) {
+        top_k_ids.emplace_back(doc_id);
+        top_k_scores.emplace_back(score);
     }
 
-    return {std::get<0>(top_k), std::get<1>(top_k), positions};
+    /* Positions of the query words in the top k results, every document is taken from the segment it lives in */
+    auto sorted_ids = top_k_ids;
+    std::sort(sorted_ids.begin(), sorted_ids.end());
+    DocBitmap top_k_docs(sorted_ids);
+    std::map<std::string, std::map<int, std::vector<int>>> positions;
+    for (size_t s = 0; s < segment_positions.size(); s++)
+        for (auto &[word, doc_positions] : segment_positions[s]) {
+            auto &word_positions = positions[word];
+            for (auto &[doc_id, pos] : doc_positions)
+                if (top_k_docs.contains(doc_id) && !snapshot->deleted[s].contains(doc_id))
+                    word_positions[doc_id] = std::move(pos);
+        }
+    return {top_k_ids, top_k_scores, positions};
 }
 
-std::tuple<std::vector<int>, std::map<std::string, std::map<int, std::vector<int>>>> Indexer::search(const std::vector<std::string> &query_tokens, FieldType field) const {
-    /* Stack approach thanks to postfix notation */
-    std::vector<std::vector<int>> results;
-    std::vector<std::string> query_words;
-
-    /* For each token in the query (in postfix notation) */
-    for (const auto &token : query_tokens) {
-        /* AND is just intersection */
-        if (token == operators_map[Operator::AND]) {
-            /* Pop two results from the stack */
-            auto result_2 = results.back();
-            results.pop_back();
-            auto result_1 = results.back();
-            results.pop_back();
-
-            /* Intersect */
-            auto result = std::vector<int>();
-            std::set_intersection(result_1.begin(), result_1.end(), result_2.begin(), result_2.end(), std::back_inserter(result));
-
-            /* Push the result back to the stack */
-            results.emplace_back(result);
-        /* OR is just union */
-        } else if (token == operators_map[Operator::OR]) {
-            /* Pop two results from the stack */
-            auto result_2 = results.back();
-            results.pop_back();
-            auto result_1 = results.back();
-            results.pop_back();
-
-            /* Union */
-            auto result = std::vector<int>();
-            std::set_union(result_1.begin(), result_1.end(), result_2.begin(), result_2.end(), std::back_inserter(result));
-
-            /* Push the result back to the stack */
-            results.emplace_back(result);
-        /* NOT is harder, but not really */
-        } else if (token == operators_map[Operator::NOT]) {
-            /* One operand this time */
-            auto result = results.back();
-            results.pop_back();
-
-            /* NOT */
-            auto not_result = std::vector<int>();
-            for (auto &doc : this->collection)
-                if (std::find(result.begin(), result.end(), doc.id) == result.end())
-                    not_result.emplace_back(doc.id);
-
-            /* Push the result back to the stack */
-            results.emplace_back(not_result);
-        /* Just a word */
-        } else {
-            /* If the word is in the index, push the result to the stack */
-            /* Also use this only for ALL and CONTENT fields => not for TITLE */
-            if (this->index.find(token) != this->index.end() && field != FieldType::TITLE) {
-                auto result = std::vector<int>();
-                for (const auto &[doc_id, _] : this->index.at(token).doc_tf_idf)
-                    result.emplace_back(doc_id);
-                results.emplace_back(result);
-                query_words.emplace_back(token);
-                continue;
-            /* If the word is in the title index, push the result to the stack */
-            /* Also use this only for ALL and TITLE fields => not for CONTENT */
-            } else if (this->title_index.find(token) != this->title_index.end() && field != FieldType::CONTENT) {
-                auto result = std::vector<int>();
-                for (const auto &[doc_id, _]: this->title_index.at(token).doc_tf_idf)
-                    result.emplace_back(doc_id);
-                results.emplace_back(result);
-                query_words.emplace_back(token);
-            /* If the word is not in the index, push an empty result to the stack */
-            } else {
-                results.emplace_back();
-            }
+bool Indexer::match_proximity(const std::vector<int> &pos1, const std::vector<int> &pos2, int proximity, float &score) {
+    bool matched = false;
+    size_t start = 0;
+    for (int pos_1 : pos1) {
+        /* Window of the second word is [pos_1 - proximity, pos_1 + proximity] */
+        auto low = static_cast<int64_t>(pos_1) - proximity;
+        auto high = static_cast<int64_t>(pos_1) + proximity;
+        while (start < pos2.size() && pos2[start] < low)
+            start++;
+        for (size_t j = start; j < pos2.size() && pos2[j] <= high; j++) {
+            int distance = std::abs(pos_1 - pos2[j]);
+            score += 1.0 / (1 + distance);
+            matched = true;
         }
     }
-
-    /* Positions of the words in the query */
-    std::map<std::string, std::map<int, std::vector<int>>> positions;
-    for (const auto& word : query_words) {
-        if (this->positions_map.find(word) != this->positions_map.end())
-            positions[word] = this->positions_map.at(word);
-    }
-    /* Filter positions to only include the result documents */
-    for (const auto& [word, pos] : positions) {
-        std::map<int, std::vector<int>> temp;
-        for (const auto& [doc_id, positions_] : pos)
-            if (std::find(results.back().begin(), results.back().end(), doc_id) != results.back().end())
-                temp[doc_id] = positions_;
-        positions[word] = temp;
-    }
-
-    return {results.back(), positions};
+    return matched;
 }
 
-std::tuple<std::vector<int>, std::vector<float>, std::map<std::string, std::map<int, std::vector<int>>>> Indexer::search_file_based(const vector<std::string> &query, int k, FieldType field, int proximity) const {
-    /* Calculate TF for the query */
-    auto tf_query = TF_IDF::calc_tf(query);
-    std::map<std::string, float> tf_idf_query;
-
-    /* Calculate TF-IDF for the query */
-    {
-        auto index_ = FileBasedLoader::load_tf_idf(index_path_dir);
-        for (const auto& [word, value] : tf_query)
-            if (index_.find(word) != index_.end())
-                tf_idf_query[word] = value * index_.at(word).idf;
-            else
-                tf_idf_query[word] = 0;
-    }
-
-    /* Calculate cosine similarity for each document */
-    std::vector<std::pair<int, float>> title_results;
-    std::vector<std::pair<int, float>> results;
-    {
-        auto tokenized_docs = FileBasedLoader::load_tokenized_docs(index_path_dir);
-        {
-            auto norms = FileBasedLoader::load_tf_idf_norms(index_path_dir);
-            auto index = FileBasedLoader::load_tf_idf(index_path_dir);
-            for (const auto& doc: tokenized_docs)
-                results.emplace_back(doc.id, this->cosine_similarity_file_based(tf_idf_query, doc.id, norms, index));
+bool Indexer::match_phrase(const std::vector<std::vector<int>> &positions, int proximity, float &score) {
+    bool matched = false;
+    /* Earliest positions of the previous words only move forward with the start, so every list is walked once */
+    std::vector<size_t> starts(positions.size(), 0);
+    for (int first : positions[0]) {
+        int64_t previous = first;
+        float phrase_score = 0;
+        bool complete = true;
+        for (size_t j = 1; j < positions.size() && complete; j++) {
+            /* Earliest position after the previous word leaves the most room for the rest of the phrase */
+            const auto &word_positions = positions[j];
+            auto &start = starts[j];
+            while (start < word_positions.size() && word_positions[start] <= previous)
+                start++;
+            complete = start < word_positions.size() && word_positions[start] <= previous + proximity;
+            if (!complete)
+                break;
+            phrase_score += 1.0 / (1 + (word_positions[start] - previous));
+            previous = word_positions[start];
         }
-        {
-            auto norms = FileBasedLoader::load_tf_idf_norms(index_path_dir, true);
-            auto index = FileBasedLoader::load_tf_idf(index_path_dir, true);
-            for (const auto& doc: tokenized_docs)
-                title_results.emplace_back(doc.id, this->cosine_similarity_file_based(tf_idf_query, doc.id, norms, index));
+        if (complete) {
+            score += phrase_score;
+            matched = true;
         }
     }
+    return matched;
+}
 
-    if (field == FieldType::ALL) {
-        /* Combine results from title and content, title matches are weighted more */
-        const float title_weight = 1.5;
-        for (const auto& [doc_id, value] : results)
-            results[doc_id].second += title_weight * title_results[doc_id].second;
-    } else if (field == FieldType::TITLE) {
-        results = title_results;
-    } else if (field == FieldType::CONTENT) {
-        /* Do nothing */
-    }
+std::tuple<std::vector<int>, std::vector<float>, std::map<std::string, std::map<int, std::vector<int>>>> Indexer::search_vector(const std::vector<std::string> &query, int k, FieldType field, int proximity, bool phrase, const Vocabulary &vocabulary, const std::vector<map_element> &index, const std::vector<map_element> &title_index, const std::map<int, float> &norms, const std::map<int, float> &title_norms, const std::vector<PositionList> &positions, const ImpactIndex *impacts, const ImpactIndex *title_impacts, const std::map<std::string, float> *query_idf) {
+    /* Words are looked up in the dictionary once, the rest works with term IDs */
+    std::vector<uint32_t> query_terms;
+    query_terms.reserve(query.size());
+    for (const auto &word : query)
+        query_terms.emplace_back(vocabulary.find(word));
+
+    /* IDF of the query word (zero for unknown words) */
+    auto get_idf = [&](uint32_t term) -> float {
+        if (query_idf) {
+            auto it = term != Vocabulary::NO_TERM ? query_idf->find(vocabulary.get_word(term)) : query_idf->end();
+            return it != query_idf->end() ? it->second : 0;
+        }
+        return term < index.size() && !index[term].postings.empty() ? index[term].idf : 0;
+    };
 
-    /* Take care of nans */
-    for (auto& [doc_id, value] : results)
-        if (std::isnan(value))
-            value = 0;
+    /* Calculate TF-IDF for the query (unknown words have zero weight) */
+    auto tf_idf_query = TF_IDF::calc_tf(query_terms);
+    for (auto& [term, value] : tf_idf_query)
+        value *= get_idf(term);
 
-    /* Get positions of the words in the query */
-    std::map<std::string, std::map<int, std::vector<int>>> positions;
-    {
-        auto positions_map_ = FileBasedLoader::load_positions_map(index_path_dir);
-        for (const auto& word : query) {
-            if (positions_map_.find(word) != positions_map_.end())
-                positions[word] = positions_map_.at(word);
+    /* Norm of the query is the same for titles and content */
+    float norm_query = 0;
+    if (query_idf) {
+        /* Words missing in this part of the index still count, the norm is the one of the whole query */
+        std::map<std::string, uint32_t> counts;
+        for (const auto &word : query)
+            counts[word]++;
+        for (const auto &[word, count] : counts) {
+            auto it = query_idf->find(word);
+            float value = it != query_idf->end() ? TF_IDF::tf_weight(count) * it->second : 0;
+            norm_query += value * value;
         }
+    } else {
+        for (const auto& [term, value] : tf_idf_query)
+            norm_query += value * value;
     }
+    norm_query = std::sqrt(norm_query);
+
+    /* Small k without proximity - MaxScore skips documents that can not get into the top k */
+    std::vector<std::pair<int, float>> top_k;
+    auto cursors = create_cursors(tf_idf_query, norm_query, field, index, title_index, norms, title_norms, impacts, title_impacts);
+    size_t postings_count = 0;
+    for (const auto &cursor : cursors)
+        postings_count += cursor.size();
+    if (proximity <= 0 && k >= 0 && static_cast<size_t>(k) < postings_count) {
+        top_k = MaxScore::top_k(cursors, k);
+    } else {
+        /* Accumulate cosine similarity term at a time, only documents containing the query words are touched */
+        thread_local ScoreAccumulator content_scores;
+        thread_local ScoreAccumulator title_scores;
+        content_scores.reset();
+        title_scores.reset();
+        /* Precomputed impacts skip the norms, otherwise the dot products are normalized afterwards */
+        if (field != FieldType::TITLE && impacts) {
+            content_scores.accumulate(tf_idf_query, *impacts, norm_query);
+        } else if (field != FieldType::TITLE) {
+            content_scores.accumulate(tf_idf_query, index);
+            content_scores.normalize(norms, norm_query);
+        }
+        if (field != FieldType::CONTENT && title_impacts) {
+            title_scores.accumulate(tf_idf_query, *title_impacts, norm_query);
+        } else if (field != FieldType::CONTENT) {
+            title_scores.accumulate(tf_idf_query, title_index);
+            title_scores.normalize(title_norms, norm_query);
+        }
 
-    /* Postfilter results using proximity search */
-    if (proximity > 0) {
-        std::map<int, float> filtered_results_ids_prox_score;
-
-        /* For each pair of query words */
-        for (int i = 0; i < query.size(); i++) {
-            for (int j = i + 1; j < query.size(); j++) {
-                // Get the positions of the words in the documents */
-                auto &positions1 = positions[query[i]];
-                auto &positions2 = positions[query[j]];
-
-                /* For each document where both words appear */
-                for (auto &[doc_id, pos1]: positions1) {
-                    if (positions2.find(doc_id) != positions2.end()) {
-                        auto &pos2 = positions2[doc_id];
-
-                        /* For each pair of positions, calculate the distance */
-                        for (int pos_1: pos1) {
-                            for (int pos_2: pos2) {
-                                int distance = std::abs(pos_1 - pos_2);
-
-                                /* If the distance is less than or equal to the proximity, add the document to the result set */
-                                if (distance <= proximity) {
-                                    if (filtered_results_ids_prox_score.find(doc_id) == filtered_results_ids_prox_score.end())
-                                        filtered_results_ids_prox_score[doc_id] = 0;
-                                    filtered_results_ids_prox_score[doc_id] += 1.0 / (1 + distance);
-                                }
-                            }
-                        }
+        /* Combine results from title and content, title matches are weighted more */
+        if (field == FieldType::ALL)
+            content_scores.merge(title_scores, title_weight);
+        const auto &scores = field == FieldType::TITLE ? title_scores : content_scores;
+
+        /* Postfilter results using proximity search */
+        std::vector<std::pair<int, float>> results;
+        if (proximity > 0 && phrase) {
+            /* Documents with all the words of the phrase, every word has to be in the positions */
+            std::vector<const PositionList *> phrase_lists;
+            for (const auto &term : query_terms)
+                phrase_lists.emplace_back(term < positions.size() && !positions[term].empty() ? &positions[term] : nullptr);
+            if (!phrase_lists.empty() && std::find(phrase_lists.begin(), phrase_lists.end(), nullptr) == phrase_lists.end()) {
+                const auto &first = *phrase_lists[0];
+                std::vector<size_t> doc_cursors(phrase_lists.size(), 0);
+                std::vector<std::vector<int>> phrase_positions(phrase_lists.size());
+                for (size_t i = 0; i < first.size(); i++) {
+                    if (i % QueryDeadline::CHECK_INTERVAL == 0)
+                        QueryDeadline::check();
+                    /* Documents of the first word are galloped to in the lists of the others */
+                    int doc_id = first.get_doc_id(i);
+                    bool all_words = true;
+                    for (size_t j = 1; j < phrase_lists.size() && all_words; j++) {
+                        doc_cursors[j] = phrase_lists[j]->find(doc_id, doc_cursors[j]);
+                        all_words = doc_cursors[j] < phrase_lists[j]->size() && phrase_lists[j]->get_doc_id(doc_cursors[j]) == doc_id;
                     }
+                    if (!all_words)
+                        continue;
+
+                    /* The whole phrase has to be there in the query order, proximity is the distance of the following words */
+                    first.decode(i, phrase_positions[0]);
+                    for (size_t j = 1; j < phrase_lists.size(); j++)
+                        phrase_lists[j]->decode(doc_cursors[j], phrase_positions[j]);
+                    float prox_score = 0;
+                    if (match_phrase(phrase_positions, proximity, prox_score))
+                        results.emplace_back(doc_id, scores.get(doc_id) + prox_score);
                 }
             }
+        } else if (proximity > 0) {
+            std::map<int, float> filtered_results_ids_prox_score;
+            std::vector<int> pos1, pos2;
+
+            /* For each pair of query words */
+            for (int i = 0; i < query_terms.size(); i++) {
+                for (int j = i + 1; j < query_terms.size(); j++) {
+                    QueryDeadline::check();
+                    if (query_terms[i] >= positions.size() || query_terms[j] >= positions.size())
+                        continue;
+                    const auto &positions1 = positions[query_terms[i]];
+                    const auto &positions2 = positions[query_terms[j]];
+
+                    /* For each document where both words appear (galloping intersection of the document lists) */
+                    PositionList::intersect(positions1, positions2, [&](int doc_id, size_t first, size_t second) {
+                        positions1.decode(first, pos1);
+                        positions2.decode(second, pos2);
+
+                        /* If any pair of positions is within the proximity, add the document to the result set */
+                        auto it = filtered_results_ids_prox_score.find(doc_id);
+                        float prox_score = it != filtered_results_ids_prox_score.end() ? it->second : 0;
+                        if (match_proximity(pos1, pos2, proximity, prox_score))
+                            filtered_results_ids_prox_score[doc_id] = prox_score;
+                    });
+                }
+            }
+            /* Only the documents that passed the proximity filter are results */
+            for (const auto& [doc_id, prox_score]: filtered_results_ids_prox_score)
+                results.emplace_back(doc_id, scores.get(doc_id) + prox_score);
+        } else {
+            results = scores.get_results();
         }
-        /* Replace the original results with the filtered results */
-        std::vector<std::pair<int, float>> filtered_results;
-        for (const auto& [doc_id, value]: results)
-            if (filtered_results_ids_prox_score.find(doc_id) != filtered_results_ids_prox_score.end())
-                filtered_results.emplace_back(doc_id, value + filtered_results_ids_prox_score[doc_id]);
-        results = filtered_results;
-    }
 
-    /* Sort results by cosine similarity */
-    std::sort(results.begin(), results.end(), [](const std::pair<int, float> &a, const std::pair<int, float> &b) {
-        return a.second > b.second;
-    });
+        /* Heap for small k, sort for k covering all the results */
+        top_k = TopKHeap::select(results, k);
+    }
 
     /* Return top k results */
-    std::tuple<std::vector<int>, std::vector<float>, std::vector<int>> top_k;
-    if (k > results.size())
-        k = static_cast<int>(results.size());
-
-    for (int i = 0; i < k; i++) {
-        std::get<0>(top_k).emplace_back(results[i].first);
-        std::get<1>(top_k).emplace_back(results[i].second);
+    std::vector<int> top_k_ids;
+    std::vector<float> top_k_scores;
+    for (const auto &[doc_id, score] : top_k) {
+        top_k_ids.emplace_back(doc_id);
+        top_k_scores.emplace_back(score);
     }
 
-    /* Filter positions to only include the top k results */
-    for (const auto& [word, pos] : positions) {
-        std::map<int, std::vector<int>> temp;
-        for (const auto& [doc_id, positions_] : pos)
-            if (std::find(std::get<0>(top_k).begin(), std::get<0>(top_k).end(), doc_id) != std::get<0>(top_k).end())
-                temp[doc_id] = positions_;
-        positions[word] = temp;
-    }
+    /* Positions of the query words in the top k results */
+    return {top_k_ids, top_k_scores, get_positions(query, vocabulary, positions, top_k_ids)};
+}
 
-    return {std::get<0>(top_k), std::get<1>(top_k), positions};
+std::map<std::string, std::map<int, std::vector<int>>> Indexer::get_positions(const std::vector<std::string> &words, const Vocabulary &vocabulary, const std::vector<PositionList> &positions, const std::vector<int> &doc_ids) {
+    /* Sorted copy for binary search, k can be huge (evaluation) */
+    auto sorted_ids = doc_ids;
+    std::sort(sorted_ids.begin(), sorted_ids.end());
+    std::map<std::string, std::map<int, std::vector<int>>> result;
+    for (const auto &word : words) {
+        auto term = vocabulary.find(word);
+        if (term >= positions.size() || positions[term].empty() || result.find(word) != result.end())
+            continue;
+        /* Both lists are sorted, the documents are galloped to */
+        auto &word_positions = result[word];
+        const auto &list = positions[term];
+        size_t i = 0;
+        for (const auto &doc_id : sorted_ids) {
+            i = list.find(doc_id, i);
+            if (i >= list.size())
+                break;
+            if (list.get_doc_id(i) == doc_id)
+                word_positions.emplace_hint(word_positions.end(), doc_id, list.get_positions(i));
+        }
+    }
+    return result;
 }
 
-std::tuple<std::vector<int>, std::map<std::string, std::map<int, std::vector<int>>>> Indexer::search_file_based(const vector<std::string> &query_tokens, FieldType field) const {
-    /* Stack approach thanks to postfix notation */
-    std::vector<std::vector<int>> results;
+std::tuple<std::vector<int>, std::map<std::string, std::map<int, std::vector<int>>>> Indexer::search(const std::vector<std::string> &query_tokens, FieldType field) const {
+    auto snapshot = this->get_snapshot();
     std::vector<std::string> query_words;
+    if (snapshot->segments.size() == 1 && snapshot->deleted[0].empty()) {
+        const auto &segment = *snapshot->segments[0];
+        auto result = search_boolean(query_tokens, field, segment.vocabulary, segment.index, segment.title_index, snapshot->live_docs, query_words);
 
-    {
-        auto index_ = FileBasedLoader::load_tf_idf(index_path_dir);
-        auto title_index_ = FileBasedLoader::load_tf_idf(index_path_dir, true);
-        auto tokenized_docs = FileBasedLoader::load_tokenized_docs(index_path_dir);
-
-        /* For each token in the query (in postfix notation) */
-        for (const auto &token: query_tokens) {
-            /* AND is just intersection */
-            if (token == operators_map[Operator::AND]) {
-                /* Pop two results from the stack */
-                auto result_2 = results.back();
-                results.pop_back();
-                auto result_1 = results.back();
-                results.pop_back();
-
-                /* Intersect */
-                auto result = std::vector<int>();
-                std::set_intersection(result_1.begin(), result_1.end(), result_2.begin(), result_2.end(),
-                                      std::back_inserter(result));
-
-                /* Push the result back to the stack */
-                results.emplace_back(result);
-                /* OR is just union */
-            } else if (token == operators_map[Operator::OR]) {
-                /* Pop two results from the stack */
-                auto result_2 = results.back();
-                results.pop_back();
-                auto result_1 = results.back();
-                results.pop_back();
-
-                /* Union */
-                auto result = std::vector<int>();
-                std::set_union(result_1.begin(), result_1.end(), result_2.begin(), result_2.end(),
-                               std::back_inserter(result));
-
-                /* Push the result back to the stack */
-                results.emplace_back(result);
-                /* NOT is harder, but not really */
-            } else if (token == operators_map[Operator::NOT]) {
-                /* One operand this time */
-                auto result = results.back();
-                results.pop_back();
-
-                /* NOT */
-                auto not_result = std::vector<int>();
-                for (auto &doc: tokenized_docs)
-                    if (std::find(result.begin(), result.end(), doc.id) == result.end())
-                        not_result.emplace_back(doc.id);
-
-                /* Push the result back to the stack */
-                results.emplace_back(not_result);
-                /* Just a word */
-            } else {
-                /* If the word is in the index, push the result to the stack */
-                /* Also use this only for ALL and CONTENT fields => not for TITLE */
-                if (index_.find(token) != index_.end() && field != FieldType::TITLE) {
-                    auto result = std::vector<int>();
-                    for (const auto &[doc_id, _]: index_.at(token).doc_tf_idf)
-                        result.emplace_back(doc_id);
-                    results.emplace_back(result);
-                    query_words.emplace_back(token);
-                    continue;
-                    /* If the word is in the title index, push the result to the stack */
-                    /* Also use this only for ALL and TITLE fields => not for CONTENT */
-                } else if (title_index_.find(token) != title_index_.end() && field != FieldType::CONTENT) {
-                    auto result = std::vector<int>();
-                    for (const auto &[doc_id, _]: title_index_.at(token).doc_tf_idf)
-                        result.emplace_back(doc_id);
-                    results.emplace_back(result);
-                    query_words.emplace_back(token);
-                    /* If the word is not in the index, push an empty result to the stack */
-                } else {
-                    results.emplace_back();
-                }
-            }
-        }
+        /* Positions of the words in the query, only in the result documents */
+        return {result, get_positions(query_words, segment.vocabulary, segment.positional_index, result)};
     }
 
-    /* Positions of the words in the query */
-    std::map<std::string, std::map<int, std::vector<int>>> positions;
-    {
-        auto positions_map_ = FileBasedLoader::load_positions_map(index_path_dir);
-        for (const auto& word : query_words) {
-            if (positions_map_.find(word) != positions_map_.end())
-                positions[word] = positions_map_.at(word);
-        }
+    /* Postings of the words only, operators are not in the index */
+    Vocabulary query_vocabulary;
+    for (const auto &token : query_tokens)
+        if (token != operators_map[Operator::AND] && token != operators_map[Operator::OR] && token != operators_map[Operator::NOT])
+            query_vocabulary.add(token);
+    auto index_ = IndexSegments::load_query_postings(snapshot->segments, snapshot->deleted, query_vocabulary, false);
+    auto title_index_ = IndexSegments::load_query_postings(snapshot->segments, snapshot->deleted, query_vocabulary, true);
+    auto result = search_boolean(query_tokens, field, query_vocabulary, index_, title_index_, snapshot->live_docs, query_words);
+
+    auto positions = IndexSegments::load_query_positions(snapshot->segments, snapshot->deleted, query_vocabulary, query_words);
+    return {result, get_positions(query_words, query_vocabulary, positions, result)};
+}
+
+std::vector<int> Indexer::search_boolean(const std::vector<std::string> &query_tokens, FieldType field, const Vocabulary &vocabulary, const std::vector<map_element> &index, const std::vector<map_element> &title_index, const DocBitmap &all_docs, std::vector<std::string> &query_words) {
+    /* Posting list of the word, content index is used for ALL and CONTENT fields, title index for ALL and TITLE fields */
+    auto lookup = [&](const std::string &word) -> const PostingList * {
+        auto term = vocabulary.find(word);
+        if (term < index.size() && !index[term].postings.empty() && field != FieldType::TITLE)
+            return &index[term].postings;
+        if (term < title_index.size() && !title_index[term].postings.empty() && field != FieldType::CONTENT)
+            return &title_index[term].postings;
+        return nullptr;
+    };
+
+    /* Every word found in the index is a query word, even if its subtree is skipped during the evaluation */
+    for (const auto &token : query_tokens)
+        if (token != operators_map[Operator::AND] && token != operators_map[Operator::OR] && token != operators_map[Operator::NOT] && lookup(token))
+            query_words.emplace_back(token);
+
+    query_node root;
+    if (!QueryPlanner::plan(query_tokens, lookup, all_docs.size(), root))
+        return {};
+    return QueryPlanner::execute(root, all_docs);
+}
+
+std::vector<map_element> Indexer::load_query_index(DiskIndex &disk_index, const Vocabulary &query_vocabulary, bool title) {
+    /* Only the postings of the query words are read from the disk */
+    std::vector<map_element> query_index(query_vocabulary.size());
+    for (uint32_t term = 0; term < query_vocabulary.size(); term++) {
+        QueryDeadline::check();
+        if (auto element = disk_index.get_postings(query_vocabulary.get_word(term), title))
+            query_index[term] = *element;
     }
+    return query_index;
+}
 
-    /* Filter positions to only include the result documents */
-    for (const auto& [word, pos] : positions) {
-        std::map<int, std::vector<int>> temp;
-        for (const auto& [doc_id, positions_] : pos)
-            if (std::find(results.back().begin(), results.back().end(), doc_id) != results.back().end())
-                temp[doc_id] = positions_;
-        positions[word] = temp;
+std::vector<PositionList> Indexer::load_query_positions(DiskIndex &disk_index, const Vocabulary &query_vocabulary, const std::vector<std::string> &words) {
+    std::vector<PositionList> positions(query_vocabulary.size());
+    for (const auto &word : words) {
+        auto term = query_vocabulary.find(word);
+        if (term == Vocabulary::NO_TERM || !positions[term].empty())
+            continue;
+        if (auto doc_positions = disk_index.get_positions(word))
+            positions[term] = *doc_positions;
     }
+    return positions;
+}
+
+std::tuple<std::vector<int>, std::vector<float>, std::map<std::string, std::map<int, std::vector<int>>>> Indexer::search_file_based(const vector<std::string> &query, int k, FieldType field, int proximity, bool phrase) const {
+    auto disk_index = this->get_disk_index();
+    if (!disk_index)
+        return {};
+
+    /* Term IDs local to the query, the indices hold just the query words */
+    Vocabulary query_vocabulary;
+    for (const auto &word : query)
+        query_vocabulary.add(word);
+
+    /* Content index is needed for the query IDF even when searching only in titles */
+    auto index_ = load_query_index(*disk_index, query_vocabulary);
+    std::vector<map_element> title_index_;
+    if (field != FieldType::CONTENT)
+        title_index_ = load_query_index(*disk_index, query_vocabulary, true);
+    auto positions = load_query_positions(*disk_index, query_vocabulary, query);
+
+    return search_vector(query, k, field, proximity, phrase, query_vocabulary, index_, title_index_, disk_index->get_norms(), disk_index->get_norms(true), positions);
+}
 
-    return {results.back(), positions};
+std::tuple<std::vector<int>, std::map<std::string, std::map<int, std::vector<int>>>> Indexer::search_file_based(const vector<std::string> &query_tokens, FieldType field) const {
+    auto disk_index = this->get_disk_index();
+    if (!disk_index)
+        return {};
+
+    /* Postings of the words only, operators are not in the index */
+    Vocabulary query_vocabulary;
+    for (const auto &token : query_tokens)
+        if (token != operators_map[Operator::AND] && token != operators_map[Operator::OR] && token != operators_map[Operator::NOT])
+            query_vocabulary.add(token);
+    auto index_ = load_query_index(*disk_index, query_vocabulary);
+    auto title_index_ = load_query_index(*disk_index, query_vocabulary, true);
+
+    std::vector<std::string> query_words;
+    auto result = search_boolean(query_tokens, field, query_vocabulary, index_, title_index_, disk_index->get_live_docs(), query_words);
+
+    /* Positions of the words in the query, only in the result documents */
+    auto positions = load_query_positions(*disk_index, query_vocabulary, query_words);
+    return {result, get_positions(query_words, query_vocabulary, positions, result)};
 }
 
 json Indexer::to_json() const {
+    /* Saved index is a single segment, the format does not depend on how the index was built */
+    auto segment = flatten(*this->get_snapshot());
     json j;
     j["collection"] = json::array();
-    for (const auto &doc : this->collection)
-        j["collection"].push_back(doc.to_json());
+    for (const auto &doc : segment->collection)
+        j["collection"].push_back(segment->vocabulary.decode(doc).to_json());
     j["doc_cache"] = json::array();
-    for (const auto &[id, doc] : this->doc_cache)
+    for (const auto &[id, doc] : segment->doc_cache)
         j["doc_cache"].push_back(doc.to_json());
     j["index"] = json::object();
-    for (const auto &[word, element] : this->index)
-        j["index"][word] = element.to_json();
+    for (const auto &term : sorted_terms(segment->index, segment->vocabulary))
+        j["index"][segment->vocabulary.get_word(term)] = segment->index[term].to_json();
     j["title_index"] = json::object();
-    for (const auto &[word, element] : this->title_index)
-        j["title_index"][word] = element.to_json();
-    j["norms"] = this->norms;
-    j["title_norms"] = this->title_norms;
+    for (const auto &term : sorted_terms(segment->title_index, segment->vocabulary))
+        j["title_index"][segment->vocabulary.get_word(term)] = segment->title_index[term].to_json();
+    j["norms"] = segment->norms;
+    j["title_norms"] = segment->title_norms;
     j["positions_map"] = json::object();
-    for (const auto& [word, doc_positions] : this->positions_map) {
+    for (uint32_t term = 0; term < segment->positional_index.size(); term++) {
+        if (segment->positional_index[term].empty())
+            continue;
+        const auto &word = segment->vocabulary.get_word(term);
         j["positions_map"][word] = json::object();
-        for (const auto& [doc_id, positions] : doc_positions) {
-            j["positions_map"][word][std::to_string(doc_id)] = json::array();
-            for (const auto& pos : positions)
-                j["positions_map"][word][std::to_string(doc_id)].push_back(pos);
-        }
+        const auto &word_positions = segment->positional_index[term];
+        for (size_t i = 0; i < word_positions.size(); i++)
+            j["positions_map"][word][std::to_string(word_positions.get_doc_id(i))] = word_positions.get_positions(i);
     }
     return j;
 }
 
 void Indexer::from_json(const json &j) {
+    auto lock = this->begin_write();
+    auto segment = std::make_shared<index_segment>();
     auto temp = j.at("collection");
     for (const auto &doc : temp) {
         TokenizedDocument temp_doc;
         temp_doc.from_json(doc);
-        this->collection.emplace_back(temp_doc);
+        segment->collection.emplace_back(segment->vocabulary.encode(temp_doc));
     }
     temp = j.at("doc_cache");
     for (const auto &doc : temp) {
         Document temp_doc;
         temp_doc.from_json(doc);
-        this->doc_cache.insert({temp_doc.id, temp_doc});
+        segment->doc_cache.insert({temp_doc.id, temp_doc});
     }
+    /* Words of the indices come from the collection, they are interned just in case */
     temp = j.at("index");
-    for (const auto &element : temp.items())
-        this->index.insert({element.key(), map_element::from_json(element.value())});
+    for (const auto &element : temp.items()) {
+        auto term = segment->vocabulary.add(element.key());
+        segment->index.resize(segment->vocabulary.size());
+        segment->index[term] = map_element::from_json(element.value());
+    }
     temp = j.at("title_index");
-    for (const auto &element : temp.items())
-        this->title_index.insert({element.key(), map_element::from_json(element.value())});
-    this->norms = j.at("norms").get<std::map<int, float>>();
-    this->title_norms = j.at("title_norms").get<std::map<int, float>>();
-    this->positions_map = std::map<std::string, std::map<int, std::vector<int>>>();
+    for (const auto &element : temp.items()) {
+        auto term = segment->vocabulary.add(element.key());
+        segment->title_index.resize(segment->vocabulary.size());
+        segment->title_index[term] = map_element::from_json(element.value());
+    }
+    segment->norms = j.at("norms").get<std::map<int, float>>();
+    segment->title_norms = j.at("title_norms").get<std::map<int, float>>();
+    /* Indices saved before the compressed postings have only TF-IDF values, they are rebuilt from the collection */
+    if (!j.at("index").empty() && !j.at("index").begin()->contains("postings"))
+        IndexSegments::weigh(*segment);
+    segment->positional_index = std::vector<PositionList>();
     temp = j.at("positions_map");
     for (const auto& [word, doc_positions] : temp.items()) {
+        /* Document IDs are JSON keys (sorted as strings), the list is filled in numeric order */
         std::map<int, std::vector<int>> temp_map;
         for (const auto& [doc_id, positions] : doc_positions.items()) {
             std::vector<int> temp_vec;
@@ -791,30 +1036,193 @@ void Indexer::from_json(const json &j) {
                 temp_vec.push_back(pos);
             temp_map[std::stoi(doc_id)] = temp_vec;
         }
-        this->positions_map[word] = temp_map;
+        auto term = segment->vocabulary.add(word);
+        segment->positional_index.resize(segment->vocabulary.size());
+        for (const auto &[doc_id, positions] : temp_map)
+            segment->positional_index[term].set(doc_id, positions);
+    }
+    /* Saved index is weighted over its whole collection */
+    segment->idf_docs = segment->collection.size();
+    IndexSegments::build_impacts(*segment);
+    IndexSegments::collect_doc_ids(*segment);
+    segment->sealed = segment->collection.size() >= IndexSegments::SEGMENT_SIZE;
+    /* Loaded index replaces the current one */
+    this->state->segments = {segment};
+    this->state->deleted = {DocBitmap()};
+    this->update_live_docs();
+    this->publish();
+}
+
+void Indexer::to_binary(BinaryWriter &writer) const {
+    auto segment = flatten(*this->get_snapshot());
+    writer.write(static_cast<uint32_t>(segment->collection.size()));
+    for (const auto &doc : segment->collection)
+        segment->vocabulary.decode(doc).to_binary(writer);
+    writer.write(static_cast<uint32_t>(segment->doc_cache.size()));
+    for (const auto &[id, doc] : segment->doc_cache)
+        doc.to_binary(writer);
+    index_to_binary(writer, segment->index, segment->vocabulary);
+    index_to_binary(writer, segment->title_index, segment->vocabulary);
+    norms_to_binary(writer, segment->norms);
+    norms_to_binary(writer, segment->title_norms);
+    std::vector<uint32_t> terms;
+    for (uint32_t term = 0; term < segment->positional_index.size(); term++)
+        if (!segment->positional_index[term].empty())
+            terms.emplace_back(term);
+    std::sort(terms.begin(), terms.end(), [&segment](uint32_t a, uint32_t b) { return segment->vocabulary.get_word(a) < segment->vocabulary.get_word(b); });
+    writer.write(static_cast<uint32_t>(terms.size()));
+    for (const auto &term : terms) {
+        writer.write_string(segment->vocabulary.get_word(term));
+        segment->positional_index[term].to_binary(writer);
+    }
+}
+
+void Indexer::from_binary(BinaryReader &reader) {
+    auto lock = this->begin_write();
+    auto segment = std::make_shared<index_segment>();
+    auto count = reader.read<uint32_t>();
+    segment->collection.reserve(count);
+    for (uint32_t i = 0; i < count; i++) {
+        TokenizedDocument temp_doc;
+        temp_doc.from_binary(reader);
+        segment->collection.emplace_back(segment->vocabulary.encode(temp_doc));
+    }
+    count = reader.read<uint32_t>();
+    segment->doc_cache.reserve(count);
+    for (uint32_t i = 0; i < count; i++) {
+        Document temp_doc;
+        temp_doc.from_binary(reader);
+        segment->doc_cache.insert({temp_doc.id, std::move(temp_doc)});
+    }
+    segment->index = index_from_binary(reader, segment->vocabulary);
+    segment->title_index = index_from_binary(reader, segment->vocabulary);
+    segment->norms = norms_from_binary(reader);
+    segment->title_norms = norms_from_binary(reader);
+    segment->positional_index = std::vector<PositionList>();
+    count = reader.read<uint32_t>();
+    for (uint32_t i = 0; i < count; i++) {
+        auto term = segment->vocabulary.add(reader.read_string());
+        if (term >= segment->positional_index.size())
+            segment->positional_index.resize(segment->vocabulary.size());
+        segment->positional_index[term].from_binary(reader);
+    }
+    /* Saved index is weighted over its whole collection */
+    segment->idf_docs = segment->collection.size();
+    IndexSegments::build_impacts(*segment);
+    IndexSegments::collect_doc_ids(*segment);
+    segment->sealed = segment->collection.size() >= IndexSegments::SEGMENT_SIZE;
+    /* Loaded index replaces the current one */
+    this->state->segments = {segment};
+    this->state->deleted = {DocBitmap()};
+    this->update_live_docs();
+    this->publish();
+}
+
+std::vector<uint32_t> Indexer::sorted_terms(const std::vector<map_element> &index, const Vocabulary &vocabulary) {
+    std::vector<uint32_t> terms;
+    for (uint32_t term = 0; term < index.size(); term++)
+        if (!index[term].postings.empty())
+            terms.emplace_back(term);
+    std::sort(terms.begin(), terms.end(), [&vocabulary](uint32_t a, uint32_t b) { return vocabulary.get_word(a) < vocabulary.get_word(b); });
+    return terms;
+}
+
+void Indexer::index_to_binary(BinaryWriter &writer, const std::vector<map_element> &index, const Vocabulary &vocabulary) {
+    /* Words sorted, every word followed by its compressed posting list */
+    auto terms = sorted_terms(index, vocabulary);
+    writer.write(static_cast<uint32_t>(terms.size()));
+    for (const auto &term : terms) {
+        const auto &element = index[term];
+        writer.write_string(vocabulary.get_word(term));
+        writer.write(element.idf);
+        writer.write(element.max_score);
+        element.postings.to_binary(writer);
     }
 }
 
+std::vector<map_element> Indexer::index_from_binary(BinaryReader &reader, Vocabulary &vocabulary) {
+    auto count = reader.read<uint32_t>();
+    std::vector<std::pair<uint32_t, map_element>> elements;
+    elements.reserve(count);
+    for (uint32_t i = 0; i < count; i++) {
+        auto term = vocabulary.add(reader.read_string());
+        map_element element;
+        element.idf = reader.read<float>();
+        element.max_score = reader.read<float>();
+        element.postings.from_binary(reader);
+        elements.emplace_back(term, std::move(element));
+    }
+
+    std::vector<map_element> index(vocabulary.size());
+    for (auto &[term, element] : elements)
+        index[term] = std::move(element);
+    return index;
+}
+
+void Indexer::norms_to_binary(BinaryWriter &writer, const std::map<int, float> &norms) {
+    writer.write(static_cast<uint32_t>(norms.size()));
+    for (const auto &[doc_id, norm] : norms)
+        writer.write(doc_id);
+    for (const auto &[doc_id, norm] : norms)
+        writer.write(norm);
+}
+
+std::map<int, float> Indexer::norms_from_binary(BinaryReader &reader) {
+    auto count = reader.read<uint32_t>();
+    std::vector<int> doc_ids(count);
+    std::vector<float> values(count);
+    reader.read_array(doc_ids.data(), count);
+    reader.read_array(values.data(), count);
+
+    std::map<int, float> norms;
+    for (uint32_t i = 0; i < count; i++)
+        norms.emplace_hint(norms.end(), doc_ids[i], values[i]);
+    return norms;
+}
+
 int Indexer::get_collection_size() const {
-    return static_cast<int>(this->collection.size());
+    return static_cast<int>(this->get_snapshot()->live_docs.size());
+}
+
+size_t Indexer::count_words(const std::vector<map_element> &index) {
+    return std::count_if(index.begin(), index.end(), [](const map_element &element) { return !element.postings.empty(); });
 }
 
 int Indexer::get_index_size() const {
-    return static_cast<int>(this->index.size());
+    auto snapshot = this->get_snapshot();
+    if (snapshot->segments.size() == 1)
+        return static_cast<int>(count_words(snapshot->segments[0]->index));
+    return static_cast<int>(IndexSegments::collect_words(snapshot->segments, false).size());
 }
 
 int Indexer::get_title_index_size() const {
-    return static_cast<int>(this->title_index.size());
+    auto snapshot = this->get_snapshot();
+    if (snapshot->segments.size() == 1)
+        return static_cast<int>(count_words(snapshot->segments[0]->title_index));
+    return static_cast<int>(IndexSegments::collect_words(snapshot->segments, true).size());
 }
 
 std::unordered_set<std::string> Indexer::get_keywords() const {
-    return this->keywords;
+    auto snapshot = this->get_snapshot();
+    /* Words of the indexed fields are exactly the words with postings */
+    if (!FILE_BASED) {
+        auto result = IndexSegments::collect_words(snapshot->segments, false);
+        result.merge(IndexSegments::collect_words(snapshot->segments, true));
+        return result;
+    }
+    std::unordered_set<std::string> result;
+    result.reserve(snapshot->keywords.size());
+    for (const auto &term : snapshot->keywords)
+        result.insert(snapshot->vocabulary.get_word(term));
+    return result;
 }
 
 int Indexer::get_max_doc_id() const {
+    auto snapshot = this->get_snapshot();
     int max_id = 0;
-    for (const auto &doc : this->collection)
-        if (doc.id > max_id)
-            max_id = doc.id;
+    for (size_t s = 0; s < snapshot->segments.size(); s++)
+        for (const auto &doc : snapshot->segments[s]->collection)
+            if (doc.id > max_id && !snapshot->deleted[s].contains(doc.id))
+                max_id = doc.id;
     return max_id;
 }
@@ -1,10 +1,24 @@
 #pragma once
 
 #include <chrono>
+#include <memory>
+#include <mutex>
+#include <thread>
 #include <unordered_map>
 #include <unordered_set>
 #include "nlohmann/json.hpp"
 #include "TF_IDF.h"
+#include "IndexSegment.h"
+#include "PositionList.h"
+#include "DocBitmap.h"
+#include "QueryPlanner.h"
+#include "Vocabulary.h"
+#include "BinaryIO.h"
+#include "ScoreAccumulator.h"
+#include "TopKHeap.h"
+#include "MaxScore.h"
+#include "QueryDeadline.h"
+#include "DiskIndex.h"
 #include "Preprocessor.h"
 #include "PyHandler.h"
 #include "Const.h"
@@ -20,41 +34,287 @@ enum class FieldType {
     ALL
 };
 
+/**
+ * Searchable state of the in-memory index
+ * Published snapshots are immutable, writers change a copy and publish it as a whole (RCU-style),
+ * so queries running on other threads never see a half-done change
+ */
+struct index_snapshot {
+    /** Segments of the index, the oldest first (only the newest one can be open) */
+    std::vector<std::shared_ptr<const index_segment>> segments;
+    /** Deleted documents of the segments (same order as the segments) */
+    std::vector<DocBitmap> deleted;
+    /** IDs of all the live documents (universe of NOT) */
+    DocBitmap live_docs;
+    /** Dictionary of the keywords (file based) */
+    Vocabulary vocabulary;
+    /** Keywords (term IDs, file based) */
+    std::unordered_set<uint32_t> keywords;
+};
+
+/**
+ * Head of the index shared by the copies of the indexer
+ * Writers and the background merge publish new snapshots under the same lock
+ */
+struct index_head {
+    /** Published searchable state */
+    std::shared_ptr<const index_snapshot> snapshot = std::make_shared<const index_snapshot>();
+    /** Opened file based index (replaced as a whole by a rebuild, readers keep the old files until they drop it) */
+    std::shared_ptr<DiskIndex> disk_index;
+    /** Serializes the writers and the merges */
+    std::mutex write_mutex;
+    /** Thread of the background merge */
+    std::thread merge_thread;
+    /** Whether the background merge is running (guarded by the write mutex) */
+    bool merging = false;
+    /** Number of documents added, updated or removed since the segments were last compacted (guarded by the write mutex) */
+    int changes_since_reweight = 0;
+
+    /**
+     * Destructor - waits for the background merge (the merge drops its work once the head is gone)
+     */
+    ~index_head();
+};
+
 /**
  * Class for indexing the documents
  */
 class Indexer {
 private:
-    /** Collection of documents */
-    std::vector<TokenizedDocument> collection;
-    /** Keywords */
-    std::unordered_set<std::string> keywords;
-    /** Main index */
-    std::map<std::string, map_element> index;
-    /** Title index */
-    std::map<std::string, map_element> title_index;
-    /** Document norms (cosine similarity) */
-    std::map<int, float> norms;
-    /** Title norms (cosine similarity) */
-    std::map<int, float> title_norms;
-    /** Map of word -> (doc_id, positions) */
-    std::map<std::string, std::map<int, std::vector<int>>> positions_map;
+    /** Published searchable state and the writer lock (shared by the copies of the indexer) */
+    std::shared_ptr<index_head> head;
+    /** Working copy of the writer (copy of the published snapshot, published when the change is done) */
+    std::shared_ptr<index_snapshot> state;
     /** Path to the directory with the index (if file based) */
     std::string index_path_dir;
+    /** Weight of the title matches when searching in all fields */
+    static constexpr float title_weight = 1.5f;
+    /** Fraction of the collection that can change before the segments are compacted and IDF is recalculated */
+    static constexpr float reweight_threshold = 0.1f;
 
     /**
-     * Index the given collection of documents
+     * Start a change - lock out the other writers and copy the published snapshot into the working copy
+     * @return Lock of the writers (the change has to be published before it is released)
+     */
+    std::unique_lock<std::mutex> begin_write();
+    /**
+     * Publish the working copy as the new snapshot (readers that already loaded the old one keep using it)
      */
-    void index_everything();
+    void publish();
+    /**
+     * Get the opened file based index (the reindexing writer replaces it as a whole)
+     * @return File based index (nullptr if not opened)
+     */
+    [[nodiscard]] std::shared_ptr<DiskIndex> get_disk_index() const;
+    /**
+     * Recollect the keywords of the working copy from the tokenized documents (file based)
+     */
+    void update_keywords();
+    /**
+     * Count the words with any postings
+     * @param index Index
+     * @return Number of the words
+     */
+    static size_t count_words(const std::vector<map_element> &index);
+    /**
+     * Index the documents of the given segment
+     * @param segment Segment with the documents
+     */
+    static void index_everything(index_segment &segment);
+    /**
+     * Drop the segments without live documents and rebuild the set of all document IDs
+     */
+    void update_live_docs();
+    /**
+     * Mark the live version of the document as deleted
+     * @param doc_id Document ID
+     * @return True if the document was found
+     */
+    bool delete_doc(int doc_id);
+    /**
+     * Add documents to the open segment (a new one is started if the newest segment is sealed)
+     * The open segment is rebuilt and weighted by the statistics of the whole index, it is sealed once it is full
+     * @param docs Documents
+     * @param tokenized_docs Tokenized documents
+     * @param positions_map Positions of the documents (moved from)
+     */
+    void add_to_buffer(const std::vector<Document> &docs, const std::vector<TokenizedDocument> &tokenized_docs, std::map<std::string, std::map<int, std::vector<int>>> &positions_map);
+    /**
+     * Merge all the segments of the working copy into one weighted by the whole collection (the write lock has to be held)
+     */
+    void merge_all();
+    /**
+     * Count the changes and compact the segments if too many documents changed (the write lock has to be held)
+     * @param changes Number of added, updated or removed documents
+     */
+    void count_changes(int changes);
+    /**
+     * Start the background merge if the merge policy picks any segments (the write lock has to be held)
+     */
+    void schedule_merge();
+    /**
+     * Merge the segments picked by the merge policy until there is nothing to merge (background thread)
+     * The merged segment replaces its sources only if none of them was dropped meanwhile, documents deleted
+     * during the merge are carried over to it
+     * @param weak_head Head of the index (the merge stops when the indexer is gone)
+     */
+    static void merge_segments(const std::weak_ptr<index_head> &weak_head);
+    /**
+     * Merge all the segments of the snapshot into a single weighted segment (the only segment is used as is if it is up to date)
+     * @param snapshot Snapshot
+     * @return Segment
+     */
+    static std::shared_ptr<const index_segment> flatten(const index_snapshot &snapshot);
+    /**
+     * Detect languages of the given documents and store them in the documents and the collection of the segment
+     * @param segment Segment
+     * @param docs Documents (already in the document cache and the collection of the segment)
+     */
+    static void detect_langs(index_segment &segment, const std::vector<Document> &docs);
+    /**
+     * Merge positions of new documents into the positions map
+     * @param positions_map Map of word -> (doc_id, positions)
+     * @param new_positions Positions of the new documents (moved from)
+     */
+    static void merge_positions(std::map<std::string, std::map<int, std::vector<int>>> &positions_map, std::map<std::string, std::map<int, std::vector<int>>> &new_positions);
+    /**
+     * Remove positions of the given documents from the positions map (words left without documents are removed)
+     * @param positions_map Map of word -> (doc_id, positions)
+     * @param doc_ids IDs of the removed documents
+     */
+    static void purge_positions(std::map<std::string, std::map<int, std::vector<int>>> &positions_map, const std::unordered_set<int> &doc_ids);
     /**
      * Index the given collection of documents (file based)
+     * Files are built in a staging directory and renamed into place, the new index is then published in the head
      */
     void index_everything_file_based();
+    /**
+     * Create cursors over the posting lists of the query words for MaxScore
+     * @param tf_idf_query Term ID and TF-IDF of the query words
+     * @param norm_query Norm of the query
+     * @param field Field to search in
+     * @param index Main index
+     * @param title_index Title index
+     * @param norms Document norms
+     * @param title_norms Title norms
+     * @param impacts Quantized impacts of the main index (nullptr to score by the postings and norms)
+     * @param title_impacts Quantized impacts of the title index (nullptr to score by the postings and norms)
+     * @return Cursors (one per query word and field)
+     */
+    [[nodiscard]] static std::vector<posting_cursor> create_cursors(const std::vector<std::pair<uint32_t, float>> &tf_idf_query, float norm_query, FieldType field, const std::vector<map_element> &index, const std::vector<map_element> &title_index, const std::map<int, float> &norms, const std::map<int, float> &title_norms, const ImpactIndex *impacts = nullptr, const ImpactIndex *title_impacts = nullptr);
+    /**
+     * Add the proximity score of two words in one document, both position lists are walked through once
+     * (positions of the second word within the distance form a window that only moves forward)
+     * @param pos1 Positions of the first word (sorted)
+     * @param pos2 Positions of the second word (sorted)
+     * @param proximity Maximum distance of the words
+     * @param score Proximity score, 1 / (1 + distance) is added for every pair of positions within the distance
+     * @return True if any pair of positions is within the distance
+     */
+    static bool match_proximity(const std::vector<int> &pos1, const std::vector<int> &pos2, int proximity, float &score);
+    /**
+     * Add the score of the phrase occurrences in one document - every start position of the first word is followed by
+     * the other words in the query order, each of them at most proximity after the previous one
+     * @param positions Positions of the words in the query order (sorted)
+     * @param proximity Maximum distance of two following words (1 = the words are next to each other)
+     * @param score Phrase score, 1 / (1 + distance) of every two following words is added for every occurrence
+     * @return True if the whole phrase occurs in the document
+     */
+    static bool match_phrase(const std::vector<std::vector<int>> &positions, int proximity, float &score);
+    /**
+     * Search for the given query in the given indices (VECTOR MODEL)
+     * Shared by the in-memory and the file based search, the indices only have to contain the query words
+     * @param query Query tokens
+     * @param k Top k results
+     * @param field Field to search in
+     * @param proximity Proximity search (if 0, no proximity search)
+     * @param phrase Whether the whole query has to occur as a phrase (proximity is the distance of the following words)
+     * @param vocabulary Dictionary of the term IDs used by the indices and positions
+     * @param index Main index
+     * @param title_index Title index
+     * @param norms Document norms
+     * @param title_norms Title norms
+     * @param positions Term ID -> compact positions
+     * @param impacts Quantized impacts of the main index (nullptr to score by the postings and norms)
+     * @param title_impacts Quantized impacts of the title index (nullptr to score by the postings and norms)
+     * @param query_idf IDF of the query words in the whole index (nullptr to take the IDF of the given index), the
+     * documents keep the IDF of the given index
+     * @return IDs of the top k documents and their scores and positions
+     */
+    [[nodiscard]] static std::tuple<std::vector<int>, std::vector<float>, std::map<std::string, std::map<int, std::vector<int>>>> search_vector(const std::vector<std::string> &query, int k, FieldType field, int proximity, bool phrase, const Vocabulary &vocabulary, const std::vector<map_element> &index, const std::vector<map_element> &title_index, const std::map<int, float> &norms, const std::map<int, float> &title_norms, const std::vector<PositionList> &positions, const ImpactIndex *impacts = nullptr, const ImpactIndex *title_impacts = nullptr, const std::map<std::string, float> *query_idf = nullptr);
+    /**
+     * Evaluate the given boolean query in the given indices (BOOLEAN MODEL), operands are ordered and skipped by the QueryPlanner
+     * @param query_tokens Query tokens in postfix notation
+     * @param field Field to search in
+     * @param vocabulary Dictionary of the term IDs used by the indices
+     * @param index Main index
+     * @param title_index Title index
+     * @param all_docs IDs of all the documents (only needed for NOT)
+     * @param query_words Words of the query found in the indices
+     * @return IDs of the documents that satisfy the query in ascending order
+     */
+    static std::vector<int> search_boolean(const std::vector<std::string> &query_tokens, FieldType field, const Vocabulary &vocabulary, const std::vector<map_element> &index, const std::vector<map_element> &title_index, const DocBitmap &all_docs, std::vector<std::string> &query_words);
+    /**
+     * Read the postings of the words of the query dictionary from the file based index
+     * @param disk_index File based index
+     * @param query_vocabulary Dictionary of the query words
+     * @param title Whether to read from the title index
+     * @return Index of the query words (indexed by their term IDs)
+     */
+    [[nodiscard]] static std::vector<map_element> load_query_index(DiskIndex &disk_index, const Vocabulary &query_vocabulary, bool title = false);
+    /**
+     * Read the positions of the given words from the file based index
+     * @param disk_index File based index
+     * @param query_vocabulary Dictionary of the query words
+     * @param words Words to read (have to be in the query dictionary)
+     * @return Term ID -> compact positions
+     */
+    [[nodiscard]] static std::vector<PositionList> load_query_positions(DiskIndex &disk_index, const Vocabulary &query_vocabulary, const std::vector<std::string> &words);
+    /**
+     * Get positions of the given words in the given documents
+     * @param words Words
+     * @param vocabulary Dictionary of the term IDs used by the positions
+     * @param positions Term ID -> compact positions
+     * @param doc_ids IDs of the documents to keep
+     * @return Map of word -> (doc_id, positions), only the words with any positions are included
+     */
+    static std::map<std::string, std::map<int, std::vector<int>>> get_positions(const std::vector<std::string> &words, const Vocabulary &vocabulary, const std::vector<PositionList> &positions, const std::vector<int> &doc_ids);
+    /**
+     * Write an index to the binary format
+     * Sorted words, every word with its IDF, upper bound and compressed posting list
+     * @param writer Binary writer
+     * @param index Index to write
+     * @param vocabulary Dictionary of the term IDs used by the index
+     */
+    static void index_to_binary(BinaryWriter &writer, const std::vector<map_element> &index, const Vocabulary &vocabulary);
+    /**
+     * Read an index from the binary format
+     * @param reader Binary reader
+     * @param vocabulary Dictionary of the term IDs (new words are added)
+     * @return Index
+     */
+    static std::vector<map_element> index_from_binary(BinaryReader &reader, Vocabulary &vocabulary);
+    /**
+     * Get term IDs of the non empty entries of the index ordered by their words
+     * @param index Index
+     * @param vocabulary Dictionary of the term IDs used by the index
+     * @return Term IDs
+     */
+    static std::vector<uint32_t> sorted_terms(const std::vector<map_element> &index, const Vocabulary &vocabulary);
+    /**
+     * Write norms to the binary format (document IDs array followed by norms array)
+     * @param writer Binary writer
+     * @param norms Norms to write
+     */
+    static void norms_to_binary(BinaryWriter &writer, const std::map<int, float> &norms);
+    /**
+     * Read norms from the binary format
+     * @param reader Binary reader
+     * @return Norms
+     */
+    static std::map<int, float> norms_from_binary(BinaryReader &reader);
 
 public:
-    /** Document cache */
-    std::unordered_map<int, Document> doc_cache;
-
     /**
      * Constructor for the Indexer class
      */
@@ -62,7 +322,7 @@ public:
     /**
      * Constructor for file based Indexer
      * @param index_path_dir Path to the directory with the index
-     * @param reindex_immediately Whether to reindex immediately
+     * @param reindex_immediately Whether to reindex immediately (skipped if the manifest of the index is up to date)
      */
     Indexer(const std::string &index_path_dir, bool reindex_immediately = true);
     /**
@@ -73,13 +333,34 @@ public:
      */
     Indexer(const std::vector<Document> &original_collection, const std::vector<TokenizedDocument> &tokenized_collection, std::map<std::string, std::map<int, std::vector<int>>> &positions_map);
 
+    /**
+     * Point the file based indexer to the directory its files were moved to
+     * Renamed files stay the same files, so the opened index stays valid and is not reopened
+     * @param index_path_dir Path to the new directory with the index
+     */
+    void move_to(const std::string &index_path_dir);
+
+    /**
+     * Get the current snapshot of the searchable state
+     * Any number of threads can read it without locking, it stays valid even if the indexer is changed meanwhile
+     * @return Snapshot
+     */
+    [[nodiscard]] std::shared_ptr<const index_snapshot> get_snapshot() const;
+
     /**
      * Adds words from the collection to the keywords
      */
     void docs_to_keywords();
 
+    /**
+     * Merge all the segments into one and recalculate IDF, TF-IDF, norms and upper bounds of the whole collection
+     * Segments are weighted by the statistics of the time they were built, this brings them up to date
+     */
+    void compact();
+
     /**
      * Add documents to the collection
+     * Documents go to the open segment, the full index is built only for an empty indexer
      * @param docs Documents to add
      */
     void add_docs(const std::vector<Document> &docs, const std::vector<TokenizedDocument> &tokenized_docs, std::map<std::string, std::map<int, std::vector<int>>> &positions_map);
@@ -102,43 +383,27 @@ public:
      */
     std::vector<Document> get_docs(const std::vector<int> &doc_ids);
     /**
-     * Update documents with the given IDs
+     * Update documents with the given IDs (old versions are deleted and the new ones added to the open segment)
      * @param doc_ids Vector of document IDs
      * @param docs Vector of new documents
      */
     void update_docs(const std::vector<int> &doc_ids, const std::vector<Document> &docs, const std::vector<TokenizedDocument> &tokenized_docs, std::map<std::string, std::map<int, std::vector<int>>> &positions_map);
     /**
-     * Remove documents with the given IDs
+     * Remove documents with the given IDs (marked as deleted, dropped when their segments are merged)
      * @param doc_ids Vector of document IDs
      */
     void remove_docs(const std::vector<int> &doc_ids);
 
-    /**
-     * Calculate the cosine similarity between the given query and the document with the given ID
-     * @param query Query
-     * @param doc_id Document ID
-     * @param title Whether to use the title index
-     * @return Cosine similarity
-     */
-    [[nodiscard]] float cosine_similarity(const std::map<std::string, float> &query, int doc_id, bool title = false) const;
-    /**
-     * Calculate the cosine similarity between the given query and the document with the given ID (file based)
-     * @param query Query
-     * @param doc_id Document ID
-     * @param norms Norms of the documents
-     * @param index Index
-     * @return Cosine similarity
-     */
-    [[nodiscard]] float cosine_similarity_file_based(const map<std::string, float> &query, int doc_id, std::map<int, float> &norms, std::map<std::string, map_element> &index) const;
     /**
      * Search for the given query (VECTOR MODEL)
      * @param query Query tokens
      * @param k Top k results
      * @param field Field to search in
      * @param proximity Proximity search (if 0, no proximity search)
+     * @param phrase Whether the whole query has to occur as a phrase (proximity is the distance of the following words)
      * @return IDs of the top k documents and their scores and positions
      */
-    [[nodiscard]] std::tuple<std::vector<int>, std::vector<float>, std::map<std::string, std::map<int, std::vector<int>>>> search(const std::vector<std::string> &query, int k, FieldType field = FieldType::ALL, int proximity=0) const;
+    [[nodiscard]] std::tuple<std::vector<int>, std::vector<float>, std::map<std::string, std::map<int, std::vector<int>>>> search(const std::vector<std::string> &query, int k, FieldType field = FieldType::ALL, int proximity=0, bool phrase=false) const;
     /**
      * Search for the given query (BOOLEAN MODEL)
      * @param query_tokens Query tokens (EXPECTED postfix notation)
@@ -152,9 +417,10 @@ public:
      * @param k Top k results
      * @param field Field to search in
      * @param proximity Proximity search (if 0, no proximity search)
+     * @param phrase Whether the whole query has to occur as a phrase (proximity is the distance of the following words)
      * @return IDs of the top k documents and their scores and positions
      */
-    [[nodiscard]] std::tuple<std::vector<int>, std::vector<float>, std::map<std::string, std::map<int, std::vector<int>>>> search_file_based(const std::vector<std::string> &query, int k, FieldType field = FieldType::ALL, int proximity=0) const;
+    [[nodiscard]] std::tuple<std::vector<int>, std::vector<float>, std::map<std::string, std::map<int, std::vector<int>>>> search_file_based(const std::vector<std::string> &query, int k, FieldType field = FieldType::ALL, int proximity=0, bool phrase=false) const;
     /**
      * Search for the given query (BOOLEAN MODEL) (file based)
      * @param query_tokens Query tokens (EXPECTED postfix notation)
@@ -173,6 +439,16 @@ public:
      * @param j JSON representation of the indexer
      */
     void from_json(const json &j);
+    /**
+     * Indexer to the binary index format
+     * @param writer Binary writer
+     */
+    void to_binary(BinaryWriter &writer) const;
+    /**
+     * Load indexer from the binary index format
+     * @param reader Binary reader (usually over a memory mapped file)
+     */
+    void from_binary(BinaryReader &reader);
 
     /**
      * Get the size of the collection
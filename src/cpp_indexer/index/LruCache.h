@@ -0,0 +1,118 @@
+#pragma once
+
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+/**
+ * Least recently used cache bounded by the (approximate) size of the cached values in bytes
+ * Values are shared, so an evicted value stays valid for whoever still holds it
+ * Not thread safe on its own, the owner has to lock it
+ */
+template<typename Value>
+class LruCache {
+private:
+    /** Cached entry */
+    struct cache_entry {
+        /** Key of the entry */
+        std::string key;
+        /** Cached value */
+        std::shared_ptr<const Value> value;
+        /** Size of the value in bytes */
+        size_t bytes;
+    };
+
+    /** Maximum size of all cached values in bytes */
+    size_t capacity;
+    /** Current size of all cached values in bytes */
+    size_t used;
+    /** Entries from the most to the least recently used */
+    std::list<cache_entry> entries;
+    /** Key -> position in the entries */
+    std::unordered_map<std::string, typename std::list<cache_entry>::iterator> lookup;
+
+public:
+    /**
+     * Constructor for the LruCache class
+     * @param capacity Maximum size of all cached values in bytes
+     */
+    explicit LruCache(size_t capacity) : capacity(capacity), used(0), entries(), lookup() {
+        /* Nothing to do here :) */
+    }
+
+    /**
+     * Get the cached value and mark it as the most recently used
+     * @param key Key
+     * @return Cached value or nullptr if not cached
+     */
+    std::shared_ptr<const Value> get(const std::string &key) {
+        auto it = this->lookup.find(key);
+        if (it == this->lookup.end())
+            return nullptr;
+        this->entries.splice(this->entries.begin(), this->entries, it->second);
+        return it->second->value;
+    }
+
+    /**
+     * Cache the value, least recently used values are evicted to make space for it
+     * Values bigger than the whole cache are not cached at all
+     * @param key Key
+     * @param value Value
+     * @param bytes Size of the value in bytes
+     */
+    void put(const std::string &key, std::shared_ptr<const Value> value, size_t bytes) {
+        auto it = this->lookup.find(key);
+        if (it != this->lookup.end()) {
+            this->used -= it->second->bytes;
+            this->entries.erase(it->second);
+            this->lookup.erase(it);
+        }
+        if (bytes > this->capacity)
+            return;
+
+        while (this->used + bytes > this->capacity && !this->entries.empty()) {
+            this->used -= this->entries.back().bytes;
+            this->lookup.erase(this->entries.back().key);
+            this->entries.pop_back();
+        }
+        this->entries.push_front({key, std::move(value), bytes});
+        this->lookup[key] = this->entries.begin();
+        this->used += bytes;
+    }
+
+    /**
+     * Remove everything from the cache
+     */
+    void clear() {
+        this->entries.clear();
+        this->lookup.clear();
+        this->used = 0;
+    }
+
+    /**
+     * Call the function for every cached entry from the least to the most recently used
+     * @param function Function taking the key and the value
+     */
+    template<typename Function>
+    void for_each(Function function) const {
+        for (auto it = this->entries.rbegin(); it != this->entries.rend(); it++)
+            function(it->key, *it->value);
+    }
+
+    /**
+     * Get the number of cached entries
+     * @return Number of entries
+     */
+    [[nodiscard]] size_t count() const {
+        return this->entries.size();
+    }
+
+    /**
+     * Get the current size of all cached values
+     * @return Size in bytes
+     */
+    [[nodiscard]] size_t size() const {
+        return this->used;
+    }
+};
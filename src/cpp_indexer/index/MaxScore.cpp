@@ -0,0 +1,110 @@
+#include "MaxScore.h"
+#include "TF_IDF.h"
+#include "QueryDeadline.h"
+
+int posting_cursor::doc() const {
+    if (this->impacts)
+        return this->position < this->impacts->doc_ids.size() ? this->impacts->doc_ids[this->position] : PostingList::END;
+    return this->postings.doc();
+}
+
+size_t posting_cursor::size() const {
+    if (this->impacts)
+        return this->impacts->doc_ids.size();
+    return this->postings.list ? this->postings.list->size() : 0;
+}
+
+float posting_cursor::score() const {
+    if (this->impacts) {
+        const auto &list = *this->impacts;
+        return this->weight * static_cast<float>(list.impacts16.empty() ? list.impacts8[this->position] : list.impacts16[this->position]);
+    }
+    auto it = this->norms->find(this->postings.doc());
+    /* Zero norm would give NaN - some documents are just titles (ID 1492) */
+    if (it == this->norms->end() || it->second == 0)
+        return 0;
+    return this->weight * (TF_IDF::tf_weight(this->postings.tf()) * this->idf) / it->second;
+}
+
+void posting_cursor::next() {
+    if (this->impacts)
+        this->position++;
+    else
+        this->postings.next();
+}
+
+void posting_cursor::advance_to(int doc_id) {
+    if (this->impacts) {
+        const auto &doc_ids = this->impacts->doc_ids;
+        if (this->position < doc_ids.size() && doc_ids[this->position] < doc_id)
+            this->position = std::lower_bound(doc_ids.begin() + static_cast<long>(this->position), doc_ids.end(), doc_id) - doc_ids.begin();
+        return;
+    }
+    this->postings.advance_to(doc_id);
+}
+
+std::vector<std::pair<int, float>> MaxScore::top_k(std::vector<posting_cursor> cursors, int k) {
+    TopKHeap heap(k);
+    if (cursors.empty() || k <= 0)
+        return {};
+
+    /* Sort lists by their upper bounds, the cheapest lists become non-essential first */
+    std::sort(cursors.begin(), cursors.end(), [](const posting_cursor &a, const posting_cursor &b) {
+        return a.upper_bound < b.upper_bound;
+    });
+    /* Prefix sums of upper bounds */
+    std::vector<float> prefix_bounds(cursors.size());
+    float sum = 0;
+    for (size_t i = 0; i < cursors.size(); i++) {
+        sum += cursors[i].upper_bound;
+        prefix_bounds[i] = sum;
+    }
+
+    /* Lists [0, first_essential) are non-essential */
+    size_t first_essential = 0;
+    float threshold = 0;
+
+    int current = END;
+    for (const auto &cursor : cursors)
+        current = std::min(current, cursor.doc());
+
+    size_t candidates = 0;
+    while (first_essential < cursors.size() && current != END) {
+        if (++candidates % QueryDeadline::CHECK_INTERVAL == 0)
+            QueryDeadline::check();
+        float score = 0;
+        int next = END;
+
+        /* Score the document in the essential lists and find the next candidate */
+        for (size_t i = first_essential; i < cursors.size(); i++) {
+            auto &cursor = cursors[i];
+            if (cursor.doc() == current) {
+                score += cursor.score();
+                cursor.next();
+            }
+            next = std::min(next, cursor.doc());
+        }
+
+        /* Check the non-essential lists, from the most valuable, while the document still has a chance */
+        for (size_t i = first_essential; i-- > 0;) {
+            if (score + prefix_bounds[i] < threshold)
+                break;
+            auto &cursor = cursors[i];
+            cursor.advance_to(current);
+            if (cursor.doc() == current)
+                score += cursor.score();
+        }
+
+        /* Documents with score of 0 are not results */
+        if (score > 0 && heap.push(current, score) && heap.full()) {
+            threshold = heap.threshold();
+            /* Lists that together can not beat the threshold become non-essential */
+            while (first_essential < cursors.size() && prefix_bounds[first_essential] < threshold)
+                first_essential++;
+        }
+
+        current = next;
+    }
+
+    return heap.get_sorted();
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <vector>
+#include <map>
+#include <limits>
+#include "TopKHeap.h"
+#include "PostingList.h"
+#include "ImpactIndex.h"
+
+/**
+ * Cursor over one posting list (one query word in one field) used in MaxScore
+ * Scores come from the quantized impacts if the list has them, so MaxScore ranks the same as the term at a time path
+ */
+struct posting_cursor {
+    /** Iterator over the postings (document ID, term count) sorted by document ID */
+    posting_iterator postings;
+    /** IDF of the word (TF-IDF of a posting is its TF weight times IDF) */
+    float idf = 0;
+    /** Norms of the documents of the field the postings belong to */
+    const std::map<int, float> *norms = nullptr;
+    /** Weight of the list (query TF-IDF / query norm, times field weight, times the scale of the impacts if there are any) */
+    float weight = 0;
+    /** Upper bound of the score any document can get from this list */
+    float upper_bound = 0;
+    /** Quantized impacts of the postings (nullptr to score by the postings and norms) */
+    const impact_postings *impacts = nullptr;
+    /** Position in the impacts */
+    size_t position = 0;
+
+    /**
+     * Current document ID (INT_MAX when the cursor is exhausted)
+     * @return Document ID
+     */
+    [[nodiscard]] int doc() const;
+    /**
+     * Number of postings of the list
+     * @return Number of postings
+     */
+    [[nodiscard]] size_t size() const;
+    /**
+     * Score contribution of the current document
+     * @return Weighted TF-IDF / document norm (or weighted impact)
+     */
+    [[nodiscard]] float score() const;
+    /**
+     * Move to the next posting
+     */
+    void next();
+    /**
+     * Move to the first posting with document ID >= doc_id (skips whole blocks)
+     * @param doc_id Target document ID
+     */
+    void advance_to(int doc_id);
+};
+
+/**
+ * MaxScore (document at a time) top k retrieval
+ * Lists are split into essential and non-essential ones based on their upper bounds and the current
+ * top k threshold, documents that appear only in the non-essential lists can not get into the top k and
+ * are never scored
+ */
+class MaxScore {
+public:
+    /** Document ID of an exhausted cursor */
+    static constexpr int END = PostingList::END;
+
+    /**
+     * Find the top k documents
+     * @param cursors Cursors over the posting lists of the query
+     * @param k Number of results
+     * @return Top k results (document ID, score) sorted from the best to the worst
+     */
+    static std::vector<std::pair<int, float>> top_k(std::vector<posting_cursor> cursors, int k);
+};
@@ -0,0 +1,158 @@
+#include "PositionList.h"
+
+#include <algorithm>
+
+PositionList::PositionList() : doc_ids(), offsets(), data() {
+    /* Nothing to do here :) */
+}
+
+std::vector<uint8_t> PositionList::encode(const std::vector<int> &positions) {
+    std::vector<uint8_t> output;
+    VByte::write(output, static_cast<uint32_t>(positions.size()));
+    for (size_t i = 0; i < positions.size(); i++)
+        VByte::write(output, i == 0 ? static_cast<uint32_t>(positions[i]) : static_cast<uint32_t>(positions[i] - positions[i - 1]));
+    return output;
+}
+
+size_t PositionList::block_end(size_t i) const {
+    return i + 1 < this->offsets.size() ? this->offsets[i + 1] : this->data.size();
+}
+
+void PositionList::set(int doc_id, const std::vector<int> &positions) {
+    if (positions.empty()) {
+        this->erase({doc_id});
+        return;
+    }
+
+    /* New documents usually have the highest ID, their positions go right to the end of the buffer */
+    auto encoded = encode(positions);
+    if (this->doc_ids.empty() || this->doc_ids.back() < doc_id) {
+        this->doc_ids.emplace_back(doc_id);
+        this->offsets.emplace_back(static_cast<uint32_t>(this->data.size()));
+        this->data.insert(this->data.end(), encoded.begin(), encoded.end());
+        return;
+    }
+
+    /* Splice the block in place of the old one (or in between) and shift the offsets of the following documents */
+    auto i = this->find(doc_id);
+    size_t old_begin = i < this->offsets.size() ? this->offsets[i] : this->data.size();
+    size_t old_end = old_begin;
+    if (this->doc_ids[i] == doc_id) {
+        old_end = this->block_end(i);
+    } else {
+        this->doc_ids.insert(this->doc_ids.begin() + static_cast<long>(i), doc_id);
+        this->offsets.insert(this->offsets.begin() + static_cast<long>(i), static_cast<uint32_t>(old_begin));
+    }
+    auto shift = static_cast<int64_t>(encoded.size()) - static_cast<int64_t>(old_end - old_begin);
+    this->data.erase(this->data.begin() + static_cast<long>(old_begin), this->data.begin() + static_cast<long>(old_end));
+    this->data.insert(this->data.begin() + static_cast<long>(old_begin), encoded.begin(), encoded.end());
+    for (size_t j = i + 1; j < this->offsets.size(); j++)
+        this->offsets[j] = static_cast<uint32_t>(this->offsets[j] + shift);
+}
+
+bool PositionList::erase(const std::vector<int> &removed_ids) {
+    /* Most of the words do not contain any of the removed documents */
+    bool found = false;
+    for (size_t i = 0, j = 0; j < removed_ids.size() && !found; j++) {
+        i = this->find(removed_ids[j], i);
+        found = i < this->doc_ids.size() && this->doc_ids[i] == removed_ids[j];
+    }
+    if (!found)
+        return false;
+
+    std::vector<int> new_doc_ids;
+    std::vector<uint32_t> new_offsets;
+    std::vector<uint8_t> new_data;
+    for (size_t i = 0; i < this->doc_ids.size(); i++) {
+        if (std::binary_search(removed_ids.begin(), removed_ids.end(), this->doc_ids[i]))
+            continue;
+        new_doc_ids.emplace_back(this->doc_ids[i]);
+        new_offsets.emplace_back(static_cast<uint32_t>(new_data.size()));
+        new_data.insert(new_data.end(), this->data.begin() + this->offsets[i], this->data.begin() + static_cast<long>(this->block_end(i)));
+    }
+    this->doc_ids = std::move(new_doc_ids);
+    this->offsets = std::move(new_offsets);
+    this->data = std::move(new_data);
+    return true;
+}
+
+size_t PositionList::find(int doc_id, size_t from) const {
+    if (from >= this->doc_ids.size() || this->doc_ids[from] >= doc_id)
+        return from;
+
+    /* Double the step until the target is overshot, then binary search the last step */
+    size_t low = from;
+    size_t step = 1;
+    while (low + step < this->doc_ids.size() && this->doc_ids[low + step] < doc_id) {
+        low += step;
+        step *= 2;
+    }
+    auto high = std::min(low + step, this->doc_ids.size());
+    return std::lower_bound(this->doc_ids.begin() + static_cast<long>(low) + 1, this->doc_ids.begin() + static_cast<long>(high), doc_id) - this->doc_ids.begin();
+}
+
+void PositionList::decode(size_t i, std::vector<int> &positions) const {
+    const uint8_t *input = this->data.data() + this->offsets[i];
+    const uint8_t *end = this->data.data() + this->block_end(i);
+    auto count = VByte::read(input, end);
+    positions.resize(count);
+    uint32_t position = 0;
+    for (uint32_t j = 0; j < count; j++) {
+        position = j == 0 ? VByte::read(input, end) : position + VByte::read(input, end);
+        positions[j] = static_cast<int>(position);
+    }
+}
+
+std::vector<int> PositionList::get_positions(size_t i) const {
+    std::vector<int> positions;
+    this->decode(i, positions);
+    return positions;
+}
+
+size_t PositionList::size() const {
+    return this->doc_ids.size();
+}
+
+bool PositionList::empty() const {
+    return this->doc_ids.empty();
+}
+
+size_t PositionList::bytes() const {
+    return this->doc_ids.size() * (sizeof(int) + sizeof(uint32_t)) + this->data.size();
+}
+
+void PositionList::to_binary(BinaryWriter &writer) const {
+    writer.write(static_cast<uint32_t>(this->doc_ids.size()));
+    writer.write_array(this->doc_ids.data(), this->doc_ids.size());
+    writer.write_array(this->offsets.data(), this->offsets.size());
+    writer.write(static_cast<uint64_t>(this->data.size()));
+    writer.write_array(this->data.data(), this->data.size());
+}
+
+void PositionList::from_binary(BinaryReader &reader) {
+    auto count = reader.read<uint32_t>();
+    if (count > reader.remaining() / (sizeof(int) + sizeof(uint32_t)))
+        throw std::runtime_error("[ERROR]: Corrupted position list!");
+    this->doc_ids.resize(count);
+    reader.read_array(this->doc_ids.data(), count);
+    this->offsets.resize(count);
+    reader.read_array(this->offsets.data(), count);
+    auto data_size = reader.read<uint64_t>();
+    if (data_size > reader.remaining())
+        throw std::runtime_error("[ERROR]: Corrupted position list!");
+    this->data.resize(data_size);
+    reader.read_array(this->data.data(), data_size);
+
+    /* Documents in order, every block has to decode exactly into its bytes */
+    for (size_t i = 0; i < count; i++) {
+        if ((i > 0 && this->doc_ids[i] <= this->doc_ids[i - 1]) || (i == 0 && this->offsets[i] != 0) || this->offsets[i] >= this->block_end(i))
+            throw std::runtime_error("[ERROR]: Corrupted position list!");
+        const uint8_t *input = this->data.data() + this->offsets[i];
+        const uint8_t *end = this->data.data() + this->block_end(i);
+        auto positions_count = VByte::read(input, end);
+        for (uint32_t j = 0; j < positions_count; j++)
+            VByte::read(input, end);
+        if (input != end)
+            throw std::runtime_error("[ERROR]: Corrupted position list!");
+    }
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include "BinaryIO.h"
+#include "VByte.h"
+
+/**
+ * Compact positions of one word - sorted document IDs, every document points to its block of positions
+ * Block of positions is the variable-byte coded number of positions followed by variable-byte coded gaps
+ * between them (the first position is absolute), all the blocks are in one buffer
+ */
+class PositionList {
+private:
+    /** Document IDs (sorted) */
+    std::vector<int> doc_ids;
+    /** Offset of the block of positions of every document */
+    std::vector<uint32_t> offsets;
+    /** Compressed blocks of positions */
+    std::vector<uint8_t> data;
+
+    /**
+     * Encode a block of positions
+     * @param positions Positions (sorted)
+     * @return Compressed block
+     */
+    static std::vector<uint8_t> encode(const std::vector<int> &positions);
+    /**
+     * Get the end of the block of positions of the given document
+     * @param i Index of the document
+     * @return Offset of the end of the block
+     */
+    [[nodiscard]] size_t block_end(size_t i) const;
+
+public:
+    /**
+     * Constructor for the PositionList class
+     */
+    PositionList();
+
+    /**
+     * Set positions of a document (appending is the fast path, empty positions remove the document)
+     * @param doc_id Document ID
+     * @param positions Positions (sorted)
+     */
+    void set(int doc_id, const std::vector<int> &positions);
+    /**
+     * Remove positions of the given documents (the buffer is rebuilt at most once)
+     * @param removed_ids Document IDs (sorted)
+     * @return True if any document was removed
+     */
+    bool erase(const std::vector<int> &removed_ids);
+
+    /**
+     * Find the first document with ID >= doc_id using galloping search (exponential steps, then binary search),
+     * so walking through the list in order with increasing targets costs the logarithm of the skipped distance
+     * @param doc_id Document ID
+     * @param from Index to start the search from
+     * @return Index of the document (size of the list if there is none)
+     */
+    [[nodiscard]] size_t find(int doc_id, size_t from = 0) const;
+    /**
+     * Get the document ID at the given index
+     * @param i Index of the document
+     * @return Document ID
+     */
+    [[nodiscard]] int get_doc_id(size_t i) const {
+        return this->doc_ids[i];
+    }
+    /**
+     * Decode positions of the document at the given index
+     * @param i Index of the document
+     * @param positions Decoded positions (replaced)
+     */
+    void decode(size_t i, std::vector<int> &positions) const;
+    /**
+     * Get positions of the document at the given index
+     * @param i Index of the document
+     * @return Positions
+     */
+    [[nodiscard]] std::vector<int> get_positions(size_t i) const;
+    /**
+     * Call the given function for every document present in both lists, the shorter list is walked through
+     * and the longer one is galloped in
+     * @param first First list
+     * @param second Second list
+     * @param function Function taking the document ID and its indices in the first and the second list
+     */
+    template<typename Function>
+    static void intersect(const PositionList &first, const PositionList &second, Function function) {
+        bool swapped = second.size() < first.size();
+        const auto &shorter = swapped ? second : first;
+        const auto &longer = swapped ? first : second;
+        size_t j = 0;
+        for (size_t i = 0; i < shorter.size() && j < longer.size(); i++) {
+            j = longer.find(shorter.doc_ids[i], j);
+            if (j < longer.size() && longer.doc_ids[j] == shorter.doc_ids[i])
+                swapped ? function(shorter.doc_ids[i], j, i) : function(shorter.doc_ids[i], i, j);
+        }
+    }
+    /**
+     * Get the number of documents
+     * @return Number of documents
+     */
+    [[nodiscard]] size_t size() const;
+    /**
+     * Whether the list has no documents
+     * @return True if empty
+     */
+    [[nodiscard]] bool empty() const;
+    /**
+     * Get the memory used by the list
+     * @return Size in bytes
+     */
+    [[nodiscard]] size_t bytes() const;
+
+    /**
+     * Position list to the binary format (document IDs, offsets, compressed blocks)
+     * @param writer Binary writer
+     */
+    void to_binary(BinaryWriter &writer) const;
+    /**
+     * Load position list from the binary format (every block is checked)
+     * @param reader Binary reader
+     */
+    void from_binary(BinaryReader &reader);
+};
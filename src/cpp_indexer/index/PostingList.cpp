@@ -0,0 +1,216 @@
+#include "PostingList.h"
+
+#include <algorithm>
+
+PostingList::PostingList() : blocks(), data(), count(0) {
+    /* Nothing to do here :) */
+}
+
+std::vector<uint8_t> PostingList::encode_block(const std::vector<int> &docs, const std::vector<uint32_t> &tfs, size_t begin, size_t end) {
+    std::vector<uint8_t> output;
+    for (size_t i = begin; i < end; i++) {
+        /* Unsigned arithmetic, so even negative IDs survive the round trip */
+        VByte::write(output, i == begin ? static_cast<uint32_t>(docs[i]) : static_cast<uint32_t>(docs[i]) - static_cast<uint32_t>(docs[i - 1]));
+        VByte::write(output, tfs[i]);
+    }
+    return output;
+}
+
+size_t PostingList::block_end(size_t block) const {
+    return block + 1 < this->blocks.size() ? this->blocks[block + 1].offset : this->data.size();
+}
+
+void PostingList::replace_block(size_t block, const std::vector<int> &docs, const std::vector<uint32_t> &tfs) {
+    /* Full blocks are split evenly, so the next inserts into them do not split them again right away */
+    size_t parts = (docs.size() + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    std::vector<uint8_t> encoded;
+    std::vector<posting_block> new_blocks;
+    auto offset = this->blocks[block].offset;
+    for (size_t i = 0; i < parts; i++) {
+        size_t begin = docs.size() * i / parts;
+        size_t end = docs.size() * (i + 1) / parts;
+        auto part = encode_block(docs, tfs, begin, end);
+        new_blocks.push_back({docs[end - 1], static_cast<uint32_t>(offset + encoded.size()), static_cast<uint32_t>(end - begin)});
+        encoded.insert(encoded.end(), part.begin(), part.end());
+    }
+
+    /* Splice the new bytes in place of the old block and shift the offsets of the following blocks */
+    auto old_begin = this->blocks[block].offset;
+    auto old_end = this->block_end(block);
+    auto shift = static_cast<int64_t>(encoded.size()) - static_cast<int64_t>(old_end - old_begin);
+    this->count = this->count - this->blocks[block].count + docs.size();
+    this->data.erase(this->data.begin() + old_begin, this->data.begin() + static_cast<long>(old_end));
+    this->data.insert(this->data.begin() + old_begin, encoded.begin(), encoded.end());
+    for (size_t i = block + 1; i < this->blocks.size(); i++)
+        this->blocks[i].offset = static_cast<uint32_t>(this->blocks[i].offset + shift);
+    this->blocks.erase(this->blocks.begin() + static_cast<long>(block));
+    this->blocks.insert(this->blocks.begin() + static_cast<long>(block), new_blocks.begin(), new_blocks.end());
+}
+
+void PostingList::push_back(int doc_id, uint32_t tf) {
+    if (!this->blocks.empty() && this->blocks.back().last_doc >= doc_id) {
+        this->insert(doc_id, tf);
+        return;
+    }
+
+    /* Last block is at the end of the data, so appending to it is just writing the gap and the count */
+    if (this->blocks.empty() || this->blocks.back().count >= BLOCK_SIZE) {
+        this->blocks.push_back({doc_id, static_cast<uint32_t>(this->data.size()), 1});
+        VByte::write(this->data, static_cast<uint32_t>(doc_id));
+    } else {
+        auto &last = this->blocks.back();
+        VByte::write(this->data, static_cast<uint32_t>(doc_id) - static_cast<uint32_t>(last.last_doc));
+        last.last_doc = doc_id;
+        last.count++;
+    }
+    VByte::write(this->data, tf);
+    this->count++;
+}
+
+void PostingList::insert(int doc_id, uint32_t tf) {
+    /* New documents usually have the highest ID */
+    if (this->blocks.empty() || this->blocks.back().last_doc < doc_id) {
+        this->push_back(doc_id, tf);
+        return;
+    }
+
+    auto block = this->find_block(doc_id);
+    std::vector<int> docs(BLOCK_SIZE);
+    std::vector<uint32_t> tfs(BLOCK_SIZE);
+    docs.resize(this->decode_block(block, docs.data(), tfs.data()));
+    tfs.resize(docs.size());
+    auto it = std::lower_bound(docs.begin(), docs.end(), doc_id);
+    auto i = it - docs.begin();
+    if (it != docs.end() && *it == doc_id) {
+        tfs[i] = tf;
+    } else {
+        docs.insert(it, doc_id);
+        tfs.insert(tfs.begin() + i, tf);
+    }
+    this->replace_block(block, docs, tfs);
+}
+
+bool PostingList::erase(int doc_id) {
+    auto block = this->find_block(doc_id);
+    if (block >= this->blocks.size())
+        return false;
+
+    std::vector<int> docs(BLOCK_SIZE);
+    std::vector<uint32_t> tfs(BLOCK_SIZE);
+    docs.resize(this->decode_block(block, docs.data(), tfs.data()));
+    tfs.resize(docs.size());
+    auto it = std::lower_bound(docs.begin(), docs.end(), doc_id);
+    if (it == docs.end() || *it != doc_id)
+        return false;
+    tfs.erase(tfs.begin() + (it - docs.begin()));
+    docs.erase(it);
+    this->replace_block(block, docs, tfs);
+    return true;
+}
+
+size_t PostingList::decode_block(size_t block, int *docs, uint32_t *tfs) const {
+    const auto &entry = this->blocks[block];
+    const uint8_t *input = this->data.data() + entry.offset;
+    const uint8_t *end = this->data.data() + this->block_end(block);
+    uint32_t doc = 0;
+    for (uint32_t i = 0; i < entry.count; i++) {
+        doc = i == 0 ? VByte::read(input, end) : doc + VByte::read(input, end);
+        docs[i] = static_cast<int>(doc);
+        tfs[i] = VByte::read(input, end);
+    }
+    return entry.count;
+}
+
+size_t PostingList::find_block(int doc_id, size_t from) const {
+    auto it = std::lower_bound(this->blocks.begin() + static_cast<long>(std::min(from, this->blocks.size())), this->blocks.end(), doc_id,
+                               [](const posting_block &block, int id) { return block.last_doc < id; });
+    return it - this->blocks.begin();
+}
+
+std::vector<int> PostingList::get_doc_ids() const {
+    std::vector<int> doc_ids;
+    doc_ids.reserve(this->count);
+    this->for_each([&doc_ids](int doc_id, uint32_t) { doc_ids.emplace_back(doc_id); });
+    return doc_ids;
+}
+
+size_t PostingList::size() const {
+    return this->count;
+}
+
+bool PostingList::empty() const {
+    return this->count == 0;
+}
+
+size_t PostingList::get_blocks_count() const {
+    return this->blocks.size();
+}
+
+size_t PostingList::bytes() const {
+    return this->blocks.size() * sizeof(posting_block) + this->data.size();
+}
+
+void PostingList::to_binary(BinaryWriter &writer) const {
+    writer.write(static_cast<uint32_t>(this->blocks.size()));
+    writer.write_array(this->blocks.data(), this->blocks.size());
+    writer.write(static_cast<uint64_t>(this->data.size()));
+    writer.write_array(this->data.data(), this->data.size());
+}
+
+void PostingList::from_binary(BinaryReader &reader) {
+    auto blocks_count = reader.read<uint32_t>();
+    if (blocks_count > reader.remaining() / sizeof(posting_block))
+        throw std::runtime_error("[ERROR]: Corrupted posting list!");
+    this->blocks.resize(blocks_count);
+    reader.read_array(this->blocks.data(), blocks_count);
+    auto data_size = reader.read<uint64_t>();
+    if (data_size > reader.remaining())
+        throw std::runtime_error("[ERROR]: Corrupted posting list!");
+    this->data.resize(data_size);
+    reader.read_array(this->data.data(), data_size);
+
+    /* Every block has to decode into exactly its postings, in order and ending with its last ID */
+    this->count = 0;
+    std::array<int, BLOCK_SIZE> docs{};
+    std::array<uint32_t, BLOCK_SIZE> tfs{};
+    for (size_t block = 0; block < this->blocks.size(); block++) {
+        const auto &entry = this->blocks[block];
+        if (entry.count == 0 || entry.count > BLOCK_SIZE || entry.offset > this->block_end(block) || (block == 0 && entry.offset != 0))
+            throw std::runtime_error("[ERROR]: Corrupted posting list!");
+        this->decode_block(block, docs.data(), tfs.data());
+        for (uint32_t i = 1; i < entry.count; i++)
+            if (docs[i] <= docs[i - 1])
+                throw std::runtime_error("[ERROR]: Corrupted posting list!");
+        if (docs[entry.count - 1] != entry.last_doc || (block > 0 && docs[0] <= this->blocks[block - 1].last_doc))
+            throw std::runtime_error("[ERROR]: Corrupted posting list!");
+        this->count += entry.count;
+    }
+}
+
+posting_iterator::posting_iterator(const PostingList *list) : list(list) {
+    this->load(0);
+}
+
+void posting_iterator::load(size_t block_) {
+    this->block = block_;
+    this->pos = 0;
+    this->count = this->list && block_ < this->list->get_blocks_count() ? this->list->decode_block(block_, this->docs.data(), this->tfs.data()) : 0;
+}
+
+void posting_iterator::next() {
+    if (++this->pos >= this->count && this->count > 0)
+        this->load(this->block + 1);
+}
+
+void posting_iterator::advance_to(int doc_id) {
+    if (this->doc() >= doc_id)
+        return;
+
+    /* Whole blocks that end before the target are skipped without decoding */
+    if (this->docs[this->count - 1] < doc_id) {
+        this->load(this->list->find_block(doc_id, this->block + 1));
+        if (this->count == 0)
+            return;
+    }
+    this->pos = std::lower_bound(this->docs.begin() + static_cast<long>(this->pos), this->docs.begin() + static_cast<long>(this->count), doc_id) - this->docs.begin();
+}
@@ -0,0 +1,216 @@
+#pragma once
+
+#include <vector>
+#include <array>
+#include <limits>
+#include <cstdint>
+#include "BinaryIO.h"
+#include "VByte.h"
+
+/**
+ * Entry of the skip table of a posting list (one per block)
+ */
+struct posting_block {
+    /** Last document ID in the block */
+    int32_t last_doc;
+    /** Offset of the block in the compressed data */
+    uint32_t offset;
+    /** Number of postings in the block */
+    uint32_t count;
+};
+
+/**
+ * Compressed posting list (document ID, term count) sorted by document ID
+ * Postings are split into blocks of at most BLOCK_SIZE postings, every posting of a block is a variable-byte
+ * coded document ID gap followed by a variable-byte coded term count (the first ID of a block is absolute,
+ * so blocks can be decoded on their own and appending goes right to the end of the data). Skip table with
+ * the last document ID of every block allows jumping over whole blocks without decoding them
+ */
+class PostingList {
+private:
+    /** Skip table */
+    std::vector<posting_block> blocks;
+    /** Compressed blocks */
+    std::vector<uint8_t> data;
+    /** Number of postings */
+    size_t count;
+
+    /**
+     * Encode a block of postings
+     * @param docs Document IDs (sorted)
+     * @param tfs Term counts
+     * @param begin First posting of the block
+     * @param end End of the block
+     * @return Compressed block
+     */
+    static std::vector<uint8_t> encode_block(const std::vector<int> &docs, const std::vector<uint32_t> &tfs, size_t begin, size_t end);
+    /**
+     * Get the end of the given block in the compressed data
+     * @param block Block
+     * @return Offset of the end of the block
+     */
+    [[nodiscard]] size_t block_end(size_t block) const;
+    /**
+     * Replace the given block by the given postings (split into more blocks if there are too many of them,
+     * removed if there are none)
+     * @param block Block
+     * @param docs Document IDs (sorted)
+     * @param tfs Term counts
+     */
+    void replace_block(size_t block, const std::vector<int> &docs, const std::vector<uint32_t> &tfs);
+
+public:
+    /** Maximum number of postings in a block */
+    static constexpr size_t BLOCK_SIZE = 128;
+    /** Document ID of an exhausted list */
+    static constexpr int END = std::numeric_limits<int>::max();
+
+    /**
+     * Constructor for the PostingList class
+     */
+    PostingList();
+
+    /**
+     * Append a posting (document ID has to be higher than all the IDs in the list)
+     * @param doc_id Document ID
+     * @param tf Term count
+     */
+    void push_back(int doc_id, uint32_t tf);
+    /**
+     * Insert or replace a posting
+     * @param doc_id Document ID
+     * @param tf Term count
+     */
+    void insert(int doc_id, uint32_t tf);
+    /**
+     * Remove a posting
+     * @param doc_id Document ID
+     * @return True if the posting was found
+     */
+    bool erase(int doc_id);
+
+    /**
+     * Decode the given block
+     * @param block Block
+     * @param docs Decoded document IDs (at least BLOCK_SIZE of them)
+     * @param tfs Decoded term counts (at least BLOCK_SIZE of them)
+     * @return Number of decoded postings
+     */
+    size_t decode_block(size_t block, int *docs, uint32_t *tfs) const;
+    /**
+     * Find the first block that can contain the given document (last document ID >= doc_id)
+     * @param doc_id Document ID
+     * @param from First block to search from
+     * @return Block (number of blocks if there is none)
+     */
+    [[nodiscard]] size_t find_block(int doc_id, size_t from = 0) const;
+    /**
+     * Call the given function for every posting in the order of document IDs
+     * @param function Function taking the document ID and the term count
+     */
+    template<typename Function>
+    void for_each(Function function) const {
+        std::array<int, BLOCK_SIZE> docs{};
+        std::array<uint32_t, BLOCK_SIZE> tfs{};
+        for (size_t block = 0; block < this->blocks.size(); block++) {
+            auto block_count = this->decode_block(block, docs.data(), tfs.data());
+            for (size_t i = 0; i < block_count; i++)
+                function(docs[i], tfs[i]);
+        }
+    }
+    /**
+     * Get all the document IDs
+     * @return Document IDs in ascending order
+     */
+    [[nodiscard]] std::vector<int> get_doc_ids() const;
+    /**
+     * Get the number of postings
+     * @return Number of postings
+     */
+    [[nodiscard]] size_t size() const;
+    /**
+     * Whether the list has no postings
+     * @return True if empty
+     */
+    [[nodiscard]] bool empty() const;
+    /**
+     * Get the number of blocks
+     * @return Number of blocks
+     */
+    [[nodiscard]] size_t get_blocks_count() const;
+    /**
+     * Get the memory used by the list (skip table and compressed data)
+     * @return Size in bytes
+     */
+    [[nodiscard]] size_t bytes() const;
+
+    /**
+     * Posting list to the binary format (skip table followed by the compressed blocks)
+     * @param writer Binary writer
+     */
+    void to_binary(BinaryWriter &writer) const;
+    /**
+     * Load posting list from the binary format (every block is checked)
+     * @param reader Binary reader
+     */
+    void from_binary(BinaryReader &reader);
+};
+
+/**
+ * Iterator over a posting list, decodes one block at a time
+ */
+struct posting_iterator {
+    /** Posting list */
+    const PostingList *list = nullptr;
+    /** Current block */
+    size_t block = 0;
+    /** Position in the decoded block */
+    size_t pos = 0;
+    /** Number of postings in the decoded block */
+    size_t count = 0;
+    /** Document IDs of the decoded block */
+    std::array<int, PostingList::BLOCK_SIZE> docs{};
+    /** Term counts of the decoded block */
+    std::array<uint32_t, PostingList::BLOCK_SIZE> tfs{};
+
+    /**
+     * Default constructor (exhausted iterator)
+     */
+    posting_iterator() = default;
+    /**
+     * Constructor, the iterator starts at the first posting
+     * @param list Posting list
+     */
+    explicit posting_iterator(const PostingList *list);
+
+    /**
+     * Current document ID (PostingList::END when the iterator is exhausted)
+     * @return Document ID
+     */
+    [[nodiscard]] int doc() const {
+        return this->pos < this->count ? this->docs[this->pos] : PostingList::END;
+    }
+    /**
+     * Term count of the current posting
+     * @return Term count
+     */
+    [[nodiscard]] uint32_t tf() const {
+        return this->tfs[this->pos];
+    }
+    /**
+     * Move to the next posting
+     */
+    void next();
+    /**
+     * Move to the first posting with document ID >= doc_id (blocks are skipped using the skip table)
+     * @param doc_id Target document ID
+     */
+    void advance_to(int doc_id);
+
+private:
+    /**
+     * Decode the given block and move to its first posting
+     * @param block_ Block
+     */
+    void load(size_t block_);
+};
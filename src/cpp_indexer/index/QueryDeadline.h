@@ -0,0 +1,65 @@
+#pragma once
+
+#include <chrono>
+#include <stdexcept>
+
+/**
+ * Exception thrown when the deadline of a query passes during the search
+ */
+class deadline_exceeded : public std::runtime_error {
+public:
+    /**
+     * Constructor for the deadline_exceeded class
+     */
+    deadline_exceeded() : std::runtime_error("Deadline exceeded") {}
+};
+
+/**
+ * Deadline of the query evaluated by the calling thread
+ * Search loops check it between query words, segments and blocks of documents and stop the query by throwing
+ * deadline_exceeded, threads without a deadline are never stopped
+ */
+class QueryDeadline {
+private:
+    /** Deadline of the calling thread (max = no deadline) */
+    static inline thread_local std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
+
+public:
+    /**
+     * Deadline set for the lifetime of the scope (the previous one is restored at its end)
+     */
+    class scope {
+    private:
+        /** Deadline before the scope */
+        std::chrono::steady_clock::time_point previous;
+
+    public:
+        /**
+         * Constructor for the scope class
+         * @param deadline Deadline of the queries evaluated in the scope
+         */
+        explicit scope(std::chrono::steady_clock::time_point deadline) : previous(QueryDeadline::deadline) {
+            QueryDeadline::deadline = deadline;
+        }
+        /**
+         * Destructor, restores the previous deadline
+         */
+        ~scope() {
+            QueryDeadline::deadline = this->previous;
+        }
+        scope(const scope &) = delete;
+        scope &operator=(const scope &) = delete;
+    };
+
+    /** Number of documents scored between two checks in the document at a time loops */
+    static constexpr size_t CHECK_INTERVAL = 4096;
+
+    /**
+     * Stop the query if its deadline has passed
+     * @throws deadline_exceeded If the deadline has passed
+     */
+    static void check() {
+        if (deadline != std::chrono::steady_clock::time_point::max() && std::chrono::steady_clock::now() > deadline)
+            throw deadline_exceeded();
+    }
+};
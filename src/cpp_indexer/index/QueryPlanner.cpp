@@ -0,0 +1,202 @@
+#include "QueryPlanner.h"
+#include "QueryDeadline.h"
+
+#include <algorithm>
+#include "Preprocessor.h"
+
+bool QueryPlanner::plan(const std::vector<std::string> &query_tokens, const std::function<const PostingList *(const std::string &)> &lookup, size_t universe, query_node &root) {
+    std::vector<query_node> stack;
+    for (const auto &token : query_tokens) {
+        query_node node;
+        if (token == operators_map[Operator::AND] || token == operators_map[Operator::OR]) {
+            if (stack.size() < 2)
+                return false;
+            node.type = token == operators_map[Operator::AND] ? NodeType::AND : NodeType::OR;
+            node.children.emplace_back(std::move(stack[stack.size() - 2]));
+            node.children.emplace_back(std::move(stack.back()));
+            stack.resize(stack.size() - 2);
+        } else if (token == operators_map[Operator::NOT]) {
+            if (stack.empty())
+                return false;
+            node.type = NodeType::NOT;
+            node.children.emplace_back(std::move(stack.back()));
+            stack.pop_back();
+        } else {
+            node.postings = lookup(token);
+        }
+        stack.emplace_back(std::move(node));
+    }
+    if (stack.size() != 1)
+        return false;
+
+    root = std::move(stack.back());
+    flatten(root);
+    estimate(root, universe);
+    return true;
+}
+
+void QueryPlanner::flatten(query_node &node) {
+    for (auto &child : node.children)
+        flatten(child);
+
+    /* NOT NOT a = a */
+    if (node.type == NodeType::NOT && node.children[0].type == NodeType::NOT) {
+        query_node inner = std::move(node.children[0].children[0]);
+        node = std::move(inner);
+        return;
+    }
+
+    /* (a AND b) AND c = AND(a, b, c), same for OR */
+    if (node.type == NodeType::AND || node.type == NodeType::OR) {
+        std::vector<query_node> children;
+        for (auto &child : node.children) {
+            if (child.type == node.type)
+                for (auto &grandchild : child.children)
+                    children.emplace_back(std::move(grandchild));
+            else
+                children.emplace_back(std::move(child));
+        }
+        node.children = std::move(children);
+    }
+}
+
+void QueryPlanner::estimate(query_node &node, size_t universe) {
+    for (auto &child : node.children)
+        estimate(child, universe);
+
+    switch (node.type) {
+        case NodeType::WORD:
+            node.cost = node.postings ? node.postings->size() : 0;
+            break;
+        case NodeType::NOT:
+            node.cost = universe - std::min(node.children[0].cost, universe);
+            break;
+        case NodeType::OR:
+            node.cost = 0;
+            for (const auto &child : node.children)
+                node.cost += child.cost;
+            node.cost = std::min(node.cost, universe);
+            break;
+        case NodeType::AND:
+            /* Rarest operands first, negated operands only narrow the result down, so they go last */
+            std::stable_sort(node.children.begin(), node.children.end(), [](const query_node &a, const query_node &b) {
+                bool a_negated = a.type == NodeType::NOT;
+                bool b_negated = b.type == NodeType::NOT;
+                if (a_negated != b_negated)
+                    return b_negated;
+                return a_negated ? a.children[0].cost > b.children[0].cost : a.cost < b.cost;
+            });
+            node.cost = universe;
+            for (const auto &child : node.children)
+                node.cost = std::min(node.cost, child.cost);
+            break;
+    }
+}
+
+DocBitmap QueryPlanner::probe(const DocBitmap &docs, const PostingList &postings, bool keep_found) {
+    DocBitmap result;
+    posting_iterator it(&postings);
+    for (const auto &doc_id : docs.to_vector()) {
+        it.advance_to(doc_id);
+        if ((it.doc() == doc_id) == keep_found)
+            result.push_back(doc_id);
+    }
+    return result;
+}
+
+std::pair<DocBitmap, bool> QueryPlanner::evaluate_and(const query_node &node) {
+    /* Result is either a set of documents (bounded) or, until the first positive operand, a set of excluded ones */
+    DocBitmap result;
+    DocBitmap excluded;
+    bool bounded = false;
+    for (const auto &child : node.children) {
+        /* Nothing left to narrow down, the rest of the operands is not evaluated at all */
+        if (bounded && result.empty())
+            break;
+
+        bool negate = child.type == NodeType::NOT;
+        const auto &operand = negate ? child.children[0] : child;
+
+        /* Few documents left - look them up in the posting list instead of reading the whole list */
+        if (bounded && operand.type == NodeType::WORD && operand.postings && result.size() < operand.postings->size()) {
+            result = probe(result, *operand.postings, !negate);
+            continue;
+        }
+
+        auto [docs, negated] = evaluate(operand);
+        negated = negated != negate;
+        if (negated && bounded) {
+            result.subtract(docs);
+        } else if (negated) {
+            excluded.unite(docs);
+        } else if (bounded) {
+            result.intersect(docs);
+        } else {
+            result = std::move(docs);
+            result.subtract(excluded);
+            bounded = true;
+        }
+    }
+
+    if (!bounded)
+        return {std::move(excluded), true};
+    return {std::move(result), false};
+}
+
+std::pair<DocBitmap, bool> QueryPlanner::evaluate_or(const query_node &node) {
+    /* a OR NOT b OR NOT c = NOT ((b AND c) - a) */
+    DocBitmap united;
+    DocBitmap common;
+    bool any_negated = false;
+    for (const auto &child : node.children) {
+        auto [docs, negated] = evaluate(child);
+        if (!negated) {
+            united.unite(docs);
+            continue;
+        }
+
+        if (any_negated)
+            common.intersect(docs);
+        else
+            common = std::move(docs);
+        any_negated = true;
+
+        /* Complement of nothing is everything, the rest of the operands can not add anything */
+        if (common.empty())
+            return {DocBitmap(), true};
+    }
+
+    if (!any_negated)
+        return {std::move(united), false};
+    common.subtract(united);
+    return {std::move(common), true};
+}
+
+std::pair<DocBitmap, bool> QueryPlanner::evaluate(const query_node &node) {
+    QueryDeadline::check();
+    switch (node.type) {
+        case NodeType::AND:
+            return evaluate_and(node);
+        case NodeType::OR:
+            return evaluate_or(node);
+        case NodeType::NOT: {
+            auto [docs, negated] = evaluate(node.children[0]);
+            return {std::move(docs), !negated};
+        }
+        default:
+            if (!node.postings)
+                return {DocBitmap(), false};
+            return {DocBitmap(node.postings->get_doc_ids()), false};
+    }
+}
+
+std::vector<int> QueryPlanner::execute(const query_node &root, const DocBitmap &all_docs) {
+    auto [docs, negated] = evaluate(root);
+    if (!negated)
+        return docs.to_vector();
+
+    /* Only the top level complement is ever created */
+    auto result = all_docs;
+    result.subtract(docs);
+    return result.to_vector();
+}
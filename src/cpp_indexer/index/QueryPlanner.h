@@ -0,0 +1,97 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <functional>
+#include "PostingList.h"
+#include "DocBitmap.h"
+
+/**
+ * Type of a node of the boolean query
+ */
+enum class NodeType {
+    WORD,
+    AND,
+    OR,
+    NOT
+};
+
+/**
+ * Node of the boolean query tree
+ */
+struct query_node {
+    /** Type of the node */
+    NodeType type = NodeType::WORD;
+    /** Posting list of the word (nullptr if the word is not in the index) */
+    const PostingList *postings = nullptr;
+    /** Operands (NOT has exactly one) */
+    std::vector<query_node> children{};
+    /** Estimated number of matching documents */
+    size_t cost = 0;
+};
+
+/**
+ * Planner and executor of boolean queries
+ * Postfix query is turned into a tree, nested AND / OR are flattened, AND operands are evaluated from the rarest one
+ * and NOT operands of AND are subtracted from the result, so evaluation stops as soon as the result is empty and
+ * frequent words are only probed for the few documents left instead of being read whole
+ */
+class QueryPlanner {
+private:
+    /**
+     * Merge nested operators of the same type into their parent and remove double negations
+     * @param node Node
+     */
+    static void flatten(query_node &node);
+    /**
+     * Estimate the number of matching documents of every node and order the AND operands by it
+     * (operands that are not negated go first, from the smallest)
+     * @param node Node
+     * @param universe Number of all the documents
+     */
+    static void estimate(query_node &node, size_t universe);
+    /**
+     * Keep only the documents found (or not found) in the posting list, the list is skipped through, not decoded whole
+     * @param docs Documents
+     * @param postings Posting list
+     * @param keep_found Whether to keep the found documents (the missing ones otherwise)
+     * @return Filtered documents
+     */
+    static DocBitmap probe(const DocBitmap &docs, const PostingList &postings, bool keep_found);
+    /**
+     * Evaluate the AND node
+     * @param node Node
+     * @return Documents and whether they are negated (the result is their complement)
+     */
+    static std::pair<DocBitmap, bool> evaluate_and(const query_node &node);
+    /**
+     * Evaluate the OR node
+     * @param node Node
+     * @return Documents and whether they are negated (the result is their complement)
+     */
+    static std::pair<DocBitmap, bool> evaluate_or(const query_node &node);
+    /**
+     * Evaluate the node, complements are not created (they are passed up as negated sets)
+     * @param node Node
+     * @return Documents and whether they are negated (the result is their complement)
+     */
+    static std::pair<DocBitmap, bool> evaluate(const query_node &node);
+
+public:
+    /**
+     * Create the plan of the boolean query
+     * @param query_tokens Query tokens in postfix notation
+     * @param lookup Function returning the posting list of the word (nullptr if the word is not in the index)
+     * @param universe Number of all the documents
+     * @param root Root of the plan
+     * @return False if the query is malformed
+     */
+    static bool plan(const std::vector<std::string> &query_tokens, const std::function<const PostingList *(const std::string &)> &lookup, size_t universe, query_node &root);
+    /**
+     * Execute the plan
+     * @param root Root of the plan
+     * @param all_docs IDs of all the documents (universe of NOT)
+     * @return IDs of the documents that satisfy the query in ascending order
+     */
+    static std::vector<int> execute(const query_node &root, const DocBitmap &all_docs);
+};
@@ -0,0 +1,103 @@
+#include "ScoreAccumulator.h"
+#include "QueryDeadline.h"
+
+ScoreAccumulator::ScoreAccumulator() : scores(), touched_flags(), touched() {
+    /* Nothing to do here :) */
+}
+
+void ScoreAccumulator::reset() {
+    /* Clear only what was touched, the rest is already zero */
+    for (const auto &doc_id : this->touched) {
+        this->scores[doc_id] = 0;
+        this->touched_flags[doc_id] = 0;
+    }
+    this->touched.clear();
+}
+
+void ScoreAccumulator::add(int doc_id, float value) {
+    /* Grow lazily, the dense arrays are reused between queries */
+    if (doc_id >= static_cast<int>(this->scores.size())) {
+        this->scores.resize(doc_id + 1, 0);
+        this->touched_flags.resize(doc_id + 1, 0);
+    }
+    if (!this->touched_flags[doc_id]) {
+        this->touched_flags[doc_id] = 1;
+        this->touched.emplace_back(doc_id);
+    }
+    this->scores[doc_id] += value;
+}
+
+void ScoreAccumulator::accumulate(const std::vector<std::pair<uint32_t, float>> &query, const std::vector<map_element> &index) {
+    /* Term at a time - every posting list is walked exactly once */
+    for (const auto &[term, value] : query) {
+        QueryDeadline::check();
+        if (term >= index.size())
+            continue;
+        const auto &element = index[term];
+        element.postings.for_each([&](int doc_id, uint32_t tf) { this->add(doc_id, value * (TF_IDF::tf_weight(tf) * element.idf)); });
+    }
+}
+
+void ScoreAccumulator::touch(const std::vector<int> &doc_ids) {
+    if (doc_ids.empty())
+        return;
+    if (doc_ids.back() >= static_cast<int>(this->scores.size())) {
+        this->scores.resize(doc_ids.back() + 1, 0);
+        this->touched_flags.resize(doc_ids.back() + 1, 0);
+    }
+    for (const auto &doc_id : doc_ids)
+        if (!this->touched_flags[doc_id]) {
+            this->touched_flags[doc_id] = 1;
+            this->touched.emplace_back(doc_id);
+        }
+}
+
+void ScoreAccumulator::accumulate(const std::vector<std::pair<uint32_t, float>> &query, const ImpactIndex &index, float query_norm) {
+    if (query_norm == 0)
+        return;
+    for (const auto &[term, value] : query) {
+        QueryDeadline::check();
+        const auto *list = index.get(term);
+        if (!list || value == 0)
+            continue;
+        /* Touched documents are remembered first, the kernel then only adds into the dense scores */
+        this->touch(list->doc_ids);
+        index.accumulate(*list, value / query_norm * list->scale, this->scores.data());
+    }
+}
+
+void ScoreAccumulator::normalize(const std::map<int, float> &norms, float query_norm) {
+    for (const auto &doc_id : this->touched) {
+        auto it = norms.find(doc_id);
+        float norm_doc = it == norms.end() ? 0 : it->second;
+        /* Zero norm would give NaN - some documents are just titles (ID 1492) */
+        if (norm_doc == 0 || query_norm == 0)
+            this->scores[doc_id] = 0;
+        else
+            this->scores[doc_id] = this->scores[doc_id] / (query_norm * norm_doc);
+    }
+}
+
+void ScoreAccumulator::merge(const ScoreAccumulator &other, float weight) {
+    for (const auto &doc_id : other.touched)
+        this->add(doc_id, weight * other.scores[doc_id]);
+}
+
+float ScoreAccumulator::get(int doc_id) const {
+    if (doc_id < 0 || doc_id >= static_cast<int>(this->scores.size()))
+        return 0;
+    return this->scores[doc_id];
+}
+
+std::vector<std::pair<int, float>> ScoreAccumulator::get_results() const {
+    std::vector<std::pair<int, float>> results;
+    results.reserve(this->touched.size());
+    for (const auto &doc_id : this->touched)
+        if (this->scores[doc_id] != 0)
+            results.emplace_back(doc_id, this->scores[doc_id]);
+    return results;
+}
+
+const std::vector<int> &ScoreAccumulator::get_touched() const {
+    return this->touched;
+}
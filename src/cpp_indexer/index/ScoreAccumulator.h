@@ -0,0 +1,91 @@
+#pragma once
+
+#include <vector>
+#include <map>
+#include <string>
+#include <cmath>
+#include "TF_IDF.h"
+#include "ImpactIndex.h"
+
+/**
+ * Dense score accumulator for term-at-a-time scoring (vector model)
+ * Scores are indexed directly by document ID, so adding a posting is O(1)
+ * Only documents touched by at least one posting are remembered, so resetting and reading
+ * the results scales with the posting lengths of the query terms, not with the collection size
+ */
+class ScoreAccumulator {
+private:
+    /** Accumulated scores, indexed by document ID */
+    std::vector<float> scores;
+    /** Flags whether the document was already touched, indexed by document ID */
+    std::vector<char> touched_flags;
+    /** IDs of the touched documents (in order of the first touch) */
+    std::vector<int> touched;
+
+    /**
+     * Remember the given documents as touched (the dense arrays are grown to cover them)
+     * @param doc_ids Document IDs (ascending)
+     */
+    void touch(const std::vector<int> &doc_ids);
+
+public:
+    /**
+     * Constructor for the ScoreAccumulator class
+     */
+    ScoreAccumulator();
+
+    /**
+     * Clear the scores of the touched documents, so the accumulator can be reused for another query
+     */
+    void reset();
+    /**
+     * Add the given value to the score of the given document
+     * @param doc_id Document ID
+     * @param value Value to add
+     */
+    void add(int doc_id, float value);
+    /**
+     * Walk the postings of every query term once and accumulate the dot products
+     * @param query Term ID and TF-IDF of the query words
+     * @param index Index to take the postings from (indexed by term ID)
+     */
+    void accumulate(const std::vector<std::pair<uint32_t, float>> &query, const std::vector<map_element> &index);
+    /**
+     * Walk the quantized impacts of every query term once and accumulate the cosine similarities
+     * Impacts are already divided by the document norms, so the scores need no normalize
+     * @param query Term ID and TF-IDF of the query words
+     * @param index Impacts to take the postings from (indexed by term ID)
+     * @param query_norm Norm of the query
+     */
+    void accumulate(const std::vector<std::pair<uint32_t, float>> &query, const ImpactIndex &index, float query_norm);
+    /**
+     * Turn the accumulated dot products into cosine similarities
+     * Documents with zero norm (e.g. documents that are just titles) get score 0
+     * @param norms Document norms
+     * @param query_norm Norm of the query
+     */
+    void normalize(const std::map<int, float> &norms, float query_norm);
+    /**
+     * Add the (weighted) scores of other accumulator to this one
+     * @param other Other accumulator
+     * @param weight Weight of the other scores
+     */
+    void merge(const ScoreAccumulator &other, float weight = 1.0f);
+
+    /**
+     * Get the score of the given document
+     * @param doc_id Document ID
+     * @return Score (0 if the document was not touched)
+     */
+    [[nodiscard]] float get(int doc_id) const;
+    /**
+     * Get the touched documents and their scores, documents with score of 0 are thrown away
+     * @return Pairs of document ID and score
+     */
+    [[nodiscard]] std::vector<std::pair<int, float>> get_results() const;
+    /**
+     * Get IDs of the touched documents
+     * @return Touched document IDs
+     */
+    [[nodiscard]] const std::vector<int> &get_touched() const;
+};
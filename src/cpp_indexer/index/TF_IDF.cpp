@@ -1,119 +1,186 @@
 #include "TF_IDF.h"
-
-std::map<std::string, float> TF_IDF::calc_idf(const std::vector<TokenizedDocument> &collection, bool title) {
-    /* Initialize IDF */
-    std::map<std::string, float> idf;
-
-    /* Iterate over documents */
-    for (const auto &doc : collection) {
-        /* Split words */
-        auto words = doc.content;
-        words.insert(words.end(), doc.toc.begin(), doc.toc.end());
-        words.insert(words.end(), doc.h1.begin(), doc.h1.end());
-        words.insert(words.end(), doc.h2.begin(), doc.h2.end());
-        words.insert(words.end(), doc.h3.begin(), doc.h3.end());
-        if (title)
-            words = doc.title;
-        /* Store found words */
-        std::vector<std::string> found_in_this_doc;
-
-        /* Iterate over words */
-        for (const auto &word : words)
-            /* If word is not found in this document */
-            if (std::find(found_in_this_doc.begin(), found_in_this_doc.end(), word) == found_in_this_doc.end()) {
-                /* Increment DF and mark word as found */
-                idf[word] += 1;
-                found_in_this_doc.push_back(word);
-            }
+#include "BlockIndexBuilder.h"
+
+void TF_IDF::count_terms(std::vector<uint32_t> &terms, std::vector<std::pair<uint32_t, uint32_t>> &counts) {
+    /* Same terms are next to each other after sorting */
+    std::sort(terms.begin(), terms.end());
+
+    /* Count the runs */
+    counts.clear();
+    for (size_t i = 0; i < terms.size();) {
+        size_t j = i;
+        while (j < terms.size() && terms[j] == terms[i])
+            j++;
+        counts.emplace_back(terms[i], static_cast<uint32_t>(j - i));
+        i = j;
     }
-
-    /* Calculate IDF from DF */
-    for (auto& [word, count] : idf)
-        count = std::log10(static_cast<float>(collection.size()) / count);
-
-    return idf;
 }
 
-std::map<std::string, float> TF_IDF::calc_tf(const std::vector<std::string> &doc) {
-    /* Initialize TF */
-    std::map<std::string, float> tf;
-
-    /* Iterate over words */
-    for (const auto &word : doc)
-        tf[word] += 1;
+std::vector<std::pair<uint32_t, uint32_t>> TF_IDF::calc_counts(const std::vector<uint32_t> &doc) {
+    auto terms = doc;
+    std::vector<std::pair<uint32_t, uint32_t>> counts;
+    count_terms(terms, counts);
+    return counts;
+}
 
-    /* Calculate TF */
-    for (auto& [word, count] : tf)
-        count = 1 + std::log10(count);
+std::vector<std::pair<uint32_t, float>> TF_IDF::calc_tf(const std::vector<uint32_t> &doc) {
+    std::vector<std::pair<uint32_t, float>> tf;
+    for (const auto &[term, count] : calc_counts(doc))
+        tf.emplace_back(term, tf_weight(count));
     return tf;
 }
 
-std::map<std::string, map_element> TF_IDF::calc_tf_idf(const std::vector<TokenizedDocument> &collection, std::map<int, float> &norms, bool title) {
-    auto idf = calc_idf(collection);
-    std::map<int, std::map<std::string, float>> tf_idf_docs;
+void TF_IDF::run_ranges(const std::vector<size_t> &bounds, const std::function<void(size_t, size_t, size_t)> &body) {
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i + 2 < bounds.size(); i++)
+        threads.emplace_back(body, i, bounds[i], bounds[i + 1]);
+    if (bounds.size() >= 2)
+        body(bounds.size() - 2, bounds[bounds.size() - 2], bounds.back());
+    for (auto &thread : threads)
+        thread.join();
+}
 
-    for (const auto &doc : collection) {
-        /* Get TF of words in document */
-        auto words = doc.content;
-        words.insert(words.end(), doc.toc.begin(), doc.toc.end());
-        words.insert(words.end(), doc.h1.begin(), doc.h1.end());
-        words.insert(words.end(), doc.h2.begin(), doc.h2.end());
-        words.insert(words.end(), doc.h3.begin(), doc.h3.end());
-        if (title)
-            words = doc.title;
-        auto tf = calc_tf(words);
-        /* Calculate TF-IDF */
-        std::map<std::string, float> tf_idf_temp;
-        for (auto &[word, value] : tf)
-            tf_idf_temp[word] = value * idf[word];
-        tf_idf_docs[doc.id] = tf_idf_temp;
+void TF_IDF::calc_tf_idf(const std::vector<term_document> &collection, size_t terms_count, std::vector<map_element> &index, std::vector<map_element> &title_index, std::map<int, float> &norms, std::map<int, float> &title_norms, const std::vector<uint32_t> &base_df, size_t base_docs) {
+    /* Documents ordered by ID, so every posting list ends up sorted */
+    std::vector<const term_document *> docs;
+    docs.reserve(collection.size());
+    for (const auto &doc : collection)
+        docs.emplace_back(&doc);
+    std::sort(docs.begin(), docs.end(), [](const term_document *a, const term_document *b) { return a->id < b->id; });
+
+    index.assign(terms_count, map_element());
+    title_index.assign(terms_count, map_element());
+    if (docs.empty())
+        return;
+
+    /* Contiguous shards of the documents, one per worker thread */
+    auto threads_count = get_threads_count(docs.size());
+    std::vector<size_t> doc_bounds(threads_count + 1);
+    for (size_t i = 0; i <= threads_count; i++)
+        doc_bounds[i] = docs.size() * i / threads_count;
+
+    /* Term counts of both fields of every document and DF of every shard */
+    /* Titles are weighted by the IDF of the content (same as the content index), so only the content DF is counted */
+    std::vector<std::vector<std::pair<uint32_t, uint32_t>>> doc_counts(docs.size());
+    std::vector<std::vector<std::pair<uint32_t, uint32_t>>> title_counts(docs.size());
+    std::vector<std::vector<uint32_t>> shard_df(threads_count, std::vector<uint32_t>(terms_count, 0));
+    run_ranges(doc_bounds, [&](size_t shard, size_t begin, size_t end) {
+        std::vector<uint32_t> terms;
+        for (auto i = begin; i < end; i++) {
+            docs[i]->get_terms(false, terms);
+            count_terms(terms, doc_counts[i]);
+            docs[i]->get_terms(true, terms);
+            count_terms(terms, title_counts[i]);
+            for (const auto &[term, _] : doc_counts[i])
+                shard_df[shard][term]++;
+        }
+    });
+
+    /* DF of the shards merged, ranges of terms are then cut so that every worker gets about the same number of postings */
+    std::vector<uint32_t> df(terms_count, 0);
+    std::vector<size_t> merge_bounds(threads_count + 1);
+    for (size_t i = 0; i <= threads_count; i++)
+        merge_bounds[i] = terms_count * i / threads_count;
+    run_ranges(merge_bounds, [&](size_t, size_t begin, size_t end) {
+        for (const auto &partial : shard_df)
+            for (auto term = begin; term < end; term++)
+                df[term] += partial[term];
+        for (auto term = begin; term < end && term < base_df.size(); term++)
+            df[term] += base_df[term];
+    });
+    shard_df.clear();
+    uint64_t postings_count = 0;
+    for (const auto &value : df)
+        postings_count += value;
+    std::vector<size_t> term_bounds{0};
+    uint64_t postings_sum = 0;
+    for (size_t term = 0; term < terms_count; term++) {
+        postings_sum += df[term];
+        if (term_bounds.size() < threads_count && postings_sum * threads_count >= postings_count * term_bounds.size())
+            term_bounds.emplace_back(term + 1);
     }
-
-    /* Store TF-IDF in a map */
-    std::map<std::string, map_element> map_ele;
-    for (const auto &[doc_id, doc_tf_idf] : tf_idf_docs) {
+    term_bounds.emplace_back(terms_count);
+
+    /* Postings of a range of terms - every worker goes through all the documents in ID order and takes only its own terms */
+    auto add_postings = [](const std::vector<std::pair<uint32_t, uint32_t>> &counts, int doc_id, size_t begin, size_t end, std::vector<map_element> &target) {
+        auto it = std::lower_bound(counts.begin(), counts.end(), std::make_pair(static_cast<uint32_t>(begin), 0u));
+        for (; it != counts.end() && it->first < end; it++)
+            target[it->first].postings.push_back(doc_id, it->second);
+    };
+    run_ranges(term_bounds, [&](size_t, size_t begin, size_t end) {
+        for (size_t i = 0; i < docs.size(); i++) {
+            add_postings(doc_counts[i], docs[i]->id, begin, end, index);
+            add_postings(title_counts[i], docs[i]->id, begin, end, title_index);
+        }
+        /* Store IDF too, for easy query TF-IDF calculation */
+        for (auto term = begin; term < end; term++) {
+            float idf = df[term] > 0 ? std::log10(static_cast<float>(collection.size() + base_docs) / static_cast<float>(df[term])) : 0;
+            if (!index[term].postings.empty())
+                index[term].idf = idf;
+            if (!title_index[term].postings.empty())
+                title_index[term].idf = idf;
+        }
+    });
+
+    /* Norms of a range of documents - terms of a document go in ascending order, same as in a single thread */
+    /* Document IDs are given out one after another, so they are close to each other and index a plain vector */
+    int first_id = docs.front()->id;
+    std::vector<float> doc_norms(docs.back()->id - first_id + 1, 0);
+    std::vector<float> title_doc_norms(doc_norms.size(), 0);
+    auto calc_norm = [](const std::vector<std::pair<uint32_t, uint32_t>> &counts, const std::vector<map_element> &source) {
         float norm = 0;
-        for (const auto &[word, value] : doc_tf_idf) {
-            map_ele[word].doc_tf_idf.emplace_back(doc_id, value);
-
+        for (const auto &[term, count] : counts) {
+            float value = tf_weight(count) * source[term].idf;
             norm += value * value;
         }
-        norms[doc_id] = std::sqrt(norm);
+        return norm;
+    };
+    run_ranges(doc_bounds, [&](size_t, size_t begin, size_t end) {
+        for (auto i = begin; i < end; i++) {
+            doc_norms[docs[i]->id - first_id] += calc_norm(doc_counts[i], index);
+            title_doc_norms[docs[i]->id - first_id] += calc_norm(title_counts[i], title_index);
+        }
+    });
+    doc_counts.clear();
+    title_counts.clear();
+    for (auto &norm : doc_norms)
+        norm = std::sqrt(norm);
+    for (auto &norm : title_doc_norms)
+        norm = std::sqrt(norm);
+    for (const auto &doc : docs) {
+        norms[doc->id] = doc_norms[doc->id - first_id];
+        title_norms[doc->id] = title_doc_norms[doc->id - first_id];
     }
-    /* Store IDF too, for easy query TF-IDF calculation */
-    for (auto &[word, value] : map_ele)
-        value.idf = idf[word];
-
-    return map_ele;
-}
 
-void TF_IDF::calc_tf_idf_file_based(const std::string &index_path_dir, bool title) {
-    std::map<int, std::map<std::string, float>> tf_idf_docs;
-    {
-        std::map<std::string, float> idf;
-        {
-            auto docs = FileBasedLoader::load_tokenized_docs(index_path_dir);
-
-            idf = calc_idf(docs);
-
-            for (const auto &doc: docs) {
-                auto words = doc.content;
-                words.insert(words.end(), doc.toc.begin(), doc.toc.end());
-                words.insert(words.end(), doc.h1.begin(), doc.h1.end());
-                words.insert(words.end(), doc.h2.begin(), doc.h2.end());
-                words.insert(words.end(), doc.h3.begin(), doc.h3.end());
-                if (title)
-                    words = doc.title;
-                auto tf = calc_tf(words);
-                std::map<std::string, float> tf_idf_temp;
-                for (auto &[word, value]: tf)
-                    tf_idf_temp[word] = value * idf[word];
-                tf_idf_docs[doc.id] = std::move(tf_idf_temp);
-            }
+    /* Store upper bounds for MaxScore */
+    auto calc_bound = [first_id](map_element &element, const std::vector<float> &field_norms) {
+        element.postings.for_each([&](int doc_id, uint32_t tf) {
+            auto norm = field_norms[doc_id - first_id];
+            if (norm > 0)
+                element.max_score = std::max(element.max_score, tf_weight(tf) * element.idf / norm);
+        });
+    };
+    run_ranges(term_bounds, [&](size_t, size_t begin, size_t end) {
+        for (auto term = begin; term < end; term++) {
+            calc_bound(index[term], doc_norms);
+            calc_bound(title_index[term], title_doc_norms);
         }
+    });
+}
 
-        FileBasedLoader::save_tf_idf(tf_idf_docs, idf, index_path_dir, title);
-    }
+float TF_IDF::calc_upper_bound(const map_element &element, const std::map<int, float> &norms) {
+    float max_score = 0;
+    element.postings.for_each([&](int doc_id, uint32_t tf) {
+        auto it = norms.find(doc_id);
+        if (it != norms.end() && it->second > 0)
+            max_score = std::max(max_score, tf_weight(tf) * element.idf / it->second);
+    });
+    return max_score;
+}
 
-    FileBasedLoader::save_tf_idf_norms(tf_idf_docs, index_path_dir, title);
+void TF_IDF::calc_tf_idf_file_based(const std::string &index_path_dir, const std::string &output_dir, bool title) {
+    /* Documents are streamed into blocks of bounded size, the corpus is never held in memory whole */
+    BlockIndexBuilder builder(output_dir, title);
+    FileBasedLoader::for_each_tokenized_doc(index_path_dir, [&builder](const TokenizedDocument &doc) { builder.add(doc); });
+    builder.finish();
 }
@@ -1,12 +1,18 @@
 #pragma once
 
 #include <map>
+#include <array>
 #include <algorithm>
 #include <cmath>
 #include <iostream>
 #include <fstream>
+#include <functional>
+#include <thread>
 #include "Document.h"
+#include "Vocabulary.h"
+#include "PostingList.h"
 #include "FileBasedLoader.h"
+#include "Const.h"
 
 /**
  * Map element used in calc_tf_idf
@@ -14,8 +20,10 @@
 struct map_element {
     /** IDF value of a word */
     float idf{};
-    /** Document ID and TF-IDF value for a word */
-    std::vector<std::pair<int, float>> doc_tf_idf{};
+    /** Document ID and term count for a word (TF-IDF of a posting is its TF weight times IDF) */
+    PostingList postings{};
+    /** Upper bound of TF-IDF / document norm over all postings (used to skip documents in MaxScore) */
+    float max_score{};
 
     /**
      * Converts map_element to a JSON object
@@ -24,20 +32,25 @@ struct map_element {
     [[nodiscard]] json to_json() const {
         json j;
         j["idf"] = idf;
-        for (const auto &pair: doc_tf_idf)
-            j["doc_tf_idf"].push_back({pair.first, pair.second});
+        j["max_score"] = max_score;
+        j["postings"] = json::array();
+        postings.for_each([&j](int doc_id, uint32_t tf) { j["postings"].push_back({doc_id, tf}); });
         return j;
     }
     /**
      * Converts JSON object to map_element
+     * Older indices have TF-IDF values instead of the term counts, they are left without postings
      * @param j JSON object
      * @return map_element object
      */
     static map_element from_json(const json &j) {
         map_element element;
         element.idf = j["idf"];
-        for (const auto &pair: j["doc_tf_idf"])
-            element.doc_tf_idf.emplace_back(pair[0], pair[1]);
+        if (j.contains("max_score"))
+            element.max_score = j["max_score"];
+        if (j.contains("postings"))
+            for (const auto &pair: j["postings"])
+                element.postings.push_back(pair[0], pair[1]);
         return element;
     }
 };
@@ -46,32 +59,75 @@ struct map_element {
  * TF-IDF class
  */
 class TF_IDF {
+private:
+    /** TF weights of the small term counts, they cover almost all the postings */
+    static inline const std::array<float, 256> tf_weights = [] {
+        std::array<float, 256> weights{};
+        for (size_t i = 1; i < weights.size(); i++)
+            weights[i] = 1 + std::log10(static_cast<float>(i));
+        return weights;
+    }();
+
+    /**
+     * Run the body on every range in its own thread (the last range runs on the calling thread)
+     * @param bounds Bounds of the ranges (range i is bounds[i] to bounds[i + 1])
+     * @param body Body taking the index of the range, its begin and its end
+     */
+    static void run_ranges(const std::vector<size_t> &bounds, const std::function<void(size_t, size_t, size_t)> &body);
+
 public:
     /**
-     * Calculate IDF from DF
-     * @param collection Collection of documents
-     * @param title Whether to calculate IDF for titles
-     * @return Map of words and their IDF values
+     * Get the TF weight of the given term count
+     * @param count Term count (at least 1)
+     * @return 1 + log10(count)
+     */
+    static float tf_weight(uint32_t count) {
+        return count < tf_weights.size() ? tf_weights[count] : 1 + std::log10(static_cast<float>(count));
+    }
+    /**
+     * Count the terms in place (the buffers are reused between documents)
+     * @param terms Terms (sorted by the call)
+     * @param counts Pairs of term ID and term count sorted by term ID (overwritten)
      */
-    static std::map<std::string, float> calc_idf(const std::vector<TokenizedDocument> &collection, bool title = false);
+    static void count_terms(std::vector<uint32_t> &terms, std::vector<std::pair<uint32_t, uint32_t>> &counts);
+    /**
+     * Count the terms of a document
+     * @param doc Document
+     * @return Pairs of term ID and term count sorted by term ID
+     */
+    static std::vector<std::pair<uint32_t, uint32_t>> calc_counts(const std::vector<uint32_t> &doc);
     /**
      * Calculate TF from a document
      * @param doc Document
-     * @return Map of words and their TF values
+     * @return Pairs of term ID and TF value sorted by term ID
      */
-    static std::map<std::string, float> calc_tf(const std::vector<std::string> &doc);
+    static std::vector<std::pair<uint32_t, float>> calc_tf(const std::vector<uint32_t> &doc);
     /**
-     * Calculate TF-IDF from a collection of documents
+     * Calculate TF-IDF of the content and the title index from a collection of documents (both in one pass)
+     * Documents are split into shards counted by the worker threads, DF of the shards is merged per term, postings
+     * and upper bounds of both fields are then built by the workers over ranges of terms and norms over ranges of documents
      * @param collection Collection of documents
+     * @param terms_count Number of terms in the vocabulary
+     * @param index Content index (overwritten, indexed by term ID, terms that are not in any document have no postings)
+     * @param title_index Title index (overwritten, weighted by the IDF of the content)
      * @param norms Norms of documents
-     * @param title Whether to calculate TF-IDF for titles
-     * @return Map of words and their IDF values
+     * @param title_norms Norms of the titles
+     * @param base_df DF of the terms in the rest of the index (other segments), indexed by term ID
+     * @param base_docs Number of documents in the rest of the index
      */
-    static std::map<std::string, map_element> calc_tf_idf(const std::vector<TokenizedDocument> &collection, std::map<int, float> &norms, bool title = false);
+    static void calc_tf_idf(const std::vector<term_document> &collection, size_t terms_count, std::vector<map_element> &index, std::vector<map_element> &title_index, std::map<int, float> &norms, std::map<int, float> &title_norms, const std::vector<uint32_t> &base_df = {}, size_t base_docs = 0);
     /**
-     * Calculate TF-IDF (file based)
-     * @param index_path_dir Path to the directory with the index
+     * Calculate the upper bound score (max TF-IDF / document norm) of a word
+     * @param element Map element of the word
+     * @param norms Norms of documents
+     * @return Upper bound
+     */
+    static float calc_upper_bound(const map_element &element, const std::map<int, float> &norms);
+    /**
+     * Calculate TF-IDF (file based, memory is bounded by MEMORY_BUDGET)
+     * @param index_path_dir Path to the directory with the index (tokenized documents are read from there)
+     * @param output_dir Path to the directory the built files are written to
      * @param title Whether to calculate TF-IDF for titles
      */
-     static void calc_tf_idf_file_based(const std::string &index_path_dir, bool title = false);
-};
+     static void calc_tf_idf_file_based(const std::string &index_path_dir, const std::string &output_dir, bool title = false);
+};
\ No newline at end of file
@@ -0,0 +1,62 @@
+#include "TopKHeap.h"
+
+TopKHeap::TopKHeap(int k) : k(std::max(k, 0)), heap() {
+    /* Do not reserve for huge k (evaluation asks for 1 000 000 results) */
+    this->heap.reserve(std::min<size_t>(this->k, 1024));
+}
+
+bool TopKHeap::better(const std::pair<int, float> &a, const std::pair<int, float> &b) {
+    if (a.second != b.second)
+        return a.second > b.second;
+    return a.first < b.first;
+}
+
+bool TopKHeap::push(int doc_id, float score) {
+    if (this->k == 0)
+        return false;
+
+    std::pair<int, float> candidate = {doc_id, score};
+    if (this->heap.size() < this->k) {
+        this->heap.emplace_back(candidate);
+        std::push_heap(this->heap.begin(), this->heap.end(), better);
+        return true;
+    }
+
+    /* Replace the worst result only if the candidate is better */
+    if (!better(candidate, this->heap.front()))
+        return false;
+    std::pop_heap(this->heap.begin(), this->heap.end(), better);
+    this->heap.back() = candidate;
+    std::push_heap(this->heap.begin(), this->heap.end(), better);
+    return true;
+}
+
+bool TopKHeap::full() const {
+    return this->heap.size() >= this->k;
+}
+
+float TopKHeap::threshold() const {
+    if (!this->full() || this->heap.empty())
+        return 0;
+    return this->heap.front().second;
+}
+
+std::vector<std::pair<int, float>> TopKHeap::get_sorted() const {
+    auto results = this->heap;
+    std::sort(results.begin(), results.end(), better);
+    return results;
+}
+
+std::vector<std::pair<int, float>> TopKHeap::select(std::vector<std::pair<int, float>> results, int k) {
+    /* Large k (evaluation) - everything is returned anyway, just sort */
+    if (k < 0 || static_cast<size_t>(k) >= results.size()) {
+        std::sort(results.begin(), results.end(), better);
+        return results;
+    }
+
+    /* Small k (GUI) - keep only k results in the heap */
+    TopKHeap top_k(k);
+    for (const auto &[doc_id, score] : results)
+        top_k.push(doc_id, score);
+    return top_k.get_sorted();
+}
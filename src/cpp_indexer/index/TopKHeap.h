@@ -0,0 +1,64 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+
+/**
+ * Bounded min-heap keeping the k best (document ID, score) pairs
+ * The worst kept result is on top of the heap, so it is also the threshold a new document has to beat
+ * Ties are broken by document ID (lower ID wins), so the results are deterministic
+ */
+class TopKHeap {
+private:
+    /** Number of results to keep */
+    size_t k;
+    /** Heap of (document ID, score) pairs, worst result on top */
+    std::vector<std::pair<int, float>> heap;
+
+    /**
+     * Comparator for the heap (true if a is better than b => b goes on top)
+     * @param a First result
+     * @param b Second result
+     * @return True if a is better than b
+     */
+    static bool better(const std::pair<int, float> &a, const std::pair<int, float> &b);
+
+public:
+    /**
+     * Constructor for the TopKHeap class
+     * @param k Number of results to keep
+     */
+    explicit TopKHeap(int k);
+
+    /**
+     * Try to push the given document into the heap
+     * @param doc_id Document ID
+     * @param score Score of the document
+     * @return True if the document was kept
+     */
+    bool push(int doc_id, float score);
+    /**
+     * Whether the heap already holds k results
+     * @return True if full
+     */
+    [[nodiscard]] bool full() const;
+    /**
+     * Score a document has to beat to get into the heap (0 while the heap is not full)
+     * @return Threshold score
+     */
+    [[nodiscard]] float threshold() const;
+    /**
+     * Get the kept results sorted from the best to the worst
+     * @return Pairs of document ID and score
+     */
+    [[nodiscard]] std::vector<std::pair<int, float>> get_sorted() const;
+
+    /**
+     * Select top k results from the given results
+     * Uses the heap when k is small and a full sort when k covers (almost) all the results
+     * @param results Results (pairs of document ID and score)
+     * @param k Number of results to keep
+     * @return Top k results sorted from the best to the worst
+     */
+    static std::vector<std::pair<int, float>> select(std::vector<std::pair<int, float>> results, int k);
+};
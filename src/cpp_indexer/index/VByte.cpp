@@ -0,0 +1,20 @@
+#include "VByte.h"
+
+void VByte::write(std::vector<uint8_t> &output, uint32_t value) {
+    while (value >= 0x80) {
+        output.push_back(static_cast<uint8_t>(value & 0x7F));
+        value >>= 7;
+    }
+    output.push_back(static_cast<uint8_t>(value | 0x80));
+}
+
+uint32_t VByte::read(const uint8_t *&input, const uint8_t *end) {
+    uint32_t value = 0;
+    for (int shift = 0; input < end && shift < 32; shift += 7) {
+        uint8_t byte = *input++;
+        value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+        if (byte & 0x80)
+            return value;
+    }
+    throw std::runtime_error("[ERROR]: Corrupted variable-byte data!");
+}
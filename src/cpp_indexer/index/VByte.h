@@ -0,0 +1,25 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <stdexcept>
+
+/**
+ * Variable-byte coding of unsigned integers (7 bits per byte, the highest bit marks the last byte)
+ */
+class VByte {
+public:
+    /**
+     * Write a variable-byte coded value
+     * @param output Output bytes
+     * @param value Value
+     */
+    static void write(std::vector<uint8_t> &output, uint32_t value);
+    /**
+     * Read a variable-byte coded value
+     * @param input Current position in the input (moved after the value)
+     * @param end End of the input
+     * @return Value
+     */
+    static uint32_t read(const uint8_t *&input, const uint8_t *end);
+};
@@ -0,0 +1,96 @@
+#include <csignal>
+#include "QueryServer.h"
+
+/** File based index */
+bool FILE_BASED = false;
+/** Language detection is REALLY sloooow */
+bool DETECT_LANG = false;
+/** Use lemmatization or stemming */
+bool USE_LEMMA = true;
+/** Number of worker threads (0 = number of hardware threads) */
+int THREADS = 0;
+/** Memory budget of a block of the file based index build in MB */
+int MEMORY_BUDGET = 256;
+/** Bits of the quantized impacts of the in-memory index (8 or 16, 0 = scoring by the float postings) */
+int IMPACT_BITS = 0;
+
+/** Path of the Unix domain socket */
+std::string socket_path = SERVER_SOCKET_PATH;
+/** Localhost TCP port (0 for the Unix domain socket) */
+int port = 0;
+/** Default time limit of a query in milliseconds */
+int deadline_ms = 5000;
+/** Running server (stopped by SIGINT and SIGTERM) */
+QueryServer *server = nullptr;
+
+/**
+ * Parse arguments
+ * @param argc Argument count
+ * @param argv Argument values
+ */
+void parse_args(int argc, char **argv) {
+    for (int i = 1; i < argc; i++) {
+        if (std::string(argv[i]) == "--help") {
+            std::cout << "Usage: ./cpp_indexer_server [--file-based] [--lemma | --stem] [--threads N] [--impact-bits 8|16] [--socket PATH | --port N] [--deadline MS]" << std::endl;
+            std::cout << "Options:" << std::endl;
+            std::cout << "\t--file-based\t\tUse file based index" << std::endl;
+            std::cout << "\t--lemma\t\t\t\tUse lemmatization" << std::endl;
+            std::cout << "\t--stem\t\t\t\tUse stemming" << std::endl;
+            std::cout << "\t--threads N\t\t\tNumber of worker threads (default: number of hardware threads)" << std::endl;
+            std::cout << "\t--impact-bits N\t\tScore by impacts quantized to 8 or 16 bits (default: float scores)" << std::endl;
+            std::cout << "\t--socket PATH\t\tUnix domain socket to listen on (default: " << SERVER_SOCKET_PATH << ")" << std::endl;
+            std::cout << "\t--port N\t\t\tListen on localhost TCP port instead of the socket" << std::endl;
+            std::cout << "\t--deadline MS\t\tDefault time limit of a query (default: 5000)" << std::endl;
+            exit(EXIT_SUCCESS);
+        }
+
+        if (std::string(argv[i]) == "--file-based")
+            FILE_BASED = true;
+        if (std::string(argv[i]) == "--lemma")
+            USE_LEMMA = true;
+        if (std::string(argv[i]) == "--stem")
+            USE_LEMMA = false;
+        if (std::string(argv[i]) == "--threads" && i + 1 < argc)
+            THREADS = std::max(0, std::atoi(argv[++i]));
+        if (std::string(argv[i]) == "--impact-bits" && i + 1 < argc) {
+            int bits = std::atoi(argv[++i]);
+            IMPACT_BITS = bits <= 0 ? 0 : (bits <= 8 ? 8 : 16);
+        }
+        if (std::string(argv[i]) == "--socket" && i + 1 < argc)
+            socket_path = argv[++i];
+        if (std::string(argv[i]) == "--port" && i + 1 < argc)
+            port = std::max(0, std::atoi(argv[++i]));
+        if (std::string(argv[i]) == "--deadline" && i + 1 < argc)
+            deadline_ms = std::max(1, std::atoi(argv[++i]));
+    }
+}
+
+/**
+ * Stop the server on SIGINT and SIGTERM
+ * @param signal Signal
+ */
+void handle_signal(int /*signal*/) {
+    if (server)
+        server->stop();
+}
+
+/**
+ * Main function
+ * @return Exit code
+ */
+int main(int argc, char **argv) {
+    /* Parse arguments, set FILE_BASED, USE_LEMMA, THREADS, IMPACT_BITS and the server options */
+    parse_args(argc, argv);
+
+    QueryServer query_server(socket_path, port, deadline_ms);
+    if (query_server.load_indices() == 0)
+        std::cerr << "[ERROR]: No index found in " << (FILE_BASED ? FILE_BASED_INDEX_PATH : INDEX_PATH) << "!" << std::endl;
+
+    server = &query_server;
+    std::signal(SIGINT, handle_signal);
+    std::signal(SIGTERM, handle_signal);
+    if (!query_server.run())
+        return EXIT_FAILURE;
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,352 @@
+#include "QueryServer.h"
+
+#include <filesystem>
+#include <limits>
+#include <cstring>
+#include <cerrno>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/stat.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+server_connection::~server_connection() {
+    if (this->fd >= 0)
+        close(this->fd);
+}
+
+QueryServer::QueryServer(const std::string &socket_path, int port, int deadline_ms) : indices(), indexers(), socket_path(socket_path), port(port), deadline(deadline_ms), queue(), queue_mutex(), queue_cv(), workers() {
+    /* Nothing to do here :) */
+}
+
+QueryServer::~QueryServer() {
+    this->stop();
+    this->queue_cv.notify_all();
+    for (auto &worker : this->workers)
+        if (worker.joinable())
+            worker.join();
+    if (this->listen_fd >= 0)
+        close(this->listen_fd);
+}
+
+size_t QueryServer::load_indices() {
+    if (FILE_BASED) {
+        if (!std::filesystem::exists(FILE_BASED_INDEX_PATH))
+            return 0;
+        /* Indices are only opened, they are not reindexed */
+        for (const auto &entry : std::filesystem::directory_iterator(FILE_BASED_INDEX_PATH)) {
+            /* Index that is being rebuilt by the GUI */
+            if (!entry.is_directory() || entry.path().extension() == STAGING_EXTENSION)
+                continue;
+            IndexHandler::load_lemma_cache(entry.path().string());
+            this->indices.emplace_back(entry.path().filename().string());
+            this->indexers.emplace_back(entry.path().string() + "/", false);
+        }
+    } else {
+        if (!std::filesystem::exists(INDEX_PATH))
+            return 0;
+        for (const auto &entry : std::filesystem::directory_iterator(INDEX_PATH)) {
+            auto extension = entry.path().extension().string();
+            if (extension != INDEX_EXTENSION && extension != ".json")
+                continue;
+            Indexer indexer = Indexer();
+            if (!IndexHandler::load_index(indexer, entry.path().string()))
+                continue;
+            this->indices.emplace_back(entry.path().filename().replace_extension().string());
+            this->indexers.emplace_back(std::move(indexer));
+        }
+    }
+    return this->indexers.size();
+}
+
+bool QueryServer::open_socket() {
+    if (this->port > 0) {
+        this->listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (this->listen_fd < 0) {
+            std::cerr << "[ERROR]: Failed to create socket: " << std::strerror(errno) << std::endl;
+            return false;
+        }
+        int reuse = 1;
+        setsockopt(this->listen_fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        /* Only local clients, there is no authentication */
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(static_cast<uint16_t>(this->port));
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (bind(this->listen_fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0) {
+            std::cerr << "[ERROR]: Failed to bind port " << this->port << ": " << std::strerror(errno) << std::endl;
+            return false;
+        }
+    } else {
+        sockaddr_un address{};
+        if (this->socket_path.size() >= sizeof(address.sun_path)) {
+            std::cerr << "[ERROR]: Socket path " << this->socket_path << " is too long!" << std::endl;
+            return false;
+        }
+        this->listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (this->listen_fd < 0) {
+            std::cerr << "[ERROR]: Failed to create socket: " << std::strerror(errno) << std::endl;
+            return false;
+        }
+        /* Socket left behind by a previous run, any other file at the path is left alone (bind fails) */
+        struct stat status{};
+        if (lstat(this->socket_path.c_str(), &status) == 0 && S_ISSOCK(status.st_mode))
+            unlink(this->socket_path.c_str());
+        address.sun_family = AF_UNIX;
+        std::strncpy(address.sun_path, this->socket_path.c_str(), sizeof(address.sun_path) - 1);
+        if (bind(this->listen_fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0) {
+            std::cerr << "[ERROR]: Failed to bind socket " << this->socket_path << ": " << std::strerror(errno) << std::endl;
+            return false;
+        }
+    }
+
+    if (listen(this->listen_fd, SOMAXCONN) < 0) {
+        std::cerr << "[ERROR]: Failed to listen: " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool QueryServer::run() {
+    if (!this->open_socket())
+        return false;
+
+    this->running = true;
+    auto threads = get_threads_count(std::numeric_limits<size_t>::max());
+    for (unsigned int i = 0; i < threads; i++)
+        this->workers.emplace_back(&QueryServer::process_requests, this);
+    if (this->port > 0)
+        std::cout << "Listening on 127.0.0.1:" << this->port;
+    else
+        std::cout << "Listening on " << this->socket_path;
+    std::cout << " (" << this->indexers.size() << " indices, " << threads << " workers)" << std::endl;
+
+    /* This thread only moves bytes - reads request lines of all the connections and queues them for the workers */
+    std::vector<std::shared_ptr<server_connection>> connections;
+    while (this->running) {
+        std::vector<pollfd> fds;
+        fds.push_back({this->listen_fd, POLLIN, 0});
+        for (const auto &connection : connections)
+            fds.push_back({connection->fd, POLLIN, 0});
+        if (poll(fds.data(), fds.size(), POLL_INTERVAL) <= 0)
+            continue;
+
+        std::vector<std::shared_ptr<server_connection>> open_connections;
+        for (size_t i = 1; i < fds.size(); i++)
+            if (!fds[i].revents || this->read_requests(connections[i - 1]))
+                open_connections.emplace_back(connections[i - 1]);
+        if (fds[0].revents & POLLIN) {
+            int fd = accept(this->listen_fd, nullptr, nullptr);
+            if (fd >= 0) {
+                auto connection = std::make_shared<server_connection>();
+                connection->fd = fd;
+                open_connections.emplace_back(connection);
+            }
+        }
+        connections = std::move(open_connections);
+    }
+
+    /* Workers answer the queued requests before they stop */
+    this->queue_cv.notify_all();
+    for (auto &worker : this->workers)
+        worker.join();
+    this->workers.clear();
+    close(this->listen_fd);
+    this->listen_fd = -1;
+    if (this->port == 0)
+        unlink(this->socket_path.c_str());
+    return true;
+}
+
+void QueryServer::stop() {
+    this->running = false;
+}
+
+bool QueryServer::read_requests(const std::shared_ptr<server_connection> &connection) {
+    char chunk[65536];
+    auto count = recv(connection->fd, chunk, sizeof(chunk), 0);
+    if (count < 0 && (errno == EINTR || errno == EAGAIN))
+        return true;
+    if (count <= 0)
+        return false;
+
+    auto received = std::chrono::steady_clock::now();
+    connection->buffer.append(chunk, count);
+    size_t begin = 0;
+    for (auto end = connection->buffer.find('\n'); end != std::string::npos; end = connection->buffer.find('\n', begin)) {
+        auto line = connection->buffer.substr(begin, end - begin);
+        begin = end + 1;
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+        if (line.empty())
+            continue;
+
+        auto body = json::parse(line, nullptr, false);
+        if (body.is_discarded() || !(body.is_object() || body.is_array())) {
+            this->queue_request({connection, json(), received, "Invalid request"});
+            continue;
+        }
+        this->queue_request({connection, std::move(body), received, ""});
+    }
+    connection->buffer.erase(0, begin);
+
+    /* Connection is closed once the queued error is sent */
+    if (connection->buffer.size() > MAX_REQUEST_SIZE) {
+        this->queue_request({connection, json(), received, "Request too long"});
+        return false;
+    }
+    return true;
+}
+
+void QueryServer::queue_request(server_request request) {
+    {
+        std::lock_guard<std::mutex> lock(this->queue_mutex);
+        this->queue.push_back(std::move(request));
+    }
+    this->queue_cv.notify_one();
+}
+
+void QueryServer::process_requests() {
+    while (true) {
+        /* One request at a time, a queued request never waits behind another one while some worker is idle */
+        server_request request;
+        {
+            std::unique_lock<std::mutex> lock(this->queue_mutex);
+            this->queue_cv.wait(lock, [this] { return !this->queue.empty() || !this->running; });
+            if (this->queue.empty())
+                return;
+            request = std::move(this->queue.front());
+            this->queue.pop_front();
+        }
+
+        json response;
+        if (!request.error.empty()) {
+            response = {{"error", request.error}};
+        } else if (request.body.is_array()) {
+            response = json::array();
+            for (const auto &query : request.body)
+                response.push_back(this->answer(query, request.received));
+        } else {
+            response = this->answer(request.body, request.received);
+        }
+        send_response(*request.connection, response);
+    }
+}
+
+json QueryServer::answer(const json &query, std::chrono::steady_clock::time_point received) {
+    json response = json::object();
+    if (query.is_object() && query.contains("id"))
+        response["id"] = query["id"];
+
+    try {
+        if (!query.is_object() || !query.contains("query") || !query["query"].is_string()) {
+            response["error"] = "Missing query";
+            return response;
+        }
+
+        /* Queries that waited in the queue for too long are not evaluated at all */
+        auto deadline = received + std::chrono::milliseconds(query.value("deadline_ms", static_cast<int>(this->deadline.count())));
+        if (std::chrono::steady_clock::now() > deadline) {
+            response["error"] = "Deadline exceeded";
+            return response;
+        }
+
+        /* Index can be left out if there is only one */
+        auto name = query.value("index", std::string());
+        size_t index = this->indices.size();
+        for (size_t i = 0; i < this->indices.size(); i++)
+            if (this->indices[i] == name || (name.empty() && this->indices.size() == 1))
+                index = i;
+        if (index == this->indices.size()) {
+            response["error"] = "Unknown index";
+            return response;
+        }
+        auto &indexer = this->indexers[index];
+
+        auto field_name = query.value("field", std::string("all"));
+        FieldType field = FieldType::ALL;
+        if (field_name == "title") {
+            field = FieldType::TITLE;
+        } else if (field_name == "content") {
+            field = FieldType::CONTENT;
+        } else if (field_name != "all") {
+            response["error"] = "Unknown field";
+            return response;
+        }
+        auto model = query.value("model", std::string("vector"));
+        if (model != "vector" && model != "boolean") {
+            response["error"] = "Unknown model";
+            return response;
+        }
+
+        /* Search loops stop the query once the deadline passes, it does not run to the end for nothing */
+        QueryDeadline::scope deadline_scope(deadline);
+        auto text = query["query"].get<std::string>();
+        std::vector<int> doc_ids;
+        std::vector<float> scores;
+        std::map<std::string, std::map<int, std::vector<int>>> positions;
+        if (model == "boolean") {
+            auto query_tokens = IndexHandler::get_query_preprocessor().parse_bool_query(text);
+            if (!query_tokens.empty())
+                std::tie(doc_ids, positions) = FILE_BASED ? indexer.search_file_based(query_tokens, field) : indexer.search(query_tokens, field);
+        } else {
+            /* Phrase search - the whole query in order, following words at distance 1 (same as in the GUI) */
+            auto k = query.value("k", 10);
+            auto phrase = query.value("phrase", false);
+            auto proximity = phrase ? 1 : std::max(0, query.value("proximity", 0));
+            auto [query_tokens, _] = IndexHandler::get_query_preprocessor().preprocess_text(text, true);
+            std::tie(doc_ids, scores, positions) = FILE_BASED ? indexer.search_file_based(query_tokens, k, field, proximity, phrase) : indexer.search(query_tokens, k, field, proximity, phrase);
+        }
+
+        if (std::chrono::steady_clock::now() > deadline) {
+            response["error"] = "Deadline exceeded";
+            return response;
+        }
+
+        response["results"] = json::array();
+        auto docs = indexer.get_docs(doc_ids);
+        for (size_t i = 0; i < docs.size(); i++) {
+            json result = {{"id", docs[i].id}, {"title", docs[i].title}, {"lang", docs[i].lang}};
+            if (i < scores.size())
+                result["score"] = scores[i];
+            response["results"].push_back(result);
+        }
+        /* Document IDs as keys, same as in the JSON index */
+        response["positions"] = json::object();
+        for (const auto &[word, doc_positions] : positions)
+            for (const auto &[doc_id, word_positions] : doc_positions)
+                response["positions"][word][std::to_string(doc_id)] = word_positions;
+    } catch (const json::exception &e) {
+        response.erase("results");
+        response.erase("positions");
+        response["error"] = "Invalid request";
+    } catch (const deadline_exceeded &e) {
+        response.erase("results");
+        response.erase("positions");
+        response["error"] = "Deadline exceeded";
+    } catch (const std::exception &e) {
+        /* Failed search (out of memory, ...) fails only its own request, the worker keeps running */
+        std::cerr << "[ERROR]: Query failed: " << e.what() << std::endl;
+        response.erase("results");
+        response.erase("positions");
+        response["error"] = "Query failed";
+    }
+    return response;
+}
+
+void QueryServer::send_response(server_connection &connection, const json &response) {
+    /* Titles may contain broken UTF-8, it is replaced instead of throwing */
+    auto line = response.dump(-1, ' ', false, json::error_handler_t::replace) + "\n";
+    std::lock_guard<std::mutex> lock(connection.write_mutex);
+    size_t sent = 0;
+    while (sent < line.size()) {
+        auto count = send(connection.fd, line.data() + sent, line.size() - sent, MSG_NOSIGNAL);
+        if (count < 0 && errno == EINTR)
+            continue;
+        if (count <= 0)
+            return;
+        sent += count;
+    }
+}
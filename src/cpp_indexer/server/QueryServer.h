@@ -0,0 +1,149 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include "nlohmann/json.hpp"
+#include "IndexHandler.h"
+#include "Const.h"
+
+using json = nlohmann::json;
+
+/**
+ * Client connection of the query server
+ */
+struct server_connection {
+    /** Socket (closed with the connection) */
+    int fd = -1;
+    /** Received bytes that do not form a whole line yet (only touched by the I/O thread) */
+    std::string buffer{};
+    /** Lock for sending the responses (workers answer the requests of one connection in parallel) */
+    std::mutex write_mutex{};
+
+    /**
+     * Destructor, closes the socket once no request of the connection is pending
+     */
+    ~server_connection();
+};
+
+/**
+ * Request waiting in the queue of the query server
+ */
+struct server_request {
+    /** Connection to send the response to */
+    std::shared_ptr<server_connection> connection;
+    /** Request - a query object or an array of them (answered by an array in the same order) */
+    json body;
+    /** Time the request was received (deadlines are counted from it) */
+    std::chrono::steady_clock::time_point received;
+    /** Error to answer instead of evaluating the request (invalid lines are answered by the workers too) */
+    std::string error;
+};
+
+/**
+ * Headless query server
+ * Indices are loaded once, queries come as JSON lines over a Unix domain socket or localhost TCP, every line
+ * is answered by one JSON line - {"id", "results": [{"id", "title", "lang", "score"}], "positions"} or {"id", "error"}
+ * Query fields: "query", "index" (name, optional with one index), "model" ("vector" or "boolean"), "k",
+ * "field" ("all", "title" or "content"), "proximity", "phrase" and "deadline_ms"
+ */
+class QueryServer {
+private:
+    /** Names of the loaded indices */
+    std::vector<std::string> indices;
+    /** Loaded indices */
+    std::vector<Indexer> indexers;
+    /** Path of the Unix domain socket (used if the port is 0) */
+    std::string socket_path;
+    /** Localhost TCP port (0 for the Unix domain socket) */
+    int port;
+    /** Default time limit of a query */
+    std::chrono::milliseconds deadline;
+    /** Listening socket */
+    int listen_fd = -1;
+    /** Whether the server is running */
+    std::atomic<bool> running = false;
+    /** Requests waiting for the workers */
+    std::deque<server_request> queue;
+    /** Lock for the queue */
+    std::mutex queue_mutex;
+    /** Wakes up the workers */
+    std::condition_variable queue_cv;
+    /** Worker threads */
+    std::vector<std::thread> workers;
+
+    /** Maximum length of a request line */
+    static constexpr size_t MAX_REQUEST_SIZE = 1 << 20;
+    /** How often the I/O thread checks whether the server was stopped (milliseconds) */
+    static constexpr int POLL_INTERVAL = 200;
+
+    /**
+     * Open the listening socket
+     * @return True if successful
+     */
+    bool open_socket();
+    /**
+     * Queue a request for the workers
+     * @param request Request
+     */
+    void queue_request(server_request request);
+    /**
+     * Read the available bytes of the connection and queue the complete request lines
+     * The I/O thread never sends anything itself, so a client that does not read its responses blocks only the
+     * worker answering it
+     * @param connection Connection
+     * @return False if the connection was closed
+     */
+    bool read_requests(const std::shared_ptr<server_connection> &connection);
+    /**
+     * Worker loop - take requests from the queue one by one and answer them until the server stops
+     */
+    void process_requests();
+    /**
+     * Answer a single query
+     * @param query Query object
+     * @param received Time the request was received
+     * @return Response object
+     */
+    json answer(const json &query, std::chrono::steady_clock::time_point received);
+    /**
+     * Send the response as one line
+     * @param connection Connection
+     * @param response Response
+     */
+    static void send_response(server_connection &connection, const json &response);
+
+public:
+    /**
+     * Constructor for the QueryServer class
+     * @param socket_path Path of the Unix domain socket (used if the port is 0)
+     * @param port Localhost TCP port (0 for the Unix domain socket)
+     * @param deadline_ms Default time limit of a query in milliseconds
+     */
+    QueryServer(const std::string &socket_path, int port, int deadline_ms);
+    /**
+     * Destructor, stops the workers and closes the socket
+     */
+    ~QueryServer();
+
+    /**
+     * Load all the indices from INDEX_PATH (or FILE_BASED_INDEX_PATH)
+     * @return Number of the loaded indices
+     */
+    size_t load_indices();
+    /**
+     * Serve the queries until the server is stopped (the calling thread handles the connections)
+     * @return False if the socket could not be opened
+     */
+    bool run();
+    /**
+     * Stop the server (safe to call from a signal handler)
+     */
+    void stop();
+};